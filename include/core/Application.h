@@ -9,6 +9,7 @@ namespace Burma {
 
 class BitNetClient;
 class FuelFetcher;
+class AssetIndex;
 class SDFBuilder;
 class RvizConverter;
 class MaterialManager;
@@ -26,6 +27,7 @@ public:
     // Getters for core modules
     BitNetClient* bitNetClient() const { return m_bitNetClient; }
     FuelFetcher* fuelFetcher() const { return m_fuelFetcher; }
+    AssetIndex* assetIndex() const { return m_assetIndex; }
     SDFBuilder* sdfBuilder() const { return m_sdfBuilder; }
     RvizConverter* rvizConverter() const { return m_rvizConverter; }
     MaterialManager* materialManager() const { return m_materialManager; }
@@ -45,11 +47,14 @@ private:
     Application& operator=(const Application&) = delete;
 
     void initializeModules();
+    void applyBitNetCalibration();
+    void initializeAssetIndex();
     void shutdownModules();
 
     // Core modules
     BitNetClient *m_bitNetClient;
     FuelFetcher *m_fuelFetcher;
+    AssetIndex *m_assetIndex;
     SDFBuilder *m_sdfBuilder;
     RvizConverter *m_rvizConverter;
     MaterialManager *m_materialManager;
@@ -0,0 +1,72 @@
+#ifndef BURMA_LAYOUTGENERATOR_H
+#define BURMA_LAYOUTGENERATOR_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "core/Scene.h"
+
+class QThreadPool;
+
+namespace Burma {
+
+/**
+ * @brief Procedural layouts of large structured scenes
+ *
+ * An entry of a plan's "generators" array names a layout and a few
+ * parameters, e.g. {"generator":"warehouse","rows":40,"columns":60}, and
+ * the generator appends its models straight to the Scene. Worlds of
+ * 10k-1M objects thus take a line of the plan rather than a JSON model
+ * each. Layouts start at "position" and extend along +x and +y.
+ *
+ *  - warehouse: rows of racks, columns bays long, with levels of shelves
+ *               and pallets on a density share of them; aisles spacing wide
+ *  - office:    rows by columns cubicles spacing on a side, each with two
+ *               partitions, a desk and, at density, a chair
+ *  - parking:   rows of columns bays spacing wide, facing in pairs across an
+ *               aisle, with cars in a density share of them
+ *  - maze:      rows by columns cells spacing wide; density opens that
+ *               share of the inner walls, turning it into a corridor network
+ *  - scatter:   up to count clutter objects in a region centred on position,
+ *               never closer than spacing
+ *
+ * The work is split by rows, or by tiles for scatter, and runs on a pool.
+ * Each row or tile draws from its own generator seeded from the entry's
+ * seed and its index, so the layout is the same on any number of threads.
+ */
+class LayoutGenerator
+{
+public:
+    // Models appended for the index-th entry, at most maxModels; unknown
+    // generators append none. The call waits for pool, so it must not run
+    // on one of its threads.
+    static int generate(const QJsonObject &entry, int index, Scene *scene, int maxModels = kMaxModels,
+                        QThreadPool *pool = nullptr);
+
+    // The entry's "name", or its generator and index, so that unnamed
+    // layouts don't give their models the same names
+    static QString entryName(const QJsonObject &entry, int index);
+
+    // Names an entry's "generator" may take
+    static QStringList generators();
+
+    // Up to count Poisson-disk points in a width by depth region, relative
+    // to its centre and no two closer than spacing. A region without a size
+    // is made roomy for the count. The scatter layout and the "scatter"
+    // repeat pattern both sample with it. Points come in tiles, filled on
+    // pool if given, each from its own seeded generator.
+    struct Point {
+        float x;
+        float y;
+    };
+    static QList<QList<Point>> scatterPoints(int count, double spacing, double width, double depth,
+                                             quint32 seed, QThreadPool *pool = nullptr);
+
+    static constexpr int kMaxModels = Scene::kMaxModels;  // Per entry, and per plan
+};
+
+} // namespace Burma
+
+#endif // BURMA_LAYOUTGENERATOR_H
@@ -0,0 +1,40 @@
+#ifndef BURMA_REPEATEXPANDER_H
+#define BURMA_REPEATEXPANDER_H
+
+#include <QJsonObject>
+
+#include "core/Scene.h"
+
+namespace Burma {
+
+/**
+ * @brief Expands "repeat" directives of a world plan into scene models
+ *
+ * A model with {"repeat":{"pattern":"grid","count":60,"spacing":2,...}}
+ * becomes count copies named name_0, name_1, ... laid out from its
+ * position, straight into the Scene rather than through JSON. Layouts are
+ * deterministic: scatter uses the directive's seed.
+ *
+ *  - array:   count copies along +x, spacing apart
+ *  - grid:    rows along +y (default about square), columns along +x
+ *  - ring:    count copies on a circle around the position, facing outwards
+ *  - scatter: count copies in a region (x by y) centred on the position,
+ *             never closer than spacing
+ */
+class RepeatExpander
+{
+public:
+    // Appends the copies a directive makes of prototype, at most maxModels,
+    // straight to scene, and returns how many
+    static int expand(const Scene::Model &prototype, const QJsonObject &repeat, Scene *scene,
+                      int maxModels = kMaxInstances);
+
+    // Copies produced by one model's directive (1 without a directive)
+    static int instanceCount(const QJsonObject &model);
+
+    static constexpr int kMaxInstances = 1000000;  // Per directive
+};
+
+} // namespace Burma
+
+#endif // BURMA_REPEATEXPANDER_H
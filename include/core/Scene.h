@@ -0,0 +1,163 @@
+#ifndef BURMA_SCENE_H
+#define BURMA_SCENE_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+class QThreadPool;
+
+namespace Burma {
+
+/**
+ * @brief Typed in-memory form of a world plan
+ *
+ * The JSON plan is converted once, with repeat directives expanded. Models
+ * are stored as parallel arrays (model i is entry i of each), so SDFBuilder,
+ * RvizConverter and the views read plain fields instead of looking up JSON
+ * keys. Names are interned. Copies share storage until one is modified.
+ */
+class Scene
+{
+public:
+    enum class Geometry : quint8 {
+        Box,
+        Sphere,
+        Cylinder,
+        Mesh,       // Read from SDF only; see meshUri()
+        Unknown     // Not in WorldPlanSchema::geometryTypes(); emitted without a shape
+    };
+
+    enum Flag : quint8 {
+        Static = 0x1,
+        Colored = 0x2   // Has a material; absent when the plan's color is empty or invalid
+    };
+
+    struct Vec3 {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+    };
+
+    struct Light {
+        QString name;
+        QString type;
+        Vec3 position;
+        QString diffuse;
+    };
+
+    struct Physics {
+        QString gravity = QStringLiteral("0 0 -9.81");
+        double maxStepSize = 0.001;
+        double realTimeFactor = 1.0;
+    };
+
+    // One model, for building a scene from something other than a plan
+    struct Model {
+        QString name;
+        Geometry geometry = Geometry::Box;
+        Vec3 position;
+        Vec3 rotation;
+        Vec3 scale{1.0f, 1.0f, 1.0f};
+        quint32 color = 0xFFFFFF;
+        bool hasColor = false;
+        bool isStatic = false;
+        QString meshUri;
+    };
+
+    // Layout generators run their rows on pool, if given, which must not be
+    // the pool the caller runs on. Listed, repeated and generated models
+    // together stop at kMaxModels.
+    static Scene fromPlan(const QJsonObject &plan, QThreadPool *pool = nullptr);
+
+    // Models only, e.g. the streamed preview of a plan
+    static Scene fromModels(const QJsonArray &models);
+
+    // Repeat directives are expanded; returns the models appended, at most
+    // maxModels
+    int appendModels(const QJsonArray &models, int maxModels = kMaxModels);
+    void append(const Model &model);
+    void reserve(qsizetype additional);
+    void clear();
+
+    void setWorldName(const QString &name) { m_worldName = name; }
+    void setPhysics(const Physics &physics) { m_physics = physics; }
+    void addLight(const Light &light) { m_lights.append(light); }
+
+    int size() const { return int(m_geometry.size()); }
+    bool isEmpty() const { return m_geometry.isEmpty(); }
+
+    // Per-model fields. Scale holds the shape's dimensions: box sizes, or the
+    // radius in x and the cylinder length in z.
+    const QString& name(int i) const { return m_names.at(m_nameIds.at(i)); }
+    quint32 nameId(int i) const { return m_nameIds.at(i); }
+    Geometry geometry(int i) const { return m_geometry.at(i); }
+    const Vec3& position(int i) const { return m_positions.at(i); }
+    const Vec3& rotation(int i) const { return m_rotations.at(i); }   // Roll, pitch, yaw in radians
+    const Vec3& scale(int i) const { return m_scales.at(i); }
+    quint32 color(int i) const { return m_colors.at(i); }                // 0xRRGGBB
+    bool isStatic(int i) const { return m_flags.at(i) & Static; }
+    bool hasColor(int i) const { return m_flags.at(i) & Colored; }
+    QString meshUri(int i) const { return m_meshUris.value(i); }
+
+    // Hash of every field a model's SDF depends on besides its name
+    size_t modelHash(int i) const;
+
+    // Same, leaving out the pose and static flag: models with equal bodies
+    // differ only in where they are placed
+    size_t bodyHash(int i) const;
+    bool sameBody(int i, int j) const;
+
+    // Edits of one model, e.g. from the property editor
+    void setPosition(int i, const Vec3 &position);
+    void setRotation(int i, const Vec3 &rotation);
+    void setScale(int i, const Vec3 &scale);
+    void setColor(int i, quint32 rgb);
+    void setStatic(int i, bool isStatic);
+
+    // First model with this name, or -1
+    int indexOf(const QString &name) const;
+
+    const QString& worldName() const { return m_worldName; }
+    const Physics& physics() const { return m_physics; }
+    const QList<Light>& lights() const { return m_lights; }
+
+    static Geometry geometryFromName(const QString &type);
+    static QString geometryName(Geometry geometry);
+
+    // "#RRGGBB", the plan's color format
+    static bool parseColor(const QString &name, quint32 *rgb);
+    static QString colorName(quint32 rgb);
+
+    static constexpr int kMaxModels = 1000000;  // Per plan
+
+private:
+    static Model modelFromPlan(const QJsonObject &model);
+    quint32 intern(const QString &name);
+
+    QString m_worldName;
+    Physics m_physics;
+    QList<Light> m_lights;
+
+    QList<quint32> m_nameIds;
+    QList<Geometry> m_geometry;
+    QList<Vec3> m_positions;
+    QList<Vec3> m_rotations;
+    QList<Vec3> m_scales;
+    QList<quint32> m_colors;
+    QList<quint8> m_flags;
+
+    // Only mesh models have one
+    QHash<int, QString> m_meshUris;
+
+    // Interned names, and the first model using each
+    QList<QString> m_names;
+    QList<int> m_firstModel;
+    QHash<QString, quint32> m_nameTable;
+};
+
+} // namespace Burma
+
+#endif // BURMA_SCENE_H
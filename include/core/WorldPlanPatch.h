@@ -0,0 +1,33 @@
+#ifndef BURMA_WORLDPLANPATCH_H
+#define BURMA_WORLDPLANPATCH_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+namespace Burma {
+
+/**
+ * @brief Edit patches for an existing world plan
+ *
+ * An edit prompt sends a compact summary of the current plan and gets back
+ * a list of add/remove/modify operations (see WorldPlanSchema::patchGrammar),
+ * which are applied here. Models the patch doesn't mention are left exactly
+ * as they were.
+ */
+class WorldPlanPatch
+{
+public:
+    // One short line per model, used as prompt context for edits
+    static QStringList summarize(const QJsonObject &plan);
+
+    // Apply a validated patch in order. Returns false if no operation matched
+    // the plan; changedModels receives the names that were added, removed or
+    // modified.
+    static bool apply(QJsonObject &plan, const QJsonObject &patch,
+                      QStringList *changedModels = nullptr, QString *error = nullptr);
+};
+
+} // namespace Burma
+
+#endif // BURMA_WORLDPLANPATCH_H
@@ -0,0 +1,116 @@
+#ifndef BURMA_WORLDPLANSCHEMA_H
+#define BURMA_WORLDPLANSCHEMA_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QJsonObject>
+
+namespace Burma {
+
+// Key names of the world plan JSON, shared by the prompt, grammar and SDFBuilder
+namespace PlanKey {
+inline const QString WorldName = QStringLiteral("world_name");
+inline const QString Models = QStringLiteral("models");
+inline const QString Lighting = QStringLiteral("lighting");
+inline const QString Physics = QStringLiteral("physics");
+inline const QString Name = QStringLiteral("name");
+inline const QString Type = QStringLiteral("type");
+inline const QString Position = QStringLiteral("position");
+inline const QString Rotation = QStringLiteral("rotation");
+inline const QString Scale = QStringLiteral("scale");
+inline const QString Color = QStringLiteral("color");
+inline const QString Static = QStringLiteral("static");
+inline const QString Diffuse = QStringLiteral("diffuse");
+inline const QString Gravity = QStringLiteral("gravity");
+inline const QString MaxStepSize = QStringLiteral("max_step_size");
+inline const QString RealTimeFactor = QStringLiteral("real_time_factor");
+inline const QString Repeat = QStringLiteral("repeat");
+inline const QString Pattern = QStringLiteral("pattern");
+inline const QString Count = QStringLiteral("count");
+inline const QString Spacing = QStringLiteral("spacing");
+inline const QString Rows = QStringLiteral("rows");
+inline const QString Radius = QStringLiteral("radius");
+inline const QString Region = QStringLiteral("region");
+inline const QString Seed = QStringLiteral("seed");
+inline const QString Generators = QStringLiteral("generators");
+inline const QString Generator = QStringLiteral("generator");
+inline const QString Columns = QStringLiteral("columns");
+inline const QString Levels = QStringLiteral("levels");
+inline const QString Density = QStringLiteral("density");
+inline const QString Operations = QStringLiteral("operations");
+inline const QString Op = QStringLiteral("op");
+inline const QString Model = QStringLiteral("model");
+}
+
+// Operations of an edit patch: {"operations":[{"op":"modify","name":...}, ...]}
+namespace PatchOp {
+inline const QString Add = QStringLiteral("add");          // {"op","model"}
+inline const QString Remove = QStringLiteral("remove");    // {"op","name"}
+inline const QString Modify = QStringLiteral("modify");    // {"op","name", changed model fields...}
+}
+
+/**
+ * @brief Single definition of the world plan format
+ *
+ * The GBNF grammar passed to BitNet.cpp, the validation of parsed
+ * responses and the geometry kinds understood by SDFBuilder are all
+ * derived from this tree, so the decoder can only produce plans the
+ * builder knows how to emit.
+ */
+class WorldPlanSchema
+{
+public:
+    enum class Kind {
+        Object,
+        Array,
+        String,
+        Number,
+        Boolean,
+        Enum,
+        Color
+    };
+
+    struct Node {
+        QString name;
+        Kind kind = Kind::String;
+        bool required = true;        // Optional fields are accepted but never generated...
+        bool offered = false;        // ...unless offered, then the grammar allows them too
+        int minItems = 0;            // Arrays only
+        QStringList values;          // Enums only
+        QList<Node> children;        // Object fields, or the single array element
+    };
+
+    static const Node& root();
+
+    // Element of the models array
+    static const Node& modelNode();
+
+    // GBNF grammar accepting the required and offered structure of root()
+    static QString grammar();
+
+    // Structural check of a parsed plan against root()
+    static bool validate(const QJsonObject &plan, QString *error = nullptr);
+
+    // Grammar and check for edit patches; models inside them follow modelNode()
+    static QString patchGrammar();
+    static bool validatePatch(const QJsonObject &patch, QString *error = nullptr);
+
+    // Geometry kinds a model "type" may take
+    static QStringList geometryTypes();
+
+    // Layouts a model "repeat" directive may request, expanded by RepeatExpander
+    static QStringList repeatPatterns();
+
+    // Layouts a "generators" entry may name, built by LayoutGenerator
+    static QStringList layoutGenerators();
+
+private:
+    static QString ruleFor(const Node &node, const QString &ruleName, QStringList &rules);
+    static bool validateValue(const Node &node, const QJsonValue &value,
+                              const QString &path, QString *error);
+};
+
+} // namespace Burma
+
+#endif // BURMA_WORLDPLANSCHEMA_H
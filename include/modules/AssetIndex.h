@@ -0,0 +1,73 @@
+#ifndef BURMA_ASSETINDEX_H
+#define BURMA_ASSETINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QFile>
+
+namespace Burma {
+
+/**
+ * @brief Local retrieval index over the Fuel asset catalog
+ *
+ * Names, tags and descriptions are embedded with feature hashing (word and
+ * character trigram features in a fixed number of dimensions), quantized
+ * to int8 and grouped into inverted lists around k-means centroids. The
+ * file is memory-mapped as is, so loading costs no parsing, and a query
+ * only scans the few lists nearest to it.
+ */
+class AssetIndex
+{
+public:
+    struct Asset {
+        QString name;
+        QString owner;
+        QString description;
+        QStringList tags;
+        QString dimensions;     // "w x d x h" in metres, empty if unknown
+    };
+
+    struct Match {
+        QString summary;        // One prompt line: name, owner and size
+        float score = 0.0f;     // Cosine similarity
+    };
+
+    static constexpr int kDimensions = 256;
+
+    AssetIndex();
+    ~AssetIndex();
+
+    AssetIndex(const AssetIndex&) = delete;
+    AssetIndex& operator=(const AssetIndex&) = delete;
+
+    // Write an index for assets to path; safe while another instance maps the old file
+    static bool build(const QList<Asset> &assets, const QString &path, QString *error = nullptr);
+
+    bool load(const QString &path);
+    void unload();
+    bool isLoaded() const { return m_header != nullptr; }
+    int size() const;
+
+    QList<Match> search(const QString &query, int k) const;
+
+    // Summaries of the best matches, ready to pass as prompt context
+    QStringList contextFor(const QString &query, int k) const;
+
+private:
+    struct Header;
+
+    QFile m_file;
+    uchar *m_data;
+    const Header *m_header;
+    const float *m_centroids;
+    const quint32 *m_listOffsets;
+    const float *m_scales;
+    const qint8 *m_vectors;
+    const quint32 *m_textOffsets;
+    const char *m_text;
+};
+
+} // namespace Burma
+
+#endif // BURMA_ASSETINDEX_H
@@ -0,0 +1,61 @@
+#ifndef BURMA_BITNETCALIBRATOR_H
+#define BURMA_BITNETCALIBRATOR_H
+
+#include <QObject>
+#include <QString>
+#include <QProcess>
+#include <QList>
+
+namespace Burma {
+
+/**
+ * @brief Finds the fastest thread count and batch size for this CPU
+ *
+ * Runs llama-bench over a grid of thread counts and batch sizes with a
+ * short prompt-eval and generation test, then picks the combination with
+ * the lowest estimated time for a typical world plan request.
+ */
+class BitNetCalibrator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        int threads = 0;
+        int batchSize = 0;
+        double promptTokensPerSec = 0.0;
+        double generationTokensPerSec = 0.0;
+    };
+
+    explicit BitNetCalibrator(QObject *parent = nullptr);
+    ~BitNetCalibrator() override;
+
+    // Benchmark the model with the llama-bench binary at benchPath
+    bool start(const QString &benchPath, const QString &modelPath);
+    bool isRunning() const { return m_process->state() != QProcess::NotRunning; }
+
+    // Grid searched by start()
+    static QList<int> threadCandidates();
+    static QList<int> batchCandidates();
+
+    // Settings group for a calibration: one per CPU model and model file
+    static QString settingsGroup(const QString &modelPath);
+    static QString cpuModel();
+
+signals:
+    void finished(const BitNetCalibrator::Result &result);
+    void failed(const QString &error);
+
+private slots:
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+
+private:
+    bool parseResults(const QByteArray &json, Result *result, QString *error) const;
+
+    QProcess *m_process;
+};
+
+} // namespace Burma
+
+#endif // BURMA_BITNETCALIBRATOR_H
@@ -5,9 +5,23 @@
 #include <QString>
 #include <QProcess>
 #include <QJsonObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QHash>
+#include <QPointer>
+#include <QThread>
+
+#include "modules/BitNetWorker.h"
+#include "modules/InferenceMetrics.h"
+#include "utils/JsonStreamParser.h"
 
 namespace Burma {
 
+class BitNetCalibrator;
+class ResponseCache;
+class AssetIndex;
+class InferenceMetricsLog;
+
 /**
  * @brief Client for communicating with BitNet.cpp LLM
  *
@@ -19,39 +33,284 @@ class BitNetClient : public QObject
     Q_OBJECT
 
 public:
+    using JobId = quint64;
+
+    // Interactive prompts run ahead of any queued batch job
+    enum class Priority {
+        Interactive,
+        Batch
+    };
+
     explicit BitNetClient(QObject *parent = nullptr);
     ~BitNetClient() override;
 
     // BitNet.cpp configuration
     void setBitNetPath(const QString &path);
     void setModelPath(const QString &path);
+    const QString& modelPath() const { return m_modelPath; }
+
+    // CPU settings for inference; defaults until a calibration is applied
+    void setInferenceSettings(int threads, int batchSize);
+    int threads() const { return m_threads; }
+    int batchSize() const { return m_batchSize; }
+
+    // Speculative decoding on the resident workers. The draft model must share
+    // the main model's vocabulary; an empty path disables it.
+    void setDraftModel(const QString &path, int draftLength);
+    const QString& draftModelPath() const { return m_draftModelPath; }
+
+    // Benchmark thread counts and batch sizes on this CPU with llama-bench.
+    // Queued prompts wait until it finishes so they don't skew the results,
+    // unless holdJobs is false; they then run on the current settings. Such
+    // a background run starts after the warm-up, and its result is applied
+    // once the workers are idle rather than restarting busy ones.
+    bool calibrate(bool holdJobs = true);
+    bool isCalibrating() const;
+
+    // Resident workers: keep the model loaded between prompts
+    void setWorkerEnabled(bool enabled);
+    bool isWorkerEnabled() const { return m_workerEnabled; }
+    void startWorker();
+
+    // Prefetch the model file into the page cache on a low-priority thread,
+    // then start the resident workers and evaluate the shared prompt prefix
+    // once, so the first real prompt runs at steady-state speed
+    void warmUp();
+    bool isWarm() const { return m_warm; }
+    bool isWarmingUp() const { return m_warmUpRequested && !m_warm; }
+
+    // Number of resident workers; threads are split across them and each
+    // worker is pinned to its own cores when there is more than one
+    void setWorkerPoolSize(int size);
+    int workerPoolSize() const { return m_poolSize; }
+
+    // Throughput and per-worker utilization of the pool
+    QString poolStatistics() const;
+
+    // Queue a prompt; the returned ID is carried by every signal for this job.
+    // Returns 0 if the prompt could not be queued.
+    JobId submitPrompt(const QString &prompt, const QStringList &context = QStringList(),
+                       Priority priority = Priority::Interactive, bool bypassCache = false);
+
+    // Queue an edit of currentPlan; the result arrives as worldPatchGenerated
+    // with add/remove/modify operations for WorldPlanPatch::apply
+    JobId submitEdit(const QString &instruction, const QJsonObject &currentPlan,
+                     Priority priority = Priority::Interactive, bool bypassCache = false);
+
+    // Queue count variations of one prompt, e.g. for domain randomization.
+    // Variant i samples with seed firstSeed + i. A resident llama-server
+    // decodes them together in one batched run with parallel slots; without
+    // one they run one after another. Each valid plan arrives as
+    // variantGenerated, then variantsFinished reports the totals. Batches
+    // run on the pool's cores while it is idle; an interactive prompt stops
+    // the running batch, whose variants then start over.
+    JobId submitVariants(const QString &prompt, int count, int firstSeed,
+                         const QStringList &context = QStringList(),
+                         Priority priority = Priority::Batch);
+
+    // Drop a queued job, or stop a running one immediately
+    bool cancelJob(JobId jobId);
+
+    int queuedJobCount() const { return m_queue.size(); }
+    bool isBusy() const { return !m_activeJobs.isEmpty(); }
 
-    // Process user prompt
-    void processPrompt(const QString &prompt, const QStringList &context = QStringList());
+    // Fuel assets nearest to each prompt are added to its context; not owned
+    void setAssetIndex(const AssetIndex *index) { m_assetIndex = index; }
+
+    // Size cap of the on-disk response cache
+    void setResponseCacheLimit(qint64 maxBytes);
 
     // Check if client is ready
     bool isReady() const { return m_isReady; }
 
 signals:
-    void worldPlanGenerated(const QJsonObject &worldPlan);
-    void errorOccurred(const QString &error);
-    void processingStarted();
-    void processingFinished();
+    void worldPlanGenerated(quint64 jobId, const QJsonObject &worldPlan);
+    void worldPatchGenerated(quint64 jobId, const QJsonObject &patch);
+    void modelReceived(quint64 jobId, const QJsonObject &model);  // Streamed as soon as each entry is parsed
+    void variantGenerated(quint64 jobId, int index, int seed, const QJsonObject &worldPlan);
+    void variantsFinished(quint64 jobId, int generated, int requested, qint64 elapsedMs);
+    void errorOccurred(quint64 jobId, const QString &error);
+    void processingStarted(quint64 jobId);
+    void processingFinished(quint64 jobId);   // Every job ends with it, even one cancelled while queued
+    void jobCancelled(quint64 jobId);
+    void calibrationFinished(int threads, int batchSize, double promptTokensPerSec,
+                             double generationTokensPerSec);
+    void calibrationFailed(const QString &error);
+    void warmUpStarted();
+    void warmUpFinished(qint64 elapsedMs);
+
+    // Stage timings of every finished inference, also appended to the metrics file
+    void inferenceMetricsReady(const Burma::InferenceMetrics &metrics);
 
 private slots:
     void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
     void onProcessError(QProcess::ProcessError error);
+    void onProcessOutput();
 
 private:
-    void runInference(const QString &prompt);
-    QJsonObject parseResponse(const QString &output);
+    struct PromptJob {
+        JobId id = 0;
+        Priority priority = Priority::Interactive;
+        QString prompt;
+        QStringList context;
+        bool bypassCache = false;
+        bool edit = false;           // Context is a plan summary, result is a patch
+        int seed = -1;               // Sampling seed; -1 uses the default
+        JobId variantOf = 0;         // Variant run this job belongs to, if any
+        int variantIndex = -1;
+        bool cacheChecked = false;
+        bool started = false;        // processingStarted already emitted
+        int workerFailures = 0;
+        int streamedModels = 0;      // modelReceived already emitted, kept across retries
+        QString fullPrompt;
+        QString cacheKey;
+        QJsonObject cachedPlan;
+    };
+
+    // Runtime state of a job being generated
+    struct ActiveJob {
+        explicit ActiveJob(const PromptJob &promptJob);
+
+        PromptJob job;
+        BitNetWorker *worker = nullptr;   // nullptr: one-shot llama-cli run
+        JsonStreamParser parser;
+        QByteArray output;
+        QElapsedTimer timer;
+        int parsedModels = 0;             // Entries parsed in this attempt
+        QElapsedTimer evalTimer;          // Restarted for each attempt
+        qint64 promptEvalMs = -1;         // Time to the first generated bytes
+        bool prefixReused = false;        // Template prefix came from the KV cache
+        int tokenEvents = 0;              // Streamed worker events, about one per token
+        InferenceMetrics metrics;         // Filled in as the stages complete
+        bool stopRequested = false;
+        bool cancelled = false;
+    };
+
+    // Progress of a submitVariants call
+    struct VariantRun {
+        int requested = 0;
+        int pending = 0;
+        int generated = 0;
+        bool started = false;
+        QElapsedTimer timer;
+    };
+
+    JobId enqueueJob(PromptJob job);
+    void emitResult(const PromptJob &job, const QJsonObject &result);
+    void emitStarted(PromptJob &job);
+    void emitFinished(const PromptJob &job);
+    void emitCancelled(const PromptJob &job);
+    static int samplingSeed(const PromptJob &job);
+    BitNetWorker::Config workerConfig() const;
+    QJsonObject workerRequest(const ActiveJob *active) const;
+    BitNetWorker* variantWorker();
+    void runVariantBatch(BitNetWorker *worker);
+    void onVariantBatchFinished(BitNetWorker *worker, const QList<QJsonObject> &responses);
+    QList<ActiveJob*> jobsForWorker(BitNetWorker *worker) const;
+    void scheduleJobs();
+    bool serveFromCache(PromptJob &job);
+    ActiveJob* activateJob(const PromptJob &job);
+    void finishJob(ActiveJob *active);
+    void requeueJob(ActiveJob *active);
+    ActiveJob* jobForWorker(BitNetWorker *worker) const;
+    BitNetWorker* leastLoadedWorker() const;
+    bool workersPending() const;
+    bool poolBusy() const;
+    void preemptVariantBatch();
+    void runInference(ActiveJob *active);
+    void runWorkerInference(ActiveJob *active, BitNetWorker *worker);
+    void handleOutput(ActiveJob *active, const QByteArray &output);
+    void beginStream(ActiveJob *active);
+    bool feedStream(ActiveJob *active, const QByteArray &bytes);
+    void resetWorkers();
+    void recordPromptEval(ActiveJob *active);
+    void onPrefetchFinished(qint64 prefetchMs);
+    void primeWorker(BitNetWorker *worker);
+    void finishWarmUp();
+    void applyCalibration();
+    void reportMetrics(ActiveJob *active);
+    QString promptCachePath(bool edit);
+
+    void onWorkerTokens(BitNetWorker *worker, const QString &text);
+    void onWorkerReady(BitNetWorker *worker, qint64 loadTimeMs);
+    void onWorkerUnavailable(BitNetWorker *worker, const QString &reason);
+    void onWorkerCompletion(BitNetWorker *worker, const QString &content, const QJsonObject &response);
+    void onWorkerFailed(BitNetWorker *worker, const QString &error);
+    QJsonObject parseResponse(const QByteArray &output, bool edit);
+    static QString worldPlanPromptPrefix();
+    static QString editPromptPrefix();
     QString createWorldPlanPrompt(const QString &prompt, const QStringList &context);
+    QString createEditPrompt(const QString &instruction, const QStringList &summary);
     QJsonObject createFallbackWorld();  // Create simple default world when BitNet fails
+    QString grammarFilePath(bool edit);
+    QString cacheKey(const PromptJob &job);
+    QString modelStamp();
+    void recordOutcome(bool accepted, qint64 elapsedMs);
 
     QProcess *m_process;
     QString m_bitnetCliPath;
     QString m_modelPath;
     bool m_isReady;
+    int m_threads;
+    int m_batchSize;
+    QString m_draftModelPath;
+    int m_draftLength;
+    BitNetCalibrator *m_calibrator;
+    bool m_calibrationHoldsJobs;
+    bool m_calibrationDeferred;     // Background run waiting for the warm-up
+    int m_calibratedThreads;        // Background result waiting for idle workers, 0 if none
+    int m_calibratedBatchSize;
+
+    QList<BitNetWorker*> m_workers;
+    bool m_workerEnabled;
+    int m_poolSize;
+
+    // Separate server with parallel slots for batched variant runs
+    BitNetWorker *m_variantWorker;
+    QHash<JobId, VariantRun> m_variantRuns;
+
+    // Startup warm-up
+    QPointer<QThread> m_prefetchThread;
+    QElapsedTimer m_warmUpTimer;
+    bool m_warmUpRequested;
+    bool m_warm;
+    QList<BitNetWorker*> m_primingWorkers;   // Evaluating the prompt prefix
+
+    // Job queue, ordered by priority then submission
+    QList<PromptJob> m_queue;
+    QList<ActiveJob*> m_activeJobs;
+    ActiveJob *m_oneShotJob;
+    JobId m_nextJobId;
+
+    // Pool throughput since the first job
+    QElapsedTimer m_poolTimer;
+    int m_completedJobs;
+
+    // Prompt evaluation time with and without a cached template prefix
+    struct PromptEvalStats {
+        qint64 coldMs = 0;
+        int coldRuns = 0;
+        qint64 warmMs = 0;
+        int warmRuns = 0;
+    };
+    PromptEvalStats m_workerPromptEval;
+    PromptEvalStats m_oneShotPromptEval;
+    qint64 m_draftTokens;         // Speculative decoding totals since startup
+    qint64 m_draftAccepted;
+    InferenceMetricsLog *m_metricsLog;
+    QHash<bool, QString> m_promptCacheFiles;   // Keyed by edit mode
+
+    // Grammar-constrained decoding statistics
+    QHash<bool, QString> m_grammarFiles;
+    int m_acceptedPlans;
+    int m_fallbackPlans;
+    qint64 m_wastedInferenceMs;
+
+    // Response cache for repeated prompts
+    ResponseCache *m_responseCache;
+    QString m_modelStamp;
+
+    const AssetIndex *m_assetIndex;
 };
 
 } // namespace Burma
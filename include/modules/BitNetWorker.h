@@ -0,0 +1,134 @@
+#ifndef BURMA_BITNETWORKER_H
+#define BURMA_BITNETWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QProcess>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QList>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+namespace Burma {
+
+/**
+ * @brief Resident BitNet.cpp inference worker
+ *
+ * Keeps one llama-server process alive with the model loaded, so prompts
+ * only pay for evaluation and generation. Requests and responses travel
+ * over a local HTTP socket bound to 127.0.0.1.
+ */
+class BitNetWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Settings fixed for the lifetime of the worker process
+    struct Config {
+        QString serverPath;
+        QString modelPath;
+        int contextSize = 1024;
+        int threads = 4;
+        int batchSize = 512;
+        QString cpuList;   // taskset CPU list, e.g. "0-3"; empty leaves placement to the OS
+        QString draftModelPath;   // Small model for speculative decoding; empty disables it
+        int draftLength = 8;      // Tokens drafted per verification batch
+        int parallelSlots = 1;    // Sequences decoded together; contextSize is per slot
+    };
+
+    enum class State {
+        Stopped,
+        Loading,
+        Ready,
+        Busy,
+        Failed
+    };
+
+    explicit BitNetWorker(const Config &config, QObject *parent = nullptr);
+    ~BitNetWorker() override;
+
+    // Launch llama-server and wait for the model to load
+    void start();
+    void stop();
+
+    // Send a streaming /completion request; only valid while ready
+    bool complete(const QJsonObject &request);
+
+    // Send several non-streaming requests at once. With parallel slots
+    // llama-server decodes them together in one batch; only valid while ready.
+    bool completeBatch(const QList<QJsonObject> &requests);
+
+    // Abort the in-flight request or batch and stop its generation
+    void cancel();
+
+    const Config& config() const { return m_config; }
+    State state() const { return m_state; }
+    bool isReady() const { return m_state == State::Ready; }
+    bool isAvailable() const { return m_state == State::Ready || m_state == State::Busy; }
+    qint64 modelLoadTimeMs() const { return m_loadTimeMs; }
+
+    // Time spent serving requests, for pool utilization
+    qint64 busyTimeMs() const;
+    int completedRequests() const { return m_completedRequests; }
+
+    // Requests sent since the server started; after the first one the
+    // shared prompt prefix is already in the slot's KV cache
+    int requestCount() const { return m_requestCount; }
+
+signals:
+    void ready(qint64 loadTimeMs);
+    void tokensReceived(const QString &text);
+    void unavailable(const QString &reason);
+    void completionFinished(const QString &content, const QJsonObject &response);
+    void completionFailed(const QString &error);
+    void batchFinished(const QList<QJsonObject> &responses);   // In request order; a failed one is empty
+
+private slots:
+    void onHealthCheck();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+
+private:
+    int findFreePort() const;
+    void fail(const QString &reason);
+    void markIdle();
+    void readStreamEvents(QNetworkReply *reply);
+    void abortRequests();
+
+    Config m_config;
+    State m_state;
+    int m_port;
+
+    QProcess *m_process;
+    QNetworkAccessManager *m_networkManager;
+    QNetworkReply *m_activeReply;
+    QTimer *m_healthTimer;
+
+    // Server-sent events of the in-flight request
+    QByteArray m_eventBuffer;
+    QString m_content;
+    QJsonObject m_finalEvent;
+
+    // Requests of the in-flight batch and the responses collected so far
+    QList<QNetworkReply*> m_batchReplies;
+    QList<QJsonObject> m_batchResponses;
+    int m_batchPending;
+
+    // Last few KB of the server's log
+    QByteArray m_logTail;
+
+    QElapsedTimer m_loadTimer;
+    qint64 m_loadTimeMs;
+
+    QElapsedTimer m_busyTimer;
+    qint64 m_busyMs;
+    int m_completedRequests;
+    int m_requestCount;
+};
+
+} // namespace Burma
+
+#endif // BURMA_BITNETWORKER_H
@@ -7,6 +7,8 @@
 #include <QNetworkReply>
 #include <QJsonArray>
 
+#include "modules/AssetIndex.h"
+
 namespace Burma {
 
 /**
@@ -34,20 +36,45 @@ public:
     // Get local model path
     QString getLocalModelPath(const QString &modelName) const;
 
+    // Where downloaded models are kept, one directory per model
+    QString modelCacheDirectory() const { return m_cacheDirectory; }
+
+    // Download the full Fuel model catalog into the cache, page by page
+    void syncCatalog();
+    bool hasCatalog() const;
+    QString catalogPath() const;
+
+    // Synced catalog entries plus every locally cached model. Reads only the
+    // given files, so it can run on any thread.
+    static QList<AssetIndex::Asset> catalogAssets(const QString &catalogPath,
+                                                  const QString &cacheDirectory);
+
+    // Build the retrieval index in the background; emits assetIndexReady
+    void rebuildAssetIndex(const QString &indexPath);
+
 signals:
     void searchResultsReady(const QJsonArray &results);
     void downloadProgress(int percentage);
     void downloadComplete(const QString &modelPath);
     void errorOccurred(const QString &error);
+    void catalogSynced(int modelCount);
+    void assetIndexReady(const QString &indexPath);
 
 private slots:
     void onSearchFinished();
     void onDownloadFinished();
     void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void onCatalogPageFinished();
 
 private:
     QString getCacheDirectory() const;
     void ensureCacheDirectory();
+    void requestCatalogPage(int page);
+    static AssetIndex::Asset localAsset(const QString &modelDirectory);
+
+    // Catalog sync in progress
+    QJsonArray m_catalog;
+    bool m_syncingCatalog;
 
     QNetworkAccessManager *m_networkManager;
     QString m_fuelApiBase;
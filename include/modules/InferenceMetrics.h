@@ -0,0 +1,74 @@
+#ifndef BURMA_INFERENCEMETRICS_H
+#define BURMA_INFERENCEMETRICS_H
+
+#include <QString>
+#include <QJsonObject>
+#include <QMetaType>
+
+namespace Burma {
+
+/**
+ * @brief Latency breakdown of one BitNet request
+ *
+ * Stage timings come from llama.cpp where it reports them (the timings
+ * block of llama-server, or the timing summary llama-cli prints on
+ * stderr) and from our own timestamps otherwise. Unknown values are -1.
+ */
+struct InferenceMetrics
+{
+    quint64 jobId = 0;
+    QString backend;                    // "worker", "batch" or "one-shot"
+    QString outcome;                    // "ok", "fallback", "rejected", "failed" or "cancelled"
+    int exitCode = 0;                   // llama-cli exit code; 0 for other backends
+
+    double modelLoadMs = -1;            // 0 when the model was already resident
+    double promptEvalMs = -1;
+    int promptTokens = -1;
+    double promptTokensPerSec = -1;
+    int generatedTokens = -1;
+    double generationMs = -1;
+    double generationTokensPerSec = -1;
+    qint64 timeToFirstTokenMs = -1;
+    int draftTokens = -1;               // Speculative decoding: tokens proposed by the draft model
+    int draftAccepted = -1;             // ...and how many of them the main model kept
+    qint64 totalMs = -1;
+
+    // Fill the stage timings from a llama-server "timings" object
+    void applyServerTimings(const QJsonObject &timings);
+
+    // Fill the stage timings from llama-cli's stderr timing summary
+    bool applyCliTimings(const QString &stderrText);
+
+    double draftAcceptanceRate() const;
+
+    QJsonObject toJson() const;
+
+    // Short one-line form for the status bar and the log
+    QString summary() const;
+};
+
+/**
+ * @brief Rolling JSON-lines file of inference metrics
+ *
+ * Once the file exceeds its size cap it is renamed to a ".1" backup,
+ * replacing the previous one, and a new file is started.
+ */
+class InferenceMetricsLog
+{
+public:
+    InferenceMetricsLog(const QString &path, qint64 maxBytes);
+
+    void append(const InferenceMetrics &metrics);
+
+    const QString& path() const { return m_path; }
+
+private:
+    QString m_path;
+    qint64 m_maxBytes;
+};
+
+} // namespace Burma
+
+Q_DECLARE_METATYPE(Burma::InferenceMetrics)
+
+#endif // BURMA_INFERENCEMETRICS_H
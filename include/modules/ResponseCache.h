@@ -0,0 +1,49 @@
+#ifndef BURMA_RESPONSECACHE_H
+#define BURMA_RESPONSECACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+namespace Burma {
+
+/**
+ * @brief Content-addressed on-disk cache of generated world plans
+ *
+ * Each entry is one JSON file named by the SHA-256 of everything that
+ * influences the generation. File modification times double as LRU
+ * stamps; the oldest entries are evicted once the size cap is exceeded.
+ */
+class ResponseCache
+{
+public:
+    ResponseCache(const QString &directory, qint64 maxBytes);
+
+    // SHA-256 over the given key parts
+    static QString makeKey(const QStringList &parts);
+
+    bool lookup(const QString &key, QJsonObject *plan);
+    void store(const QString &key, const QJsonObject &plan);
+
+    void setMaxBytes(qint64 maxBytes);
+    qint64 maxBytes() const { return m_maxBytes; }
+    qint64 totalBytes() const { return m_totalBytes; }
+
+    const QString& directory() const { return m_directory; }
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+private:
+    QString entryPath(const QString &key) const;
+    void evict();
+
+    QString m_directory;
+    qint64 m_maxBytes;
+    qint64 m_totalBytes;
+    int m_hits;
+    int m_misses;
+};
+
+} // namespace Burma
+
+#endif // BURMA_RESPONSECACHE_H
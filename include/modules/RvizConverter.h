@@ -3,9 +3,12 @@
 
 #include <QObject>
 #include <QString>
+#include <QPointF>
 
 namespace Burma {
 
+class Scene;
+
 /**
  * @brief Converts Gazebo worlds to RViz-compatible map formats
  *
@@ -20,8 +23,9 @@ public:
     explicit RvizConverter(QObject *parent = nullptr);
     ~RvizConverter() override = default;
 
-    // Convert world to RViz map
-    void convertWorld(const QString &worldFile, const QString &outputDir,
+    // Convert world to RViz map; the map is centred on the world origin and
+    // every model's footprint is marked occupied
+    void convertWorld(const Scene &scene, const QString &outputDir, const QString &baseName,
                      double resolution = 0.05, int width = 2000, int height = 2000);
 
 signals:
@@ -30,7 +34,7 @@ signals:
     void conversionError(const QString &error);
 
 private:
-    bool generateOccupancyGrid(const QString &worldFile, const QString &pgmFile,
+    bool generateOccupancyGrid(const Scene &scene, const QString &pgmFile,
                               double resolution, int width, int height);
     bool generateYamlMetadata(const QString &yamlFile, const QString &pgmFile,
                              double resolution, int width, int height);
@@ -5,13 +5,25 @@
 #include <QString>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QMutex>
+
+#include "core/Scene.h"
+#include "modules/SDFFragmentCache.h"
+
+class QThreadPool;
 
 namespace Burma {
 
+class WorldStore;
+
 /**
  * @brief Builds SDF world files from JSON world plans
  *
- * Converts LLM-generated world plans into valid Gazebo SDF format
+ * Converts LLM-generated world plans into valid Gazebo SDF format. Large
+ * worlds are formatted on a pool with one thread per core, and edits of the
+ * world last written only re-emit the models that changed. Saved worlds can
+ * write each body shared by several models once and <include> it per model.
+ * Generated worlds are kept in a WorldStore, named by their content.
  */
 class SDFBuilder : public QObject
 {
@@ -19,10 +31,65 @@ class SDFBuilder : public QObject
 
 public:
     explicit SDFBuilder(QObject *parent = nullptr);
-    ~SDFBuilder() override = default;
+    ~SDFBuilder() override;
 
     // Build SDF from JSON world plan
     QString buildWorldSDF(const QJsonObject &worldPlan);
+    QString buildWorldSDF(const Scene &scene);
+    QByteArray buildWorldUtf8(const Scene &scene);
+
+    // Scene::fromPlan() on the job thread, with layout generators on the
+    // pool; reports through sceneBuilt with the returned request ID
+    quint64 buildSceneAsync(const QJsonObject &worldPlan);
+
+    // Stream the world straight to a file without building it in memory
+    bool writeWorld(const Scene &scene, const QString &filePath);
+
+    // Rewrite the world, re-emitting only models changed since the last
+    // update; worlds above kMaxCachedModels are streamed by writeWorld()
+    static constexpr int kMaxCachedModels = 250000;
+    bool updateWorld(const Scene &scene, const QString &filePath);
+
+    // updateWorld() on a background thread; requests run in the order they
+    // were made and report through buildComplete or buildError
+    void writeWorldAsync(const Scene &scene, const QString &filePath);
+
+    // Write the world into the store unless it is already there
+    bool storeWorld(const Scene &scene, QString *filePath);
+
+    // storeWorld() on the job thread; reports through worldStored with the
+    // returned request ID, or buildError
+    quint64 storeWorldAsync(const Scene &scene);
+
+    // Cap on the store, beyond which the least recently used worlds go
+    static constexpr qint64 kDefaultStoreBytes = 1024LL * 1024 * 1024;
+    void setStoreLimit(qint64 maxBytes);
+
+    // For a stored world being edited; entries themselves never change
+    QString workingWorldPath() const;
+
+    struct InstancingStats {
+        int bodies = 0;             // Shared bodies written as model directories
+        int instances = 0;          // Models written as includes of them
+        qint64 bytesWritten = 0;    // World file and model directories
+        qint64 bytesSaved = 0;      // Against writeWorld() of the same scene
+    };
+
+    // Bodies used by at least kMinInstances models go to model directories
+    // in "<world>_models" next to the world file, included by relative URI.
+    // The directory is replaced on every write.
+    static constexpr int kMinInstances = 2;
+    bool writeInstancedWorld(const Scene &scene, const QString &filePath,
+                             InstancingStats *stats = nullptr);
+
+    // Save on the job thread, instanced unless that is turned off
+    void saveWorldAsync(const Scene &scene, const QString &filePath);
+    bool instancingEnabled() const { return m_instancing; }
+    void setInstancingEnabled(bool enabled) { m_instancing = enabled; }
+
+    // Threads formatting large worlds; defaults to one per core
+    int threadCount() const;
+    void setThreadCount(int count);
 
     // Save SDF to file
     bool saveToFile(const QString &sdfContent, const QString &filePath);
@@ -33,20 +100,21 @@ public:
 signals:
     void buildComplete(const QString &sdfFilePath);
     void buildError(const QString &error);
+    void worldStored(quint64 requestId, const QString &filePath);
+    void sceneBuilt(quint64 requestId, const Scene &scene);
 
 private:
-    QString generateWorldHeader(const QString &worldName);
-    QString generatePhysicsSection(const QJsonObject &physicsData);
-    QString generateLightingSection(const QJsonArray &lights);
-    QString generateModelsSection(const QJsonArray &models);
-    QString generateModelElement(const QJsonObject &model);
-
-    QString generatePoseElement(const QJsonObject &position, const QJsonObject &rotation);
-    QString generateScaleElement(const QJsonObject &scale);
-    QString generateVisualElement(const QJsonObject &model);
-    QString generateCollisionElement(const QJsonObject &model);
-
-    QString escapeXML(const QString &text);
+    QThreadPool *m_pool;
+    QThreadPool *m_jobs;
+    bool m_instancing;
+    quint64 m_storeRequests;
+    quint64 m_sceneRequests;
+
+    // Models of the last world updated or stored, and the store; shared by
+    // the GUI and job threads
+    QMutex m_cacheMutex;
+    SDFFragmentCache m_cache;
+    WorldStore *m_store;
 };
 
 } // namespace Burma
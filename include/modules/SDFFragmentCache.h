@@ -0,0 +1,88 @@
+#ifndef BURMA_SDFFRAGMENTCACHE_H
+#define BURMA_SDFFRAGMENTCACHE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include "core/Scene.h"
+
+class QIODevice;
+class QThreadPool;
+
+namespace Burma {
+
+/**
+ * @brief SDF of each model in the last world written, for incremental updates
+ *
+ * Every <model> element is kept with the Scene::modelHash() it was formatted
+ * from, keyed by the model's name and, for repeated names, its occurrence.
+ * Writing the scene again formats only the models whose hash changed. If the
+ * model list and header are unchanged and each new element fits in the
+ * bytes of the old one, those bytes are patched in the existing file, padded
+ * with spaces when shorter. Otherwise the file is rewritten from the cached
+ * elements, which costs a copy but no formatting. The world can also be
+ * written from the cache to any other device, e.g. to hash it.
+ */
+class SDFFragmentCache
+{
+public:
+    struct Stats {
+        int formatted = 0;
+        int reused = 0;
+        bool patchedInPlace = false;
+        qint64 bytesWritten = 0;
+    };
+
+    // Formats the models that changed since the last update, on pool when
+    // it is given
+    void update(const Scene &scene, QThreadPool *pool = nullptr, Stats *stats = nullptr);
+
+    // The world as last updated
+    bool write(QIODevice *device) const;
+
+    // update(), then bring the file up to date
+    bool writeWorld(const Scene &scene, const QString &filePath, QThreadPool *pool = nullptr,
+                    Stats *stats = nullptr, QString *error = nullptr);
+
+    // Whatever file was written last is no longer patched in place
+    void forgetFile();
+
+    void clear();
+    int size() const { return int(m_fragments.size()); }
+
+private:
+    using Key = QPair<QString, int>;   // Name, occurrence of the name
+
+    struct Fragment {
+        Key key;
+        size_t hash = 0;
+        QByteArray sdf;
+        qint64 offset = -1;     // Where it starts in the file
+        qsizetype slot = 0;     // Bytes it occupies there, padding included
+    };
+
+    void formatFragments(const Scene &scene, QThreadPool *pool);
+    bool patchFile(const QString &filePath, Stats *stats, QString *error);
+    bool rewriteFile(const QString &filePath, Stats *stats, QString *error);
+
+    // The file as it was left, to notice when something else rewrote it
+    QString m_filePath;
+    qint64 m_fileSize = 0;
+    QDateTime m_fileModified;
+    QByteArray m_header;
+    QList<Fragment> m_fragments;
+    QHash<Key, int> m_index;
+
+    // Of the last update: whether the header and model list were as before,
+    // and the models formatted
+    bool m_sameLayout = false;
+    QList<int> m_dirty;
+};
+
+} // namespace Burma
+
+#endif // BURMA_SDFFRAGMENTCACHE_H
@@ -0,0 +1,77 @@
+#ifndef BURMA_SDFREADER_H
+#define BURMA_SDFREADER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include "core/Scene.h"
+
+namespace Burma {
+
+/**
+ * @brief Reads SDF world files into a Scene
+ *
+ * The file is memory-mapped and scanned once as a stream of tags, without a
+ * DOM or a UTF-16 copy of the text. Elements the Scene has no place for are
+ * skipped by matching tags alone and counted, so they can be reported.
+ *
+ * Every link with a box, sphere, cylinder or mesh becomes one scene model,
+ * placed by composing the model, link and visual poses. A model with one
+ * such link keeps its name; otherwise each is named "model::link". Included
+ * models are read from their directory once and placed per <include>.
+ */
+class SDFReader
+{
+public:
+    // Directories searched for model:// URIs, after GZ_SIM_RESOURCE_PATH
+    void setResourcePaths(const QStringList &paths) { m_resourcePaths = paths; }
+
+    bool read(const QString &filePath, Scene *scene, QString *error = nullptr);
+
+    // Of the last read: "parent/element" -> times skipped, and include URIs
+    // that could not be resolved
+    const QHash<QByteArray, int>& unsupported() const { return m_unsupported; }
+    const QStringList& missingIncludes() const { return m_missingIncludes; }
+    QString unsupportedSummary() const;
+
+private:
+    class Parser;
+
+    struct Pose {
+        double position[3] = {0.0, 0.0, 0.0};
+        double rotation[4] = {1.0, 0.0, 0.0, 0.0};   // Quaternion w, x, y, z
+    };
+
+    // A shaped link of a model, in the model's frame
+    struct Part {
+        QString path;           // Link name, prefixed by nested model names
+        Pose pose;
+        Scene::Model model;     // Name, position and rotation are set when placed
+    };
+
+    struct ModelData {
+        QString name;
+        Pose pose;
+        bool isStatic = false;
+        QList<Part> parts;
+    };
+
+    QSharedPointer<const ModelData> includedModel(const QString &uri, const QString &baseDir);
+    QString resolveUri(const QString &uri, const QString &baseDir) const;
+
+    QStringList m_resourcePaths;
+    QHash<QByteArray, int> m_unsupported;
+    QStringList m_missingIncludes;
+
+    // Included models of the current read, by resolved path; null for one
+    // that could not be read
+    QHash<QString, QSharedPointer<const ModelData>> m_includes;
+};
+
+} // namespace Burma
+
+#endif // BURMA_SDFREADER_H
@@ -0,0 +1,90 @@
+#ifndef BURMA_SDFWRITER_H
+#define BURMA_SDFWRITER_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "core/Scene.h"
+
+class QIODevice;
+class QThreadPool;
+
+namespace Burma {
+
+/**
+ * @brief Streams a Scene as SDF XML
+ *
+ * Elements are written from fixed templates into one reusable chunk buffer,
+ * and numbers are formatted in place. No QString is built per element. Full
+ * chunks go straight to the device, or are appended to a byte array that
+ * the caller can preallocate with estimateSize().
+ *
+ * Given a thread pool, large model sections are split into chunks that are
+ * formatted concurrently and written back in model order, so the output is
+ * byte-for-byte the same as a serial run.
+ */
+class SDFWriter
+{
+public:
+    static constexpr qsizetype kChunkSize = 64 * 1024;
+    static constexpr int kModelsPerTask = 1024;   // Models per pool task
+
+    explicit SDFWriter(QIODevice *device);
+    explicit SDFWriter(QByteArray *target);
+    ~SDFWriter();
+
+    SDFWriter(const SDFWriter &) = delete;
+    SDFWriter& operator=(const SDFWriter &) = delete;
+
+    // Whole <sdf> document; models are formatted on pool when it is given.
+    // The calling thread must not be one of the pool's threads.
+    bool writeWorld(const Scene &scene, QThreadPool *pool = nullptr);
+
+    // Everything before the first model, and after the last
+    void writeHeader(const Scene &scene);
+    void writeFooter();
+
+    // One <model> element
+    void writeModel(const Scene &scene, int index);
+
+    // Instancing: an <include> of a shared body, placed and named as model
+    // index, and the model.sdf and model.config of the body's directory
+    void writeInclude(const Scene &scene, int index, const QString &uri);
+    void writeBody(const Scene &scene, int index, const QString &name);
+    void writeModelConfig(const QString &name);
+
+    // Push buffered output to the device or byte array; false after a write error
+    bool flush();
+    bool hasError() const { return m_error; }
+    qint64 bytesWritten() const { return m_bytesWritten + m_used; }
+
+    // Upper bound on the output size, for preallocating a byte array
+    static qsizetype estimateSize(const Scene &scene);
+
+private:
+    void write(const char *data, qsizetype size);
+    template <qsizetype N>
+    void write(const char (&literal)[N]) { write(literal, N - 1); }
+    void writeNumber(double value);
+    void writeVec3(const Scene::Vec3 &v);
+    void writeColor(quint32 rgb);
+    void writeEscaped(const QString &text);
+    char* reserve(qsizetype size);
+
+    void writeLink(const Scene &scene, int index);
+    void writeMesh(const Scene &scene, int index);
+    void writeModelsParallel(const Scene &scene, QThreadPool *pool);
+    void writePhysics(const Scene::Physics &physics);
+    void writeLights(const QList<Scene::Light> &lights);
+
+    QIODevice *m_device;
+    QByteArray *m_target;
+    QByteArray m_chunk;
+    qsizetype m_used;
+    qint64 m_bytesWritten;
+    bool m_error;
+};
+
+} // namespace Burma
+
+#endif // BURMA_SDFWRITER_H
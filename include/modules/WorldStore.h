@@ -0,0 +1,69 @@
+#ifndef BURMA_WORLDSTORE_H
+#define BURMA_WORLDSTORE_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <functional>
+
+class QIODevice;
+
+namespace Burma {
+
+/**
+ * @brief Content-addressed directory of generated world files
+ *
+ * Each entry is named by the SHA-256 of its bytes and never changes once
+ * written, so storing content that is already there costs no writing at
+ * all. Entries are written to a temporary file and renamed into place, so
+ * a reader never sees half a world. As in ResponseCache, modification
+ * times double as LRU stamps and the oldest entries are evicted once the
+ * size cap is exceeded.
+ */
+class WorldStore
+{
+public:
+    // Writes the content to device; false on a write error
+    using Writer = std::function<bool(QIODevice *device)>;
+
+    WorldStore(const QString &directory, qint64 maxBytes);
+    ~WorldStore();
+
+    WorldStore(const WorldStore &) = delete;
+    WorldStore& operator=(const WorldStore &) = delete;
+
+    // SHA-256 of what write produces, without writing it anywhere
+    static QByteArray hash(const Writer &write);
+
+    // The entry for hash, which write produces; written only if missing
+    bool store(const QByteArray &hash, const Writer &write, QString *path,
+               bool *written = nullptr, QString *error = nullptr);
+
+    // For content too large to hash beforehand: written to a new file and
+    // hashed on the way, then dropped if an identical entry exists
+    bool storeStreamed(const Writer &write, QString *path, bool *written = nullptr,
+                       QString *error = nullptr);
+
+    // A file of this process's own to rewrite in place, such as a world
+    // being edited; not an entry, and removed with the store
+    QString workingPath() const;
+
+    void setMaxBytes(qint64 maxBytes);
+    qint64 maxBytes() const { return m_maxBytes; }
+    qint64 totalBytes() const { return m_totalBytes; }
+
+    const QString& directory() const { return m_directory; }
+
+private:
+    QString entryPath(const QByteArray &hash) const;
+    void added(const QString &path, qint64 size);
+    void evict(const QString &keep = QString());
+
+    QString m_directory;
+    qint64 m_maxBytes;
+    qint64 m_totalBytes;
+};
+
+} // namespace Burma
+
+#endif // BURMA_WORLDSTORE_H
@@ -7,6 +7,11 @@
 #include <QToolBar>
 #include <QStatusBar>
 #include <QJsonObject>
+#include <QLabel>
+#include <QVariant>
+
+#include "core/Scene.h"
+#include "modules/InferenceMetrics.h"
 
 namespace Burma {
 
@@ -33,14 +38,22 @@ private slots:
     void onExportRViz();
     void onSettings();
     void onAbout();
-    void onProcessPrompt(const QString &prompt);
+    void onProcessPrompt(const QString &prompt, bool bypassCache, bool editCurrentWorld);
     void onWorldGenerated(const QString &sdfPath);
+    void onExportRequested(const QString &outputPath, double resolution, int width, int height);
+    void onPropertyChanged(const QString &entityName, const QString &property, const QVariant &value);
 
     // BitNet slots
-    void onWorldPlanGenerated(const QJsonObject &worldPlan);
-    void onBitNetError(const QString &error);
-    void onBitNetProcessingStarted();
-    void onBitNetProcessingFinished();
+    void onWorldPlanGenerated(quint64 jobId, const QJsonObject &worldPlan);
+    void onWorldPatchGenerated(quint64 jobId, const QJsonObject &patch);
+    void onModelReceived(quint64 jobId, const QJsonObject &model);
+    void onBitNetError(quint64 jobId, const QString &error);
+    void onBitNetProcessingStarted(quint64 jobId);
+    void onBitNetProcessingFinished(quint64 jobId);
+    void onBitNetJobCancelled(quint64 jobId);
+    void onCancelPrompt();
+    void onCalibrateBitNet();
+    void onInferenceMetrics(const Burma::InferenceMetrics &metrics);
 
 private:
     void setupUi();
@@ -48,6 +61,11 @@ private:
     void createToolbars();
     void createDockWidgets();
     void setupConnections();
+    void showWorldPlan(const QJsonObject &worldPlan);
+    void onSceneBuilt(quint64 requestId, const Scene &scene);
+    void writeWorldSdf();
+    void saveWorld(const QString &filePath);
+    void updatePlanModel(int index);
 
     // Central widget
     RenderWidget *m_renderWidget;
@@ -76,8 +94,30 @@ private:
     // Toolbars
     QToolBar *m_mainToolBar;
 
+    // Latency of the last BitNet request, kept in the status bar
+    QLabel *m_metricsLabel;
+
     // Current world file
     QString m_currentWorldFile;
+
+    // SDF of the world on screen, updated in place as it is edited, and the
+    // one being written in the background: a file, or a new world's store
+    // request. Before either, the scene of a new plan is built in the
+    // background too.
+    QString m_worldSdfFile;
+    QString m_pendingWorldFile;
+    quint64 m_pendingStoreRequest;
+    quint64 m_pendingSceneRequest;
+    bool m_sdfUpdateScheduled;
+
+    // BitNet job submitted from the prompt panel; other jobs are not shown
+    quint64 m_promptJobId;
+    bool m_promptIsEdit;
+
+    // Plan of the world on screen, the base for edit prompts, and its typed
+    // form shared by the builder, the views and the exporter
+    QJsonObject m_worldPlan;
+    Scene m_scene;
 };
 
 } // namespace Burma
@@ -6,6 +6,8 @@
 #include <QPushButton>
 #include <QComboBox>
 #include <QListWidget>
+#include <QCheckBox>
+#include <QLabel>
 
 namespace Burma {
 
@@ -18,7 +20,12 @@ public:
     ~PromptPanel() override = default;
 
 signals:
-    void promptSubmitted(const QString &prompt);
+    void promptSubmitted(const QString &prompt, bool bypassCache, bool editCurrentWorld);
+    void cancelRequested();
+
+public slots:
+    void setGenerating(bool generating);
+    void setModelStatus(const QString &status);
 
 private slots:
     void onSubmitClicked();
@@ -34,8 +41,12 @@ private:
     QTextEdit *m_promptInput;
     QPushButton *m_submitButton;
     QPushButton *m_clearButton;
+    QPushButton *m_cancelButton;
+    QCheckBox *m_bypassCacheCheck;
+    QCheckBox *m_editModeCheck;
     QComboBox *m_templateCombo;
     QListWidget *m_historyList;
+    QLabel *m_modelStatusLabel;
 
     QStringList m_history;
 };
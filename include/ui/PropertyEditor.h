@@ -7,6 +7,9 @@
 #include <QDoubleSpinBox>
 #include <QPushButton>
 #include <QColorDialog>
+#include <QHash>
+
+#include "core/Scene.h"
 
 namespace Burma {
 
@@ -18,6 +21,9 @@ public:
     explicit PropertyEditor(QWidget *parent = nullptr);
     ~PropertyEditor() override = default;
 
+    // World the selected entity is looked up in
+    void setScene(const Scene &scene);
+
     void setSelectedEntity(const QString &entityName);
     void clearSelection();
 
@@ -35,13 +41,16 @@ private:
     QWidget* createVisualWidget();
 
     void updatePropertyTree();
+    void updateTransformControls();
     void addPropertyGroup(const QString &groupName);
     void addProperty(const QString &group, const QString &name, const QVariant &value, bool editable = true);
 
     QTreeWidget *m_propertyTree;
     QString m_selectedEntity;
+    Scene m_scene;
+    int m_selectedIndex;   // In m_scene, -1 if the entity isn't part of it
 
-    // Transform controls
+    // Transform controls, and their values as loaded for the selection
     QDoubleSpinBox *m_posXSpin;
     QDoubleSpinBox *m_posYSpin;
     QDoubleSpinBox *m_posZSpin;
@@ -51,6 +60,7 @@ private:
     QDoubleSpinBox *m_scaleXSpin;
     QDoubleSpinBox *m_scaleYSpin;
     QDoubleSpinBox *m_scaleZSpin;
+    QHash<const QDoubleSpinBox*, double> m_loadedValues;
 
     // Visual controls
     QPushButton *m_colorButton;
@@ -6,6 +6,12 @@
 #include <QTimer>
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMatrix4x4>
+#include <QVector3D>
+
+#include "core/Scene.h"
 
 namespace Burma {
 
@@ -20,6 +26,15 @@ public:
     void loadWorld(const QString &worldFile);
     void clearWorld();
 
+    // Preview world plan objects as they are generated; repeat directives
+    // are expanded
+    void addPreviewModel(const QJsonObject &model);
+    void setPreviewModels(const QJsonArray &models);
+    void setScene(const Scene &scene);
+
+    // Model drawn highlighted, e.g. the one in the property editor
+    void setSelectedEntity(const QString &entityName);
+
 signals:
     void worldLoaded(const QString &worldFile);
     void selectionChanged(const QString &entityName);
@@ -43,7 +58,15 @@ private:
     void shutdownGazeboRenderer();
     void renderScene();
     void renderPlaceholderGrid();
+    void renderPreviewModels();
+    int drawStride() const;   // Large scenes draw every n-th model
+    void updateBounds();
     void updateCamera();
+    QVector3D cameraPosition() const;
+    QMatrix4x4 viewProjection() const;
+
+    // Model whose origin is drawn nearest to a point of the widget, or -1
+    int pickModel(const QPoint &pos) const;
 
     // Camera control
     struct Camera {
@@ -57,6 +80,7 @@ private:
 
     // Mouse interaction
     QPoint m_lastMousePos;
+    QPoint m_pressPos;   // A left click that doesn't move selects a model
     bool m_isRotating = false;
     bool m_isPanning = false;
 
@@ -69,6 +93,14 @@ private:
 
     // Current world
     QString m_currentWorld;
+    Scene m_scene;
+    QString m_selectedEntity;
+    int m_selectedIndex = -1;   // In m_scene
+
+    // Extent of m_scene, drawn around a sampled large scene
+    Scene::Vec3 m_boundsMin;
+    Scene::Vec3 m_boundsMax;
+    bool m_boundsValid = false;
 };
 
 } // namespace Burma
@@ -0,0 +1,42 @@
+#ifndef BURMA_JSONEXTRACTOR_H
+#define BURMA_JSONEXTRACTOR_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+namespace Burma {
+
+/**
+ * @brief Single-pass extraction of the first JSON object in LLM output
+ *
+ * One forward scan over the raw UTF-8 bytes tracks string and escape state
+ * and a stack of open containers. The result is the byte range of the first
+ * top-level object. If the output was truncated, the range ends at the last
+ * point where closing the open containers gives valid JSON, and the closing
+ * brackets come back in the right order. Nothing is copied unless a repair
+ * is needed.
+ */
+class JsonExtractor
+{
+public:
+    struct Result {
+        qsizetype begin = -1;       // Offset of the opening '{'
+        qsizetype end = -1;         // One past the last byte to keep
+        QByteArray closing;         // Brackets to append; empty if the object was complete
+
+        bool found() const { return begin >= 0 && end > begin; }
+        bool isComplete() const { return found() && closing.isEmpty(); }
+    };
+
+    static Result scan(const char *data, qsizetype size);
+    static Result scan(const QByteArray &bytes) { return scan(bytes.constData(), bytes.size()); }
+
+    // Scan, repair and parse; an empty object if there is none or it is invalid
+    static QJsonObject parse(const QByteArray &bytes, QString *error = nullptr);
+    static QJsonObject parse(const QByteArray &bytes, const Result &range, QString *error = nullptr);
+};
+
+} // namespace Burma
+
+#endif // BURMA_JSONEXTRACTOR_H
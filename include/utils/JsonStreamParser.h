@@ -0,0 +1,51 @@
+#ifndef BURMA_JSONSTREAMPARSER_H
+#define BURMA_JSONSTREAMPARSER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+
+namespace Burma {
+
+/**
+ * @brief Incremental tokenizer for JSON arriving in chunks
+ *
+ * Skips any text before the first '{', tracks string/escape state and
+ * nesting depth, and hands out each complete object of one top-level
+ * array (e.g. "models") as soon as its closing brace arrives.
+ */
+class JsonStreamParser
+{
+public:
+    explicit JsonStreamParser(const QByteArray &arrayKey);
+
+    void reset();
+    void feed(const QByteArray &chunk);
+
+    // Entries completed since the last call
+    QList<QJsonObject> takeEntries();
+
+    // True once the top-level object has been closed
+    bool isComplete() const { return m_complete; }
+
+    // Bytes of the top-level object seen so far
+    const QByteArray& document() const { return m_document; }
+
+private:
+    QByteArray m_arrayKey;
+    QByteArray m_document;
+    QByteArray m_key;
+    QList<QJsonObject> m_entries;
+
+    int m_depth;
+    bool m_inString;
+    bool m_escaped;
+    bool m_expectKey;
+    bool m_inArray;
+    qsizetype m_entryStart;
+    bool m_complete;
+};
+
+} // namespace Burma
+
+#endif // BURMA_JSONSTREAMPARSER_H
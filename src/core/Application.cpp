@@ -1,16 +1,24 @@
 #include "core/Application.h"
 #include "modules/BitNetClient.h"
+#include "modules/BitNetCalibrator.h"
 #include "modules/FuelFetcher.h"
+#include "modules/AssetIndex.h"
 #include "modules/SDFBuilder.h"
 #include "modules/RvizConverter.h"
 #include "modules/MaterialManager.h"
 #include "utils/Logger.h"
 
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
 namespace Burma {
 
 Application::Application()
     : m_bitNetClient(nullptr)
     , m_fuelFetcher(nullptr)
+    , m_assetIndex(nullptr)
     , m_sdfBuilder(nullptr)
     , m_rvizConverter(nullptr)
     , m_materialManager(nullptr)
@@ -69,14 +77,38 @@ void Application::initializeModules()
 {
     // Initialize BitNet LLM client
     m_bitNetClient = new BitNetClient(this);
+    if (m_settings.contains("bitnet/residentWorker")) {
+        m_bitNetClient->setWorkerEnabled(m_settings.value("bitnet/residentWorker").toBool());
+    }
+    if (m_settings.contains("bitnet/workerPoolSize")) {
+        m_bitNetClient->setWorkerPoolSize(m_settings.value("bitnet/workerPoolSize").toInt());
+    }
+    m_bitNetClient->setResponseCacheLimit(
+        m_settings.value("bitnet/responseCacheMB", 64).toLongLong() * 1024 * 1024);
+    if (m_settings.contains("bitnet/draftModelPath")) {
+        m_bitNetClient->setDraftModel(m_settings.value("bitnet/draftModelPath").toString(),
+                                      m_settings.value("bitnet/draftLength", 8).toInt());
+    }
+    // loadModelAtStartup is the older, opt-in form of the warm-up. Its
+    // workers start after the prefetch, so the stored calibration applied
+    // just after still configures them; a first calibration waits for it.
+    if (m_settings.value("bitnet/warmUpAtStartup", true).toBool()
+        || m_settings.value("bitnet/loadModelAtStartup", false).toBool()) {
+        m_bitNetClient->warmUp();
+    }
+    applyBitNetCalibration();
     Logger::instance().info("BitNet client initialized");
 
     // Initialize Gazebo Fuel fetcher
     m_fuelFetcher = new FuelFetcher(this);
     Logger::instance().info("Fuel fetcher initialized");
+    initializeAssetIndex();
 
     // Initialize SDF builder
     m_sdfBuilder = new SDFBuilder(this);
+    m_sdfBuilder->setInstancingEnabled(m_settings.value("sdf/instancing", true).toBool());
+    m_sdfBuilder->setStoreLimit(
+        m_settings.value("sdf/storeMB", 1024).toLongLong() * 1024 * 1024);
     Logger::instance().info("SDF builder initialized");
 
     // Initialize RViz converter
@@ -88,6 +120,81 @@ void Application::initializeModules()
     Logger::instance().info("Material manager initialized");
 }
 
+void Application::applyBitNetCalibration()
+{
+    // Every calibration, automatic or from the UI, is remembered for this CPU and model
+    connect(m_bitNetClient, &BitNetClient::calibrationFinished, this,
+            [this](int threads, int batchSize, double promptTokensPerSec, double generationTokensPerSec) {
+        m_settings.beginGroup(BitNetCalibrator::settingsGroup(m_bitNetClient->modelPath()));
+        m_settings.setValue("cpu", BitNetCalibrator::cpuModel());
+        m_settings.setValue("model", m_bitNetClient->modelPath());
+        m_settings.setValue("threads", threads);
+        m_settings.setValue("batchSize", batchSize);
+        m_settings.setValue("promptTokensPerSec", promptTokensPerSec);
+        m_settings.setValue("generationTokensPerSec", generationTokensPerSec);
+        m_settings.setValue("calibratedAt", QDateTime::currentDateTime());
+        m_settings.remove("error");
+        m_settings.endGroup();
+    });
+
+    // A failure is remembered too, so a missing or broken llama-bench isn't
+    // run again on every launch; a later success replaces it
+    connect(m_bitNetClient, &BitNetClient::calibrationFailed, this, [this](const QString &error) {
+        m_settings.beginGroup(BitNetCalibrator::settingsGroup(m_bitNetClient->modelPath()));
+        m_settings.setValue("cpu", BitNetCalibrator::cpuModel());
+        m_settings.setValue("model", m_bitNetClient->modelPath());
+        m_settings.setValue("calibratedAt", QDateTime::currentDateTime());
+        m_settings.setValue("error", error);
+        m_settings.endGroup();
+    });
+
+    m_settings.beginGroup(BitNetCalibrator::settingsGroup(m_bitNetClient->modelPath()));
+    bool calibrated = m_settings.contains("threads");
+    bool attempted = m_settings.contains("calibratedAt");
+    int threads = m_settings.value("threads").toInt();
+    int batchSize = m_settings.value("batchSize").toInt();
+    m_settings.endGroup();
+
+    if (calibrated) {
+        m_bitNetClient->setInferenceSettings(threads, batchSize);
+    } else if (!attempted && m_settings.value("bitnet/autoCalibrate", true).toBool()) {
+        // First run on this CPU and model. Prompts don't wait for the grid;
+        // they run on the default settings until it finishes and the
+        // workers are idle.
+        m_bitNetClient->calibrate(false);
+    }
+}
+
+void Application::initializeAssetIndex()
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString indexPath = QDir(cacheDir).filePath("asset_index.bin");
+
+    m_assetIndex = new AssetIndex();
+    m_assetIndex->load(indexPath);
+    m_bitNetClient->setAssetIndex(m_assetIndex);
+
+    connect(m_fuelFetcher, &FuelFetcher::catalogSynced, this, [this, indexPath]() {
+        m_fuelFetcher->rebuildAssetIndex(indexPath);
+    });
+    connect(m_fuelFetcher, &FuelFetcher::assetIndexReady, this, [this](const QString &path) {
+        // The new file replaced the old one atomically; remap it
+        m_assetIndex->load(path);
+    });
+
+    QFileInfo catalog(m_fuelFetcher->catalogPath());
+    QFileInfo index(indexPath);
+    int maxAgeDays = m_settings.value("fuel/catalogMaxAgeDays", 7).toInt();
+    bool catalogStale = !catalog.exists()
+        || catalog.lastModified().daysTo(QDateTime::currentDateTime()) > maxAgeDays;
+
+    if (catalogStale && m_settings.value("fuel/catalogSync", true).toBool()) {
+        m_fuelFetcher->syncCatalog();
+    } else if (!m_assetIndex->isLoaded() || index.lastModified() < catalog.lastModified()) {
+        m_fuelFetcher->rebuildAssetIndex(indexPath);
+    }
+}
+
 void Application::shutdownModules()
 {
     // Delete modules in reverse order
@@ -100,6 +207,12 @@ void Application::shutdownModules()
     delete m_sdfBuilder;
     m_sdfBuilder = nullptr;
 
+    if (m_bitNetClient) {
+        m_bitNetClient->setAssetIndex(nullptr);
+    }
+    delete m_assetIndex;
+    m_assetIndex = nullptr;
+
     delete m_fuelFetcher;
     m_fuelFetcher = nullptr;
 
@@ -0,0 +1,649 @@
+#include "core/LayoutGenerator.h"
+#include "core/WorldPlanSchema.h"
+#include "utils/Logger.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QtMath>
+
+#include <cmath>
+#include <functional>
+#include <random>
+
+namespace Burma {
+
+namespace {
+
+using Model = Scene::Model;
+using Vec3 = Scene::Vec3;
+using Rng = std::mt19937;
+using Parts = QList<QList<Model>>;   // Models of each row or tile, in order
+
+struct Parameters {
+    QString name;
+    Vec3 origin;
+    int rows = 1;
+    int columns = 1;
+    int levels = 1;
+    int count = 0;
+    double spacing = 1.0;
+    double density = 0.0;
+    double width = 0.0;     // Region, scatter only
+    double depth = 0.0;
+    quint32 seed = 0;
+};
+
+struct Defaults {
+    int rows;
+    int columns;
+    int levels;
+    int count;
+    double spacing;
+    double density;
+};
+
+constexpr quint32 kUpright = 0x1F4E9C;
+constexpr quint32 kShelf = 0xE8731A;
+constexpr quint32 kCarton = 0xC8A165;
+constexpr quint32 kPartition = 0x8C939B;
+constexpr quint32 kDesk = 0xD9C3A0;
+constexpr quint32 kChair = 0x2B2B2B;
+constexpr quint32 kAsphalt = 0x3A3A3A;
+constexpr quint32 kMarking = 0xF2F2F2;
+constexpr quint32 kConcrete = 0x9E9E9E;
+constexpr quint32 kWall = 0xBFB8AA;
+constexpr quint32 kCarColors[] = {0xB22222, 0x1E3A8A, 0xE5E5E5, 0x111111, 0x7A7A7A, 0x2E7D32, 0xC0C0C0};
+constexpr quint32 kClutterColors[] = {0xC8A165, 0x8D6E63, 0x607D8B, 0xFFB300, 0x43A047, 0xE53935, 0x5E35B1};
+
+// Independent of the thread that runs the row or tile
+Rng rngFor(quint32 seed, int index)
+{
+    std::seed_seq sequence{seed, quint32(index)};
+    return Rng(sequence);
+}
+
+double uniform(Rng &rng, double low, double high)
+{
+    return std::uniform_real_distribution<double>(low, high)(rng);
+}
+
+bool chance(Rng &rng, double probability)
+{
+    return uniform(rng, 0.0, 1.0) < probability;
+}
+
+template <typename T, size_t N>
+T pick(Rng &rng, const T (&values)[N])
+{
+    return values[std::uniform_int_distribution<size_t>(0, N - 1)(rng)];
+}
+
+// Static and colored, as structure is
+Model box(const QString &name, const Vec3 &centre, const Vec3 &size, quint32 color)
+{
+    Model model;
+    model.name = name;
+    model.position = centre;
+    model.scale = size;
+    model.color = color;
+    model.hasColor = true;
+    model.isStatic = true;
+    return model;
+}
+
+// Runs task(0) to task(count - 1) on pool, or here without one. The caller
+// blocks until they are done, so it must not be one of the pool's threads.
+void runTasks(int count, QThreadPool *pool, const std::function<void(int)> &task)
+{
+    if (!pool || count <= 1) {
+        for (int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    QSemaphore done;
+    for (int i = 0; i < count; ++i) {
+        pool->start([&task, &done, i]() {
+            task(i);
+            done.release();
+        });
+    }
+    done.acquire(count);
+}
+
+Parts generateRows(const Parameters &p, QThreadPool *pool, const std::function<void(int, Rng&, QList<Model>&)> &row)
+{
+    Parts parts(p.rows);
+    QList<Model> *rows = parts.data();
+    runTasks(p.rows, pool, [&](int r) {
+        Rng rng = rngFor(p.seed, r);
+        row(r, rng, rows[r]);
+    });
+    return parts;
+}
+
+Parts warehouse(const Parameters &p, QThreadPool *pool)
+{
+    // A bay holds two pallets side by side on each level
+    const float bayLength = 2.7f;
+    const float rackDepth = 1.1f;
+    const float levelHeight = 1.6f;
+    const float deck = 0.1f;
+    const float rackHeight = p.levels * levelHeight;
+    const Vec3 &o = p.origin;
+
+    return generateRows(p, pool, [&](int r, Rng &rng, QList<Model> &models) {
+        float y = o.y + r * float(rackDepth + p.spacing) + rackDepth / 2;
+        models.reserve((p.columns + 1) + p.columns * p.levels * 3);
+        for (int c = 0; c <= p.columns; ++c) {
+            models.append(box(QString("%1_upright_%2_%3").arg(p.name).arg(r).arg(c),
+                              {o.x + c * bayLength, y, o.z + rackHeight / 2},
+                              {0.1f, rackDepth, rackHeight}, kUpright));
+        }
+        for (int c = 0; c < p.columns; ++c) {
+            float x = o.x + (c + 0.5f) * bayLength;
+            for (int l = 0; l < p.levels; ++l) {
+                float deckTop = o.z + l * levelHeight + 0.1f + deck;
+                models.append(box(QString("%1_shelf_%2_%3_%4").arg(p.name).arg(r).arg(c).arg(l),
+                                  {x, y, deckTop - deck / 2}, {bayLength - 0.1f, rackDepth, deck}, kShelf));
+                for (int slot = 0; slot < 2; ++slot) {
+                    if (!chance(rng, p.density)) {
+                        continue;
+                    }
+                    float height = float(uniform(rng, 0.6, levelHeight - 0.4));
+                    models.append(box(QString("%1_pallet_%2_%3_%4_%5").arg(p.name).arg(r).arg(c).arg(l).arg(slot),
+                                      {x + (slot ? 0.65f : -0.65f), y, deckTop + height / 2},
+                                      {1.0f, 1.0f, height}, kCarton));
+                }
+            }
+        }
+    });
+}
+
+Parts office(const Parameters &p, QThreadPool *pool)
+{
+    // Cubicles open onto an aisle on their -y side
+    const float size = float(qMax(p.spacing, 1.8));
+    const float aisle = 1.2f;
+    const float wall = 0.05f;
+    const float wallHeight = 1.4f;
+    const float deskDepth = 0.75f;
+    const Vec3 &o = p.origin;
+
+    return generateRows(p, pool, [&](int r, Rng &rng, QList<Model> &models) {
+        float y = o.y + r * (size + aisle);
+        models.reserve(p.columns * 4 + 1);
+        for (int c = 0; c <= p.columns; ++c) {
+            float x = o.x + c * size;
+            models.append(box(QString("%1_side_%2_%3").arg(p.name).arg(r).arg(c),
+                              {x, y + size / 2, o.z + wallHeight / 2}, {wall, size, wallHeight}, kPartition));
+            if (c == p.columns) {
+                break;
+            }
+
+            float centre = x + size / 2;
+            models.append(box(QString("%1_back_%2_%3").arg(p.name).arg(r).arg(c),
+                              {centre, y + size - wall / 2, o.z + wallHeight / 2},
+                              {size, wall, wallHeight}, kPartition));
+            float deskY = y + size - wall - deskDepth / 2;
+            models.append(box(QString("%1_desk_%2_%3").arg(p.name).arg(r).arg(c),
+                              {centre, deskY, o.z + 0.37f}, {size * 0.7f, deskDepth, 0.74f}, kDesk));
+            if (chance(rng, p.density)) {
+                Model chair = box(QString("%1_chair_%2_%3").arg(p.name).arg(r).arg(c),
+                                  {centre + float(uniform(rng, -0.2, 0.2)),
+                                   deskY - deskDepth / 2 - 0.4f + float(uniform(rng, -0.15, 0.15)),
+                                   o.z + 0.45f},
+                                  {0.28f, 0.28f, 0.9f}, kChair);
+                chair.geometry = Scene::Geometry::Cylinder;
+                chair.isStatic = false;
+                models.append(chair);
+            }
+        }
+    });
+}
+
+Parts parking(const Parameters &p, QThreadPool *pool)
+{
+    // Rows face each other in pairs across an aisle; even rows have their
+    // heads at -y, odd rows at +y
+    const float width = float(p.spacing);
+    const float length = 5.0f;
+    const float aisle = 6.5f;
+    const float pairPitch = 2 * length + aisle;
+    const float slab = 0.02f;
+    const Vec3 &o = p.origin;
+    auto rowStart = [&](int r) {
+        return o.y + (r / 2) * pairPitch + (r % 2 ? length + aisle : 0.0f);
+    };
+
+    Parts parts = generateRows(p, pool, [&](int r, Rng &rng, QList<Model> &models) {
+        float y = rowStart(r);
+        bool headAtMinY = r % 2 == 0;
+        float z = o.z + slab;
+        models.reserve(p.columns * 3 + 1);
+        for (int c = 0; c <= p.columns; ++c) {
+            models.append(box(QString("%1_line_%2_%3").arg(p.name).arg(r).arg(c),
+                              {o.x + c * width, y + length / 2, z + 0.005f}, {0.1f, length, 0.01f}, kMarking));
+            if (c == p.columns) {
+                break;
+            }
+
+            float x = o.x + (c + 0.5f) * width;
+            models.append(box(QString("%1_stop_%2_%3").arg(p.name).arg(r).arg(c),
+                              {x, headAtMinY ? y + 0.4f : y + length - 0.4f, z + 0.06f},
+                              {width * 0.6f, 0.15f, 0.12f}, kConcrete));
+            if (chance(rng, p.density)) {
+                Model car = box(QString("%1_car_%2_%3").arg(p.name).arg(r).arg(c),
+                                {x + float(uniform(rng, -0.15, 0.15)),
+                                 y + length / 2 + float(uniform(rng, -0.2, 0.2)), z + 0.725f},
+                                {1.8f, 4.4f, 1.45f}, pick(rng, kCarColors));
+                car.rotation.z = float(uniform(rng, -0.04, 0.04));
+                models.append(car);
+            }
+        }
+    });
+
+    float lotDepth = rowStart(p.rows - 1) + length - o.y;
+    float lotWidth = p.columns * width;
+    parts.append(QList<Model>{box(p.name + "_surface", {o.x + lotWidth / 2, o.y + lotDepth / 2, o.z + slab / 2},
+                      {lotWidth, lotDepth, slab}, kAsphalt)});
+    return parts;
+}
+
+Parts maze(const Parameters &p, QThreadPool *pool)
+{
+    // Sidewinder: row 0 is one corridor, and each run of cells carved
+    // along a later row opens into the row before at one random cell. A
+    // row's choices need no other row, so rows are carved in parallel.
+    // The entrance is on the -x side of row 0, the exit on the +x side of
+    // the last row.
+    const float cell = float(p.spacing);
+    const float wall = 0.1f;
+    const float height = 2.0f;
+    const Vec3 &o = p.origin;
+    const float z = o.z + height / 2;
+
+    return generateRows(p, pool, [&](int r, Rng &rng, QList<Model> &models) {
+        QList<bool> openEast(p.columns, false);
+        QList<bool> openBefore(p.columns, false);   // Into row r - 1
+        if (r == 0) {
+            for (int c = 0; c + 1 < p.columns; ++c) {
+                openEast[c] = true;
+            }
+        } else {
+            int runStart = 0;
+            for (int c = 0; c < p.columns; ++c) {
+                if (c + 1 < p.columns && chance(rng, 0.5)) {
+                    openEast[c] = true;
+                } else {
+                    openBefore[std::uniform_int_distribution<int>(runStart, c)(rng)] = true;
+                    runStart = c + 1;
+                }
+            }
+            // Loops, for a corridor network rather than a perfect maze
+            for (int c = 0; c < p.columns; ++c) {
+                if (!openEast[c] && c + 1 < p.columns && chance(rng, p.density)) {
+                    openEast[c] = true;
+                }
+                if (!openBefore[c] && chance(rng, p.density)) {
+                    openBefore[c] = true;
+                }
+            }
+        }
+        if (r == p.rows - 1) {
+            openEast[p.columns - 1] = true;
+        }
+
+        float y = o.y + r * cell;
+        auto wallAlongX = [&](const QString &name, int first, int last, float wallY) {
+            float length = (last - first) * cell + wall;
+            models.append(box(name, {o.x + (first + last) * cell / 2, wallY, z}, {length, wall, height}, kWall));
+        };
+
+        // Walls toward the row before, merged into one model per run
+        for (int c = 0; c < p.columns;) {
+            if (openBefore[c]) {
+                ++c;
+                continue;
+            }
+            int first = c;
+            while (c < p.columns && !openBefore[c]) {
+                ++c;
+            }
+            wallAlongX(QString("%1_wall_%2_%3").arg(p.name).arg(r).arg(first), first, c, y);
+        }
+        if (r == p.rows - 1) {
+            wallAlongX(p.name + "_wall_end", 0, p.columns, y + cell);
+        }
+
+        if (r > 0) {
+            models.append(box(QString("%1_wall_%2_w").arg(p.name).arg(r),
+                              {o.x, y + cell / 2, z}, {wall, cell + wall, height}, kWall));
+        }
+        for (int c = 0; c < p.columns; ++c) {
+            if (!openEast[c]) {
+                models.append(box(QString("%1_wall_%2_%3_e").arg(p.name).arg(r).arg(c),
+                                  {o.x + (c + 1) * cell, y + cell / 2, z}, {wall, cell + wall, height}, kWall));
+            }
+        }
+    });
+}
+
+// Clutter on the shared scatter sampler, one part per tile
+Parts scatter(const Parameters &p, QThreadPool *pool)
+{
+    const QList<QList<LayoutGenerator::Point>> tiles =
+        LayoutGenerator::scatterPoints(p.count, p.spacing, p.width, p.depth, p.seed, pool);
+
+    const double maxSize = p.spacing > 0.0 ? qMin(0.8, p.spacing * 0.5) : 0.5;
+    const Vec3 &o = p.origin;
+    Parts parts(tiles.size());
+    QList<Model> *partData = parts.data();
+    runTasks(int(tiles.size()), pool, [&](int t) {
+        // Streams apart from the ones the tiles were sampled with
+        Rng rng = rngFor(p.seed, int(tiles.size()) + t);
+        QList<Model> &models = partData[t];
+        models.reserve(tiles.at(t).size());
+
+        for (const LayoutGenerator::Point &point : tiles.at(t)) {
+            // Given a spacing, small enough never to touch a neighbour
+            Model model;
+            model.name = QString("%1_%2_%3").arg(p.name).arg(t).arg(models.size());
+            model.color = pick(rng, kClutterColors);
+            model.hasColor = true;
+            model.isStatic = true;
+            float size = float(uniform(rng, 0.3, 1.0) * maxSize);
+            float height = size;
+            switch (std::uniform_int_distribution<int>(0, 2)(rng)) {
+            case 0:
+                height = size * float(uniform(rng, 0.5, 1.5));
+                model.scale = {size, size, height};
+                break;
+            case 1:
+                model.geometry = Scene::Geometry::Cylinder;
+                height = size * float(uniform(rng, 0.8, 2.0));
+                model.scale = {size / 2, size / 2, height};
+                break;
+            default:
+                model.geometry = Scene::Geometry::Sphere;
+                model.scale = {size / 2, size / 2, size / 2};
+                break;
+            }
+            model.position = {o.x + point.x, o.y + point.y, o.z + height / 2};
+            model.rotation.z = float(uniform(rng, -M_PI, M_PI));
+            models.append(model);
+        }
+    });
+    return parts;
+}
+
+Defaults defaultsFor(const QString &generator)
+{
+    if (generator == "warehouse") {
+        return {6, 20, 4, 0, 3.0, 0.7};
+    }
+    if (generator == "office") {
+        return {6, 10, 1, 0, 2.5, 0.9};
+    }
+    if (generator == "parking") {
+        return {4, 20, 1, 0, 2.7, 0.6};
+    }
+    if (generator == "maze") {
+        return {20, 20, 1, 0, 2.0, 0.0};
+    }
+    return {1, 1, 1, 1000, 1.0, 0.0};
+}
+
+// Most models a row's cell can produce
+int modelsPerCell(const QString &generator, int levels)
+{
+    if (generator == "warehouse") {
+        return 3 * levels + 1;
+    }
+    if (generator == "office") {
+        return 4;
+    }
+    if (generator == "parking") {
+        return 3;
+    }
+    return 2;
+}
+
+Parameters readParameters(const QJsonObject &entry, const QString &generator, const QString &name,
+                          int limit)
+{
+    Defaults defaults = defaultsFor(generator);
+    auto number = [&](const QString &key, double fallback) {
+        return entry.value(key).toDouble(fallback);
+    };
+
+    Parameters p;
+    p.name = name;
+    QJsonObject position = entry.value(PlanKey::Position).toObject();
+    p.origin = {float(position.value("x").toDouble()), float(position.value("y").toDouble()),
+                float(position.value("z").toDouble())};
+    p.rows = qBound(1, qRound(number(PlanKey::Rows, defaults.rows)), limit);
+    p.columns = qBound(1, qRound(number(PlanKey::Columns, defaults.columns)), limit);
+    p.levels = qBound(1, qRound(number(PlanKey::Levels, defaults.levels)), 20);
+    p.count = qBound(0, qRound(number(PlanKey::Count, defaults.count)), limit);
+    p.spacing = number(PlanKey::Spacing, defaults.spacing);
+    if (p.spacing <= 0.0 && generator != "scatter") {
+        p.spacing = defaults.spacing;
+    }
+    p.density = qBound(0.0, number(PlanKey::Density, defaults.density), 1.0);
+    QJsonObject region = entry.value(PlanKey::Region).toObject();
+    p.width = region.value("x").toDouble();
+    p.depth = region.value("y").toDouble();
+    p.seed = quint32(number(PlanKey::Seed, 0));
+
+    if (generator != "scatter") {
+        qint64 perRow = qint64(p.columns) * modelsPerCell(generator, p.levels) + 2;
+        if (p.rows * perRow > limit) {
+            int rows = int(qMax<qint64>(1, limit / perRow));
+            Logger::instance().warning(QString("%1 layout limited to %2 of %3 rows (%4 models at most)")
+                                           .arg(p.name).arg(rows).arg(p.rows).arg(limit));
+            p.rows = rows;
+            if (perRow > limit) {
+                p.columns = qMax(1, (limit - 2) / modelsPerCell(generator, p.levels));
+            }
+        }
+    }
+    return p;
+}
+
+} // namespace
+
+// Poisson-disk sampling by dart throwing on a background grid, in tiles.
+// A cell is spacing / sqrt(2) wide and so holds one point at most, and a
+// candidate only checks the cells within two of its own. Tiles are at
+// least that wide, so in each of four phases the tiles with the same row
+// and column parity share no cells they read and run at once.
+QList<QList<LayoutGenerator::Point>> LayoutGenerator::scatterPoints(int count, double spacing, double width,
+                                                                     double depth, quint32 seed,
+                                                                     QThreadPool *pool)
+{
+    struct Tile {
+        QList<Point> points;
+        QHash<qint64, int> cells;   // Cell -> point
+    };
+
+    count = qMax(0, count);
+    spacing = qMax(spacing, 0.0);
+    if (width <= 0.0 || depth <= 0.0) {
+        // Roomy enough that the minimum spacing rarely limits the count
+        width = depth = qMax(spacing, 1.0) * std::sqrt(double(count)) * 1.5;
+    }
+
+    // Cells only matter with a spacing; without one a cell is a tile
+    const double cellSize = spacing > 0.0 ? spacing / M_SQRT2 : qMax(width, depth) / 64.0;
+    const qint64 cellsX = qMax<qint64>(1, qint64(std::ceil(width / cellSize)));
+    const qint64 cellsY = qMax<qint64>(1, qint64(std::ceil(depth / cellSize)));
+    const qint64 tileCells = qMax<qint64>(32, qint64(std::ceil(std::sqrt(cellsX * cellsY / 4096.0))));
+    const int tilesX = int((cellsX + tileCells - 1) / tileCells);
+    const int tilesY = int((cellsY + tileCells - 1) / tileCells);
+
+    QList<Tile> tiles(qsizetype(tilesX) * tilesY);
+    QList<int> quotas(tiles.size());
+    {
+        // Shares of the count by area, rounded so they add up
+        double total = double(cellsX) * cellsY;
+        double before = 0.0;
+        for (int t = 0; t < tiles.size(); ++t) {
+            qint64 tx = t % tilesX;
+            qint64 ty = t / tilesX;
+            double cells = double(qMin(tileCells, cellsX - tx * tileCells))
+                           * double(qMin(tileCells, cellsY - ty * tileCells));
+            quotas[t] = int(std::llround(count * (before + cells) / total) - std::llround(count * before / total));
+            before += cells;
+        }
+    }
+
+    // Sampled from the region's corner, stored relative to its centre
+    const double minDistance2 = spacing * spacing;
+    const float halfWidth = float(width / 2);
+    const float halfDepth = float(depth / 2);
+    auto cellKey = [&](qint64 cx, qint64 cy) { return cy * cellsX + cx; };
+    auto tileOf = [&](qint64 cx, qint64 cy) { return int((cy / tileCells) * tilesX + cx / tileCells); };
+
+    Tile *tileData = tiles.data();
+    auto fill = [&](int t) {
+        Tile &tile = tileData[t];
+        Rng rng = rngFor(seed, t);
+        qint64 tx = t % tilesX;
+        qint64 ty = t / tilesX;
+        double x0 = tx * tileCells * cellSize;
+        double y0 = ty * tileCells * cellSize;
+        double x1 = qMin(width, x0 + tileCells * cellSize);
+        double y1 = qMin(depth, y0 + tileCells * cellSize);
+        int quota = quotas.at(t);
+        tile.points.reserve(quota);
+
+        for (qint64 attempt = 0; attempt < qint64(quota) * 30 && tile.points.size() < quota; ++attempt) {
+            double x = uniform(rng, x0, x1);
+            double y = uniform(rng, y0, y1);
+            Point candidate{float(x) - halfWidth, float(y) - halfDepth};
+            // Within the tile's own cells despite rounding
+            qint64 cx = qBound<qint64>(tx * tileCells, qint64(x / cellSize), qMin(cellsX, (tx + 1) * tileCells) - 1);
+            qint64 cy = qBound<qint64>(ty * tileCells, qint64(y / cellSize), qMin(cellsY, (ty + 1) * tileCells) - 1);
+
+            bool free = true;
+            for (qint64 ny = qMax<qint64>(0, cy - 2); spacing > 0.0 && free && ny <= qMin(cellsY - 1, cy + 2); ++ny) {
+                for (qint64 nx = qMax<qint64>(0, cx - 2); free && nx <= qMin(cellsX - 1, cx + 2); ++nx) {
+                    const Tile &owner = tileData[tileOf(nx, ny)];
+                    auto it = owner.cells.constFind(cellKey(nx, ny));
+                    if (it == owner.cells.constEnd()) {
+                        continue;
+                    }
+                    const Point &other = owner.points.at(it.value());
+                    double dx = other.x - candidate.x;
+                    double dy = other.y - candidate.y;
+                    free = dx * dx + dy * dy >= minDistance2;
+                }
+            }
+            if (!free) {
+                continue;
+            }
+            if (spacing > 0.0) {
+                tile.cells.insert(cellKey(cx, cy), int(tile.points.size()));
+            }
+            tile.points.append(candidate);
+        }
+    };
+
+    QList<int> phase;
+    for (int parity = 0; parity < 4; ++parity) {
+        phase.clear();
+        for (int t = 0; t < tiles.size(); ++t) {
+            if ((t % tilesX) % 2 == parity % 2 && (t / tilesX) % 2 == parity / 2) {
+                phase.append(t);
+            }
+        }
+        runTasks(int(phase.size()), pool, [&](int i) { fill(phase.at(i)); });
+    }
+
+    QList<QList<Point>> points;
+    points.reserve(tiles.size());
+    qsizetype placed = 0;
+    for (Tile &tile : tiles) {
+        placed += tile.points.size();
+        points.append(std::move(tile.points));
+    }
+    if (placed < count) {
+        Logger::instance().warning(QString("Scatter region fits only %1 of %2 objects at spacing %3")
+                                       .arg(placed).arg(count).arg(spacing));
+    }
+    return points;
+}
+
+QStringList LayoutGenerator::generators()
+{
+    return {"warehouse", "office", "parking", "maze", "scatter"};
+}
+
+QString LayoutGenerator::entryName(const QJsonObject &entry, int index)
+{
+    QString name = entry.value(PlanKey::Name).toString();
+    if (name.isEmpty()) {
+        name = QString("%1_%2").arg(entry.value(PlanKey::Generator).toString()).arg(index);
+    }
+    return name;
+}
+
+int LayoutGenerator::generate(const QJsonObject &entry, int index, Scene *scene, int maxModels,
+                              QThreadPool *pool)
+{
+    QString generator = entry.value(PlanKey::Generator).toString();
+    if (!generators().contains(generator)) {
+        Logger::instance().warning("Unknown layout generator \"" + generator + "\"");
+        return 0;
+    }
+
+    int limit = qMin(maxModels, kMaxModels);
+    if (limit <= 0) {
+        return 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    Parameters p = readParameters(entry, generator, entryName(entry, index), limit);
+    Parts parts;
+    if (generator == "warehouse") {
+        parts = warehouse(p, pool);
+    } else if (generator == "office") {
+        parts = office(p, pool);
+    } else if (generator == "parking") {
+        parts = parking(p, pool);
+    } else if (generator == "maze") {
+        parts = maze(p, pool);
+    } else {
+        parts = scatter(p, pool);
+    }
+
+    // Whole rows are limited up front; the last one may still overshoot
+    qsizetype total = 0;
+    for (const QList<Model> &models : parts) {
+        total += models.size();
+    }
+    total = qMin<qsizetype>(total, limit);
+    scene->reserve(total);
+    qsizetype appended = 0;
+    for (const QList<Model> &models : parts) {
+        for (const Model &model : models) {
+            if (appended == total) {
+                break;
+            }
+            scene->append(model);
+            ++appended;
+        }
+    }
+
+    Logger::instance().info(QString("Generated %1 layout \"%2\" with %3 models in %4 ms")
+                                .arg(generator, p.name).arg(total).arg(timer.elapsed()));
+    return int(total);
+}
+
+} // namespace Burma
@@ -0,0 +1,130 @@
+#include "core/RepeatExpander.h"
+#include "core/LayoutGenerator.h"
+#include "core/WorldPlanSchema.h"
+#include "utils/Logger.h"
+
+#include <QVector>
+#include <QtMath>
+
+namespace Burma {
+
+namespace {
+
+struct Point {
+    double x;
+    double y;
+};
+
+QVector<Point> arrayLayout(int count, double spacing)
+{
+    QVector<Point> points;
+    points.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        points.append({i * spacing, 0.0});
+    }
+    return points;
+}
+
+QVector<Point> gridLayout(int count, double spacing, int rows)
+{
+    if (rows <= 0) {
+        rows = qMax(1, qRound(std::sqrt(double(count))));
+    }
+    int columns = (count + rows - 1) / rows;
+
+    QVector<Point> points;
+    points.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        points.append({(i % columns) * spacing, (i / columns) * spacing});
+    }
+    return points;
+}
+
+QVector<Point> ringLayout(int count, double spacing, double radius)
+{
+    if (radius <= 0.0) {
+        // Spacing is the arc length between neighbours
+        radius = count * spacing / (2.0 * M_PI);
+    }
+
+    QVector<Point> points;
+    points.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        double angle = 2.0 * M_PI * i / count;
+        points.append({radius * std::cos(angle), radius * std::sin(angle)});
+    }
+    return points;
+}
+
+// The scatter layout's sampler, so the two scatter the same way
+QVector<Point> scatterLayout(int count, double spacing, double width, double depth, quint32 seed)
+{
+    QVector<Point> points;
+    points.reserve(count);
+    const QList<QList<LayoutGenerator::Point>> tiles =
+        LayoutGenerator::scatterPoints(count, spacing, width, depth, seed);
+    for (const QList<LayoutGenerator::Point> &tile : tiles) {
+        for (const LayoutGenerator::Point &point : tile) {
+            points.append({point.x, point.y});
+        }
+    }
+    return points;
+}
+
+} // namespace
+
+int RepeatExpander::instanceCount(const QJsonObject &model)
+{
+    QJsonValue repeat = model.value(PlanKey::Repeat);
+    if (!repeat.isObject()) {
+        return 1;
+    }
+    return qBound(0, qRound(repeat.toObject().value(PlanKey::Count).toDouble()), kMaxInstances);
+}
+
+int RepeatExpander::expand(const Scene::Model &prototype, const QJsonObject &repeat, Scene *scene,
+                           int maxModels)
+{
+    int requested = qBound(0, qRound(repeat.value(PlanKey::Count).toDouble()), kMaxInstances);
+    int count = qMin(requested, qMax(0, maxModels));
+    if (count < requested) {
+        Logger::instance().warning(QString("Repeat of %1 limited to %2 of %3 copies by the plan's model limit")
+                                       .arg(prototype.name).arg(count).arg(requested));
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    QString pattern = repeat.value(PlanKey::Pattern).toString();
+    double spacing = repeat.value(PlanKey::Spacing).toDouble(1.0);
+
+    QVector<Point> offsets;
+    if (pattern == "grid") {
+        offsets = gridLayout(count, spacing, qRound(repeat.value(PlanKey::Rows).toDouble()));
+    } else if (pattern == "ring") {
+        offsets = ringLayout(count, spacing, repeat.value(PlanKey::Radius).toDouble());
+    } else if (pattern == "scatter") {
+        QJsonObject region = repeat.value(PlanKey::Region).toObject();
+        offsets = scatterLayout(count, spacing, region.value("x").toDouble(),
+                                region.value("y").toDouble(),
+                                quint32(repeat.value(PlanKey::Seed).toDouble()));
+    } else {
+        offsets = arrayLayout(count, spacing);
+    }
+
+    // Copies differ from the prototype only in name and pose
+    scene->reserve(offsets.size());
+    Scene::Model instance = prototype;
+    for (int i = 0; i < offsets.size(); ++i) {
+        instance.name = QString("%1_%2").arg(prototype.name).arg(i);
+        instance.position.x = float(prototype.position.x + offsets.at(i).x);
+        instance.position.y = float(prototype.position.y + offsets.at(i).y);
+        if (pattern == "ring") {
+            instance.rotation.z = float(prototype.rotation.z + std::atan2(offsets.at(i).y, offsets.at(i).x));
+        }
+        scene->append(instance);
+    }
+    return int(offsets.size());
+}
+
+} // namespace Burma
@@ -0,0 +1,326 @@
+#include "core/Scene.h"
+#include "core/WorldPlanSchema.h"
+#include "core/LayoutGenerator.h"
+#include "core/RepeatExpander.h"
+#include "utils/Logger.h"
+
+#include <cstring>
+
+namespace Burma {
+
+namespace {
+
+Scene::Vec3 readVec3(const QJsonValue &value, const QString &a, const QString &b, const QString &c,
+                     const Scene::Vec3 &defaults)
+{
+    QJsonObject object = value.toObject();
+    return {float(object.value(a).toDouble(defaults.x)),
+            float(object.value(b).toDouble(defaults.y)),
+            float(object.value(c).toDouble(defaults.z))};
+}
+
+// Dimensions of a shape whose plan gives no scale
+Scene::Vec3 defaultScale(Scene::Geometry geometry)
+{
+    switch (geometry) {
+    case Scene::Geometry::Sphere:
+    case Scene::Geometry::Cylinder:
+        return {0.5f, 1.0f, 1.0f};
+    default:
+        return {1.0f, 1.0f, 1.0f};
+    }
+}
+
+} // namespace
+
+Scene Scene::fromPlan(const QJsonObject &plan, QThreadPool *pool)
+{
+    Scene scene;
+    scene.m_worldName = plan.value(PlanKey::WorldName).toString("generated_world");
+
+    QJsonObject physics = plan.value(PlanKey::Physics).toObject();
+    scene.m_physics.gravity = physics.value(PlanKey::Gravity).toString(scene.m_physics.gravity);
+    scene.m_physics.maxStepSize = physics.value(PlanKey::MaxStepSize).toDouble(scene.m_physics.maxStepSize);
+    scene.m_physics.realTimeFactor = physics.value(PlanKey::RealTimeFactor)
+                                         .toDouble(scene.m_physics.realTimeFactor);
+
+    const QJsonArray lights = plan.value(PlanKey::Lighting).toArray();
+    for (const QJsonValue &lightVal : lights) {
+        QJsonObject object = lightVal.toObject();
+        Light light;
+        light.name = object.value(PlanKey::Name).toString("light");
+        light.type = object.value(PlanKey::Type).toString("directional");
+        light.position = readVec3(object.value(PlanKey::Position), "x", "y", "z", {0.0f, 0.0f, 10.0f});
+        light.diffuse = object.value(PlanKey::Diffuse).toString("1 1 1 1");
+        scene.m_lights.append(light);
+    }
+
+    // Listed and repeated models, then generated layouts, share one budget
+    int budget = kMaxModels - scene.appendModels(plan.value(PlanKey::Models).toArray());
+
+    const QJsonArray generators = plan.value(PlanKey::Generators).toArray();
+    for (qsizetype i = 0; i < generators.size(); ++i) {
+        if (budget <= 0) {
+            Logger::instance().warning(QString("Layout generators stopped at %1 models; %2 of %3 entries skipped")
+                                           .arg(kMaxModels)
+                                           .arg(generators.size() - i)
+                                           .arg(generators.size()));
+            break;
+        }
+        budget -= LayoutGenerator::generate(generators.at(i).toObject(), int(i), &scene, budget, pool);
+    }
+    return scene;
+}
+
+Scene Scene::fromModels(const QJsonArray &models)
+{
+    Scene scene;
+    scene.appendModels(models);
+    return scene;
+}
+
+int Scene::appendModels(const QJsonArray &models, int maxModels)
+{
+    int appended = 0;
+    int directives = 0;
+    int skipped = 0;
+    reserve(qMin<qsizetype>(models.size(), qMax(0, maxModels)));
+
+    for (const QJsonValue &modelVal : models) {
+        QJsonObject model = modelVal.toObject();
+        if (appended >= maxModels) {
+            ++skipped;
+            continue;
+        }
+
+        QJsonValue repeat = model.value(PlanKey::Repeat);
+        if (repeat.isObject()) {
+            ++directives;
+            appended += RepeatExpander::expand(modelFromPlan(model), repeat.toObject(), this,
+                                               maxModels - appended);
+        } else {
+            append(modelFromPlan(model));
+            ++appended;
+        }
+    }
+
+    if (directives > 0) {
+        Logger::instance().info(QString("Expanded %1 repeat directives into %2 models")
+                                    .arg(directives).arg(appended));
+    }
+    if (skipped > 0) {
+        Logger::instance().warning(QString("Models stopped at %1; %2 entries skipped")
+                                       .arg(maxModels).arg(skipped));
+    }
+    return appended;
+}
+
+void Scene::reserve(qsizetype additional)
+{
+    qsizetype capacity = m_geometry.size() + additional;
+    m_nameIds.reserve(capacity);
+    m_geometry.reserve(capacity);
+    m_positions.reserve(capacity);
+    m_rotations.reserve(capacity);
+    m_scales.reserve(capacity);
+    m_colors.reserve(capacity);
+    m_flags.reserve(capacity);
+}
+
+Scene::Model Scene::modelFromPlan(const QJsonObject &model)
+{
+    Model entry;
+    entry.name = model.value(PlanKey::Name).toString("unnamed_model");
+    QString type = model.value(PlanKey::Type).toString("box");
+    entry.geometry = geometryFromName(type);
+    if (entry.geometry == Geometry::Unknown || entry.geometry == Geometry::Mesh) {
+        // Plans have no mesh URIs
+        Logger::instance().warning("Unsupported geometry type \"" + type + "\" for model " + entry.name);
+        entry.geometry = Geometry::Unknown;
+    }
+    entry.isStatic = model.value(PlanKey::Static).toBool(false);
+
+    // An explicitly empty color means no material at all
+    QString color = model.value(PlanKey::Color).toString("#FFFFFF");
+    if (!color.isEmpty()) {
+        entry.hasColor = parseColor(color, &entry.color);
+        if (!entry.hasColor) {
+            Logger::instance().warning("Invalid color \"" + color + "\" for model " + entry.name);
+        }
+    }
+
+    entry.position = readVec3(model.value(PlanKey::Position), "x", "y", "z", {});
+    entry.rotation = readVec3(model.value(PlanKey::Rotation), "roll", "pitch", "yaw", {});
+    entry.scale = readVec3(model.value(PlanKey::Scale), "x", "y", "z", defaultScale(entry.geometry));
+    return entry;
+}
+
+void Scene::append(const Model &model)
+{
+    quint8 flags = 0;
+    if (model.isStatic) {
+        flags |= Static;
+    }
+    if (model.hasColor) {
+        flags |= Colored;
+    }
+
+    quint32 nameId = intern(model.name);
+    if (m_firstModel.at(nameId) < 0) {
+        m_firstModel[nameId] = size();
+    }
+    if (model.geometry == Geometry::Mesh) {
+        m_meshUris.insert(size(), model.meshUri);
+    }
+
+    m_nameIds.append(nameId);
+    m_geometry.append(model.geometry);
+    m_positions.append(model.position);
+    m_rotations.append(model.rotation);
+    m_scales.append(model.scale);
+    m_colors.append(model.hasColor ? model.color : 0xFFFFFF);
+    m_flags.append(flags);
+}
+
+void Scene::clear()
+{
+    *this = Scene();
+}
+
+size_t Scene::modelHash(int i) const
+{
+    // Bit patterns rather than float values, so -0 and 0, which format
+    // differently, don't hash alike
+    static_assert(sizeof(Vec3) == 3 * sizeof(quint32), "Vec3 must be three packed floats");
+    quint32 fields[11];
+    std::memcpy(fields, &m_positions.at(i), sizeof(Vec3));
+    std::memcpy(fields + 3, &m_rotations.at(i), sizeof(Vec3));
+    std::memcpy(fields + 6, &m_scales.at(i), sizeof(Vec3));
+    fields[9] = m_colors.at(i);
+    fields[10] = quint32(m_geometry.at(i)) << 8 | m_flags.at(i);
+    size_t hash = qHashBits(fields, sizeof(fields), 0);
+    return m_geometry.at(i) == Geometry::Mesh ? qHash(m_meshUris.value(i), hash) : hash;
+}
+
+size_t Scene::bodyHash(int i) const
+{
+    quint32 fields[5];
+    std::memcpy(fields, &m_scales.at(i), sizeof(Vec3));
+    fields[3] = m_colors.at(i);
+    fields[4] = quint32(m_geometry.at(i)) << 8 | (m_flags.at(i) & Colored);
+    size_t hash = qHashBits(fields, sizeof(fields), 0);
+    return m_geometry.at(i) == Geometry::Mesh ? qHash(m_meshUris.value(i), hash) : hash;
+}
+
+bool Scene::sameBody(int i, int j) const
+{
+    return m_geometry.at(i) == m_geometry.at(j)
+           && std::memcmp(&m_scales.at(i), &m_scales.at(j), sizeof(Vec3)) == 0
+           && m_colors.at(i) == m_colors.at(j)
+           && (m_flags.at(i) & Colored) == (m_flags.at(j) & Colored)
+           && m_meshUris.value(i) == m_meshUris.value(j);
+}
+
+void Scene::setPosition(int i, const Vec3 &position)
+{
+    m_positions[i] = position;
+}
+
+void Scene::setRotation(int i, const Vec3 &rotation)
+{
+    m_rotations[i] = rotation;
+}
+
+void Scene::setScale(int i, const Vec3 &scale)
+{
+    m_scales[i] = scale;
+}
+
+void Scene::setColor(int i, quint32 rgb)
+{
+    m_colors[i] = rgb;
+    m_flags[i] |= Colored;
+}
+
+void Scene::setStatic(int i, bool isStatic)
+{
+    if (isStatic) {
+        m_flags[i] |= Static;
+    } else {
+        m_flags[i] &= ~Static;
+    }
+}
+
+int Scene::indexOf(const QString &name) const
+{
+    auto it = m_nameTable.constFind(name);
+    return it == m_nameTable.constEnd() ? -1 : m_firstModel.at(*it);
+}
+
+quint32 Scene::intern(const QString &name)
+{
+    auto it = m_nameTable.constFind(name);
+    if (it != m_nameTable.constEnd()) {
+        return *it;
+    }
+
+    quint32 id = quint32(m_names.size());
+    m_names.append(name);
+    m_firstModel.append(-1);
+    m_nameTable.insert(name, id);
+    return id;
+}
+
+Scene::Geometry Scene::geometryFromName(const QString &type)
+{
+    if (type == QLatin1String("box")) {
+        return Geometry::Box;
+    }
+    if (type == QLatin1String("sphere")) {
+        return Geometry::Sphere;
+    }
+    if (type == QLatin1String("cylinder")) {
+        return Geometry::Cylinder;
+    }
+    if (type == QLatin1String("mesh")) {
+        return Geometry::Mesh;
+    }
+    return Geometry::Unknown;
+}
+
+QString Scene::geometryName(Geometry geometry)
+{
+    switch (geometry) {
+    case Geometry::Box:
+        return QStringLiteral("box");
+    case Geometry::Sphere:
+        return QStringLiteral("sphere");
+    case Geometry::Cylinder:
+        return QStringLiteral("cylinder");
+    case Geometry::Mesh:
+        return QStringLiteral("mesh");
+    case Geometry::Unknown:
+        break;
+    }
+    return QStringLiteral("unknown");
+}
+
+bool Scene::parseColor(const QString &name, quint32 *rgb)
+{
+    if (name.size() != 7 || name.at(0) != QLatin1Char('#')) {
+        return false;
+    }
+    bool ok = false;
+    quint32 value = QStringView(name).mid(1).toUInt(&ok, 16);
+    if (ok) {
+        *rgb = value;
+    }
+    return ok;
+}
+
+QString Scene::colorName(quint32 rgb)
+{
+    return QString("#%1").arg(rgb, 6, 16, QLatin1Char('0')).toUpper();
+}
+
+} // namespace Burma
@@ -0,0 +1,131 @@
+#include "core/WorldPlanPatch.h"
+#include "core/WorldPlanSchema.h"
+#include "core/LayoutGenerator.h"
+#include "utils/Logger.h"
+
+#include <QJsonArray>
+
+namespace Burma {
+
+namespace {
+
+QString number(double value)
+{
+    return QString::number(value, 'g', 4);
+}
+
+QString vector(const QJsonObject &object, const QString &a, const QString &b, const QString &c)
+{
+    return number(object.value(a).toDouble()) + " " + number(object.value(b).toDouble()) + " "
+           + number(object.value(c).toDouble());
+}
+
+int indexOfModel(const QJsonArray &models, const QString &name)
+{
+    for (int i = 0; i < models.size(); ++i) {
+        if (models.at(i).toObject().value(PlanKey::Name).toString() == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+QStringList WorldPlanPatch::summarize(const QJsonObject &plan)
+{
+    QStringList lines;
+    const QJsonArray models = plan.value(PlanKey::Models).toArray();
+    for (const QJsonValue &value : models) {
+        QJsonObject model = value.toObject();
+        QJsonObject rotation = model.value(PlanKey::Rotation).toObject();
+        QJsonObject repeat = model.value(PlanKey::Repeat).toObject();
+        QString repeated = repeat.isEmpty() ? QString()
+            : QString(", repeat %1 x%2").arg(repeat.value(PlanKey::Pattern).toString())
+                                        .arg(repeat.value(PlanKey::Count).toDouble());
+        lines << QString("%1: %2 at %3, scale %4, yaw %5, %6%7%8")
+                     .arg(model.value(PlanKey::Name).toString(),
+                          model.value(PlanKey::Type).toString(),
+                          vector(model.value(PlanKey::Position).toObject(), "x", "y", "z"),
+                          vector(model.value(PlanKey::Scale).toObject(), "x", "y", "z"),
+                          number(rotation.value("yaw").toDouble()),
+                          model.value(PlanKey::Color).toString(),
+                          QString(model.value(PlanKey::Static).toBool() ? ", static" : ""),
+                          repeated);
+    }
+
+    // Context only; patches change listed models, not generated layouts
+    const QJsonArray generators = plan.value(PlanKey::Generators).toArray();
+    for (qsizetype i = 0; i < generators.size(); ++i) {
+        QJsonObject generator = generators.at(i).toObject();
+        lines << QString("%1: %2 layout at %3")
+                     .arg(LayoutGenerator::entryName(generator, int(i)),
+                          generator.value(PlanKey::Generator).toString(),
+                          vector(generator.value(PlanKey::Position).toObject(), "x", "y", "z"));
+    }
+    return lines;
+}
+
+bool WorldPlanPatch::apply(QJsonObject &plan, const QJsonObject &patch,
+                           QStringList *changedModels, QString *error)
+{
+    QJsonArray models = plan.value(PlanKey::Models).toArray();
+    QStringList changed;
+
+    const QJsonArray operations = patch.value(PlanKey::Operations).toArray();
+    for (const QJsonValue &value : operations) {
+        QJsonObject operation = value.toObject();
+        QString op = operation.value(PlanKey::Op).toString();
+
+        if (op == PatchOp::Add) {
+            QJsonObject model = operation.value(PlanKey::Model).toObject();
+            QString name = model.value(PlanKey::Name).toString();
+
+            // Re-adding an existing name replaces it instead of duplicating it
+            int index = indexOfModel(models, name);
+            if (index >= 0) {
+                models.replace(index, model);
+            } else {
+                models.append(model);
+            }
+            changed << name;
+            continue;
+        }
+
+        QString name = operation.value(PlanKey::Name).toString();
+        int index = indexOfModel(models, name);
+        if (index < 0) {
+            Logger::instance().warning("Edit refers to unknown model \"" + name + "\", skipped");
+            continue;
+        }
+
+        if (op == PatchOp::Remove) {
+            models.removeAt(index);
+        } else {
+            QJsonObject model = models.at(index).toObject();
+            for (auto it = operation.constBegin(); it != operation.constEnd(); ++it) {
+                if (it.key() != PlanKey::Op && it.key() != PlanKey::Name) {
+                    model[it.key()] = it.value();
+                }
+            }
+            models.replace(index, model);
+        }
+        changed << name;
+    }
+
+    if (changed.isEmpty()) {
+        if (error) {
+            *error = "No operation matched a model in the current world";
+        }
+        return false;
+    }
+
+    plan[PlanKey::Models] = models;
+    changed.removeDuplicates();
+    if (changedModels) {
+        *changedModels = changed;
+    }
+    return true;
+}
+
+} // namespace Burma
@@ -0,0 +1,396 @@
+#include "core/WorldPlanSchema.h"
+#include "core/LayoutGenerator.h"
+
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QRegularExpression>
+
+namespace Burma {
+
+namespace {
+
+using Node = WorldPlanSchema::Node;
+using Kind = WorldPlanSchema::Kind;
+
+Node leaf(const QString &name, Kind kind, bool required = true)
+{
+    Node node;
+    node.name = name;
+    node.kind = kind;
+    node.required = required;
+    return node;
+}
+
+Node enumeration(const QString &name, const QStringList &values)
+{
+    Node node = leaf(name, Kind::Enum);
+    node.values = values;
+    return node;
+}
+
+Node object(const QString &name, const QList<Node> &fields, bool required = true)
+{
+    Node node = leaf(name, Kind::Object, required);
+    node.children = fields;
+    return node;
+}
+
+Node array(const QString &name, const Node &element, int minItems)
+{
+    Node node = leaf(name, Kind::Array);
+    node.minItems = minItems;
+    node.children = {element};
+    return node;
+}
+
+Node offer(Node node)
+{
+    node.required = false;
+    node.offered = true;
+    return node;
+}
+
+Node vector3(const QString &name, const QString &a, const QString &b, const QString &c)
+{
+    return object(name, {leaf(a, Kind::Number), leaf(b, Kind::Number), leaf(c, Kind::Number)});
+}
+
+Node buildRoot()
+{
+    // One model can stand for many copies instead of the LLM listing each one
+    Node repeat = offer(object(PlanKey::Repeat, {
+        enumeration(PlanKey::Pattern, WorldPlanSchema::repeatPatterns()),
+        leaf(PlanKey::Count, Kind::Number),
+        leaf(PlanKey::Spacing, Kind::Number),
+        offer(leaf(PlanKey::Rows, Kind::Number)),
+        offer(leaf(PlanKey::Radius, Kind::Number)),
+        offer(object(PlanKey::Region, {leaf("x", Kind::Number), leaf("y", Kind::Number)})),
+        offer(leaf(PlanKey::Seed, Kind::Number))
+    }));
+
+    Node model = object("model", {
+        leaf(PlanKey::Name, Kind::String),
+        enumeration(PlanKey::Type, WorldPlanSchema::geometryTypes()),
+        vector3(PlanKey::Position, "x", "y", "z"),
+        vector3(PlanKey::Rotation, "roll", "pitch", "yaw"),
+        vector3(PlanKey::Scale, "x", "y", "z"),
+        leaf(PlanKey::Color, Kind::Color),
+        leaf(PlanKey::Static, Kind::Boolean),
+        repeat
+    });
+
+    // A whole structured layout from a few numbers, for worlds far larger
+    // than the plan could list
+    Node generator = object("generator", {
+        enumeration(PlanKey::Generator, WorldPlanSchema::layoutGenerators()),
+        offer(leaf(PlanKey::Name, Kind::String)),
+        offer(vector3(PlanKey::Position, "x", "y", "z")),
+        offer(leaf(PlanKey::Rows, Kind::Number)),
+        offer(leaf(PlanKey::Columns, Kind::Number)),
+        offer(leaf(PlanKey::Levels, Kind::Number)),
+        offer(leaf(PlanKey::Count, Kind::Number)),
+        offer(leaf(PlanKey::Spacing, Kind::Number)),
+        offer(leaf(PlanKey::Density, Kind::Number)),
+        offer(object(PlanKey::Region, {leaf("x", Kind::Number), leaf("y", Kind::Number)})),
+        offer(leaf(PlanKey::Seed, Kind::Number))
+    });
+
+    Node light = object("light", {
+        leaf(PlanKey::Name, Kind::String),
+        enumeration(PlanKey::Type, {"directional", "point", "spot"}),
+        vector3(PlanKey::Position, "x", "y", "z"),
+        leaf(PlanKey::Diffuse, Kind::String, false)
+    });
+
+    Node physics = object(PlanKey::Physics, {
+        leaf(PlanKey::Gravity, Kind::String),
+        leaf(PlanKey::MaxStepSize, Kind::Number),
+        leaf(PlanKey::RealTimeFactor, Kind::Number, false)
+    });
+
+    return object("root", {
+        leaf(PlanKey::WorldName, Kind::String),
+        array(PlanKey::Models, model, 1),
+        offer(array(PlanKey::Generators, generator, 0)),
+        array(PlanKey::Lighting, light, 0),
+        physics
+    });
+}
+
+QString literal(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("\"", "\\\"");
+    return "\"" + escaped + "\"";
+}
+
+QString ruleName(const QString &name)
+{
+    QString rule = name.toLower();
+    rule.replace(QRegularExpression("[^a-z0-9]"), "-");
+    return rule;
+}
+
+QStringList terminalRules()
+{
+    // Shared terminals; whitespace is limited so the model can't pad forever
+    return {
+        "string ::= \"\\\"\" ( [^\"\\\\\\x7F\\x00-\\x1F] | \"\\\\\" [\"\\\\/bfnrt] )* \"\\\"\"",
+        "number ::= \"-\"? [0-9]+ (\".\" [0-9]+)? ([eE] [-+]? [0-9]+)?",
+        "boolean ::= \"true\" | \"false\"",
+        "color ::= \"\\\"#\" hex hex hex hex hex hex \"\\\"\"",
+        "hex ::= [0-9a-fA-F]",
+        "ws ::= \" \"?"
+    };
+}
+
+} // namespace
+
+const WorldPlanSchema::Node& WorldPlanSchema::root()
+{
+    static const Node schema = buildRoot();
+    return schema;
+}
+
+const WorldPlanSchema::Node& WorldPlanSchema::modelNode()
+{
+    for (const Node &field : root().children) {
+        if (field.name == PlanKey::Models) {
+            return field.children.first();
+        }
+    }
+    Q_ASSERT(false);  // buildRoot() always has a models array
+    return root();
+}
+
+QStringList WorldPlanSchema::geometryTypes()
+{
+    return {"box", "sphere", "cylinder"};
+}
+
+QStringList WorldPlanSchema::repeatPatterns()
+{
+    return {"array", "grid", "ring", "scatter"};
+}
+
+QStringList WorldPlanSchema::layoutGenerators()
+{
+    return LayoutGenerator::generators();
+}
+
+QString WorldPlanSchema::grammar()
+{
+    static const QString cached = [] {
+        QStringList rules;
+        ruleFor(root(), "root", rules);
+        rules << terminalRules();
+
+        return rules.join("\n") + "\n";
+    }();
+    return cached;
+}
+
+QString WorldPlanSchema::patchGrammar()
+{
+    static const QString cached = [] {
+        QStringList rules;
+        const Node &model = modelNode();
+        QString modelRule = ruleFor(model, "model", rules);
+
+        // A modify operation names the model, then lists only the fields it changes
+        QString modify;
+        for (const Node &field : model.children) {
+            if (field.name == PlanKey::Name) {
+                continue;
+            }
+            modify += " (ws \",\" ws " + literal("\"" + field.name + "\"") + " ws \":\" ws "
+                      + ruleFor(field, "model-" + ruleName(field.name), rules) + ")?";
+        }
+        rules.removeDuplicates();
+
+        auto header = [](const QString &op) {
+            return "\"{\" ws " + literal("\"" + PlanKey::Op + "\"") + " ws \":\" ws "
+                   + literal("\"" + op + "\"") + " ws \",\" ws ";
+        };
+        QString name = literal("\"" + PlanKey::Name + "\"") + " ws \":\" ws string";
+
+        rules.prepend("op-modify ::= " + header(PatchOp::Modify) + name + modify + " ws \"}\"");
+        rules.prepend("op-remove ::= " + header(PatchOp::Remove) + name + " ws \"}\"");
+        rules.prepend("op-add ::= " + header(PatchOp::Add) + literal("\"" + PlanKey::Model + "\"")
+                      + " ws \":\" ws " + modelRule + " ws \"}\"");
+        rules.prepend("op ::= op-add | op-remove | op-modify");
+        rules.prepend("root ::= \"{\" ws " + literal("\"" + PlanKey::Operations + "\"")
+                      + " ws \":\" ws \"[\" ws op (ws \",\" ws op)* ws \"]\" ws \"}\"");
+        rules << terminalRules();
+
+        return rules.join("\n") + "\n";
+    }();
+    return cached;
+}
+
+QString WorldPlanSchema::ruleFor(const Node &node, const QString &name, QStringList &rules)
+{
+    switch (node.kind) {
+    case Kind::String:
+        return "string";
+    case Kind::Number:
+        return "number";
+    case Kind::Boolean:
+        return "boolean";
+    case Kind::Color:
+        return "color";
+    case Kind::Enum: {
+        QStringList options;
+        for (const QString &value : node.values) {
+            options << literal("\"" + value + "\"");
+        }
+        return "(" + options.join(" | ") + ")";
+    }
+    case Kind::Array: {
+        const Node &element = node.children.first();
+        QString item = ruleFor(element, ruleName(element.name), rules);
+        QString items = item + " (ws \",\" ws " + item + ")*";
+        if (node.minItems == 0) {
+            items = "(" + items + ")?";
+        }
+        return "\"[\" ws " + items + " ws \"]\"";
+    }
+    case Kind::Object: {
+        QStringList parts;
+        QString offered;
+        for (const Node &field : node.children) {
+            if (!field.required && !field.offered) {
+                continue;
+            }
+            QString childRule = name == "root" ? ruleName(field.name)
+                                               : name + "-" + ruleName(field.name);
+            QString member = literal("\"" + field.name + "\"") + " ws \":\" ws " + ruleFor(field, childRule, rules);
+            if (field.required) {
+                parts << member;
+            } else {
+                offered += " (ws \",\" ws " + member + ")?";
+            }
+        }
+        rules << name + " ::= \"{\" ws " + parts.join(" \",\" ws ") + offered + " ws \"}\"";
+        return name;
+    }
+    }
+    return "string";
+}
+
+bool WorldPlanSchema::validate(const QJsonObject &plan, QString *error)
+{
+    return validateValue(root(), plan, QString(), error);
+}
+
+bool WorldPlanSchema::validatePatch(const QJsonObject &patch, QString *error)
+{
+    auto reject = [&](const QString &reason) {
+        if (error) {
+            *error = reason;
+        }
+        return false;
+    };
+
+    QJsonArray operations = patch.value(PlanKey::Operations).toArray();
+    if (operations.isEmpty()) {
+        return reject("patch has no operations");
+    }
+
+    const Node &model = modelNode();
+    for (int i = 0; i < operations.size(); ++i) {
+        QJsonObject operation = operations.at(i).toObject();
+        QString path = QString("%1[%2]").arg(PlanKey::Operations).arg(i);
+        QString op = operation.value(PlanKey::Op).toString();
+
+        if (op == PatchOp::Add) {
+            if (!validateValue(model, operation.value(PlanKey::Model), path + "." + PlanKey::Model, error)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (op != PatchOp::Remove && op != PatchOp::Modify) {
+            return reject(path + ": unsupported op \"" + op + "\"");
+        }
+        if (!operation.value(PlanKey::Name).isString()) {
+            return reject(path + ": missing \"" + PlanKey::Name + "\"");
+        }
+
+        if (op == PatchOp::Modify) {
+            for (const Node &field : model.children) {
+                if (field.name != PlanKey::Name && operation.contains(field.name)
+                    && !validateValue(field, operation.value(field.name), path + "." + field.name, error)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool WorldPlanSchema::validateValue(const Node &node, const QJsonValue &value,
+                                    const QString &path, QString *error)
+{
+    auto reject = [&](const QString &reason) {
+        if (error) {
+            *error = (path.isEmpty() ? QString("plan") : path) + ": " + reason;
+        }
+        return false;
+    };
+
+    switch (node.kind) {
+    case Kind::String:
+        return value.isString() || reject("expected string");
+    case Kind::Number:
+        return value.isDouble() || reject("expected number");
+    case Kind::Boolean:
+        return value.isBool() || reject("expected boolean");
+    case Kind::Color:
+        return value.isString() || reject("expected color string");
+    case Kind::Enum:
+        if (!node.values.contains(value.toString())) {
+            return reject("unsupported value \"" + value.toString() + "\"");
+        }
+        return true;
+    case Kind::Array: {
+        if (!value.isArray()) {
+            return reject("expected array");
+        }
+        QJsonArray items = value.toArray();
+        if (items.size() < node.minItems) {
+            return reject(QString("expected at least %1 entries").arg(node.minItems));
+        }
+        for (int i = 0; i < items.size(); ++i) {
+            if (!validateValue(node.children.first(), items.at(i),
+                               QString("%1[%2]").arg(path).arg(i), error)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case Kind::Object: {
+        if (!value.isObject()) {
+            return reject("expected object");
+        }
+        QJsonObject obj = value.toObject();
+        for (const Node &field : node.children) {
+            QString fieldPath = path.isEmpty() ? field.name : path + "." + field.name;
+            if (!obj.contains(field.name)) {
+                if (field.required) {
+                    return reject("missing \"" + field.name + "\"");
+                }
+                continue;
+            }
+            if (!validateValue(field, obj.value(field.name), fieldPath, error)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    }
+    return true;
+}
+
+} // namespace Burma
@@ -0,0 +1,501 @@
+#include "modules/AssetIndex.h"
+#include "utils/Logger.h"
+
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <random>
+
+// The AVX2 scorer is compiled for the target alone and picked at runtime,
+// so the default build needs no -mavx2 and still runs on older CPUs
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BURMA_ASSETINDEX_AVX2
+#include <immintrin.h>
+#endif
+
+namespace Burma {
+
+// On-disk layout, every section 32-byte aligned:
+//   Header | centroids float[lists*dim] | listOffsets u32[lists+1] | scales float[count]
+//   | vectors i8[count*dim] | textOffsets u32[count+1] | text (UTF-8)
+// Entries are stored grouped by list, so a list is one contiguous range.
+struct AssetIndex::Header {
+    char magic[4];
+    quint32 version;
+    quint32 dimensions;
+    quint32 count;
+    quint32 lists;
+    quint32 textBytes;
+};
+
+namespace {
+
+constexpr char kMagic[4] = {'B', 'A', 'I', 'X'};
+constexpr quint32 kVersion = 1;
+constexpr int kBruteForceLimit = 4096;  // Below this a single list is scanned
+constexpr int kMaxLists = 1024;
+constexpr int kProbes = 8;              // Lists scanned per query
+constexpr int kTrainingSample = 20000;
+constexpr int kKMeansIterations = 8;
+constexpr float kMinScore = 0.1f;       // Ignore matches that only share noise features
+
+qint64 aligned(qint64 offset)
+{
+    return (offset + 31) & ~qint64(31);
+}
+
+quint32 fnv1a(const QByteArray &bytes)
+{
+    quint32 hash = 2166136261u;
+    for (char c : bytes) {
+        hash ^= quint8(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void addFeature(QVector<float> &vector, const QByteArray &feature, float weight)
+{
+    // Signed feature hashing: collisions cancel out instead of piling up
+    quint32 hash = fnv1a(feature);
+    vector[hash % AssetIndex::kDimensions] += (hash & 0x80000000u) ? -weight : weight;
+}
+
+QVector<float> embed(const QString &text)
+{
+    static const QRegularExpression separators("[^\\p{L}\\p{N}]+");
+
+    QVector<float> vector(AssetIndex::kDimensions, 0.0f);
+    const QStringList words = text.toLower().split(separators, Qt::SkipEmptyParts);
+    for (const QString &word : words) {
+        QByteArray utf8 = word.toUtf8();
+        addFeature(vector, "w:" + utf8, 2.0f);
+
+        // Character trigrams match plurals and compounds ("shelves", "bookshelf")
+        QByteArray padded = "^" + utf8 + "$";
+        for (int i = 0; i + 3 <= padded.size(); ++i) {
+            addFeature(vector, padded.mid(i, 3), 1.0f);
+        }
+    }
+
+    float norm = 0.0f;
+    for (float v : vector) {
+        norm += v * v;
+    }
+    if (norm > 0.0f) {
+        float inverse = 1.0f / std::sqrt(norm);
+        for (float &v : vector) {
+            v *= inverse;
+        }
+    }
+    return vector;
+}
+
+// Quantize to int8; the returned scale converts dot products back to floats
+float quantize(const float *vector, qint8 *out)
+{
+    float maxAbs = 0.0f;
+    for (int i = 0; i < AssetIndex::kDimensions; ++i) {
+        maxAbs = std::max(maxAbs, std::fabs(vector[i]));
+    }
+    float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+    for (int i = 0; i < AssetIndex::kDimensions; ++i) {
+        out[i] = qint8(std::lround(vector[i] / scale));
+    }
+    return scale;
+}
+
+float dotFloat(const float *a, const float *b)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < AssetIndex::kDimensions; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+using DotInt8 = qint32 (*)(const qint8 *a, const qint8 *b);
+
+// Plain widening multiply-add; compilers turn this into SSE2/NEON madd
+qint32 dotInt8Scalar(const qint8 *a, const qint8 *b)
+{
+    qint32 sum = 0;
+    for (int i = 0; i < AssetIndex::kDimensions; ++i) {
+        sum += qint16(a[i]) * qint16(b[i]);
+    }
+    return sum;
+}
+
+#if defined(BURMA_ASSETINDEX_AVX2)
+__attribute__((target("avx2")))
+qint32 dotInt8Avx2(const qint8 *a, const qint8 *b)
+{
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < AssetIndex::kDimensions; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(va, vb));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+// Chosen once per process from what the CPU supports
+DotInt8 dotInt8Kernel()
+{
+#if defined(BURMA_ASSETINDEX_AVX2)
+    static const DotInt8 kernel = __builtin_cpu_supports("avx2") ? dotInt8Avx2 : dotInt8Scalar;
+    return kernel;
+#else
+    return dotInt8Scalar;
+#endif
+}
+
+QString assetText(const AssetIndex::Asset &asset)
+{
+    // The name counts twice; it is what the prompt is most likely to mention
+    return asset.name + " " + asset.name + " " + asset.tags.join(' ') + " " + asset.description;
+}
+
+QString assetSummary(const AssetIndex::Asset &asset)
+{
+    QString summary = "Asset: " + asset.name;
+    if (!asset.owner.isEmpty()) {
+        summary += " by " + asset.owner;
+    }
+    if (!asset.dimensions.isEmpty()) {
+        summary += ", size " + asset.dimensions + " m";
+    }
+    return summary;
+}
+
+QVector<float> trainCentroids(const QVector<float> &vectors, int count, int lists)
+{
+    const int dim = AssetIndex::kDimensions;
+    std::mt19937 rng(1234);  // Fixed seed keeps rebuilds reproducible
+
+    QVector<int> sample(count);
+    std::iota(sample.begin(), sample.end(), 0);
+    std::shuffle(sample.begin(), sample.end(), rng);
+    sample.resize(std::min(count, std::max(kTrainingSample, lists * 4)));
+
+    QVector<float> centroids(lists * dim);
+    for (int c = 0; c < lists; ++c) {
+        std::memcpy(&centroids[c * dim], &vectors[sample[c] * dim], dim * sizeof(float));
+    }
+
+    // Spherical k-means: vectors are unit length, so assign by dot product
+    QVector<int> assignment(sample.size());
+    for (int iteration = 0; iteration < kKMeansIterations; ++iteration) {
+        for (int s = 0; s < sample.size(); ++s) {
+            const float *v = &vectors[sample[s] * dim];
+            int best = 0;
+            float bestScore = -2.0f;
+            for (int c = 0; c < lists; ++c) {
+                float score = dotFloat(v, &centroids[c * dim]);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = c;
+                }
+            }
+            assignment[s] = best;
+        }
+
+        QVector<float> sums(lists * dim, 0.0f);
+        for (int s = 0; s < sample.size(); ++s) {
+            const float *v = &vectors[sample[s] * dim];
+            float *sum = &sums[assignment[s] * dim];
+            for (int i = 0; i < dim; ++i) {
+                sum[i] += v[i];
+            }
+        }
+        for (int c = 0; c < lists; ++c) {
+            float *sum = &sums[c * dim];
+            float norm = std::sqrt(dotFloat(sum, sum));
+            if (norm == 0.0f) {
+                continue;  // Empty cluster keeps its previous centroid
+            }
+            for (int i = 0; i < dim; ++i) {
+                centroids[c * dim + i] = sum[i] / norm;
+            }
+        }
+    }
+    return centroids;
+}
+
+} // namespace
+
+AssetIndex::AssetIndex()
+    : m_data(nullptr)
+    , m_header(nullptr)
+    , m_centroids(nullptr)
+    , m_listOffsets(nullptr)
+    , m_scales(nullptr)
+    , m_vectors(nullptr)
+    , m_textOffsets(nullptr)
+    , m_text(nullptr)
+{
+}
+
+AssetIndex::~AssetIndex()
+{
+    unload();
+}
+
+bool AssetIndex::build(const QList<Asset> &assets, const QString &path, QString *error)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const int dim = kDimensions;
+    const int count = assets.size();
+    const int lists = count < kBruteForceLimit
+        ? 1 : std::min(kMaxLists, int(std::sqrt(double(count))));
+
+    QVector<float> vectors(qint64(count) * dim);
+    for (int i = 0; i < count; ++i) {
+        QVector<float> v = embed(assetText(assets.at(i)));
+        std::memcpy(&vectors[qint64(i) * dim], v.constData(), dim * sizeof(float));
+    }
+
+    QVector<float> centroids(dim, 0.0f);
+    QVector<int> assignment(count, 0);
+    if (lists > 1) {
+        centroids = trainCentroids(vectors, count, lists);
+        for (int i = 0; i < count; ++i) {
+            const float *v = &vectors[qint64(i) * dim];
+            float bestScore = -2.0f;
+            for (int c = 0; c < lists; ++c) {
+                float score = dotFloat(v, &centroids[c * dim]);
+                if (score > bestScore) {
+                    bestScore = score;
+                    assignment[i] = c;
+                }
+            }
+        }
+    }
+
+    // Group entries by list; stable so rebuilds of the same catalog are identical
+    QVector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return assignment[a] < assignment[b];
+    });
+
+    QVector<quint32> listOffsets(lists + 1, 0);
+    for (int i = 0; i < count; ++i) {
+        ++listOffsets[assignment[i] + 1];
+    }
+    for (int c = 0; c < lists; ++c) {
+        listOffsets[c + 1] += listOffsets[c];
+    }
+
+    QVector<float> scales(count);
+    QByteArray quantized(qint64(count) * dim, Qt::Uninitialized);
+    QVector<quint32> textOffsets(count + 1, 0);
+    QByteArray text;
+    for (int i = 0; i < count; ++i) {
+        int entry = order[i];
+        scales[i] = quantize(&vectors[qint64(entry) * dim],
+                             reinterpret_cast<qint8*>(quantized.data()) + qint64(i) * dim);
+        text += assetSummary(assets.at(entry)).toUtf8();
+        textOffsets[i + 1] = text.size();
+    }
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.dimensions = dim;
+    header.count = count;
+    header.lists = lists;
+    header.textBytes = text.size();
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+
+    auto writeSection = [&file](const void *data, qint64 bytes) {
+        file.write(QByteArray(aligned(file.pos()) - file.pos(), '\0'));
+        file.write(static_cast<const char*>(data), bytes);
+    };
+    writeSection(&header, sizeof(header));
+    writeSection(centroids.constData(), centroids.size() * sizeof(float));
+    writeSection(listOffsets.constData(), listOffsets.size() * sizeof(quint32));
+    writeSection(scales.constData(), scales.size() * sizeof(float));
+    writeSection(quantized.constData(), quantized.size());
+    writeSection(textOffsets.constData(), textOffsets.size() * sizeof(quint32));
+    writeSection(text.constData(), text.size());
+
+    if (!file.commit()) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+
+    Logger::instance().info(QString("Asset index built: %1 assets in %2 lists, %3 ms")
+                                .arg(count).arg(lists).arg(timer.elapsed()));
+    return true;
+}
+
+bool AssetIndex::load(const QString &path)
+{
+    unload();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    qint64 fileSize = m_file.size();
+    m_data = m_file.map(0, fileSize);
+    if (!m_data || fileSize < qint64(sizeof(Header))) {
+        unload();
+        return false;
+    }
+
+    const Header *header = reinterpret_cast<const Header*>(m_data);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion
+        || header->dimensions != quint32(kDimensions) || header->lists == 0) {
+        Logger::instance().warning("Asset index has an unknown format, ignoring: " + path);
+        unload();
+        return false;
+    }
+
+    // Walk the sections exactly as build() wrote them
+    qint64 offset = sizeof(Header);
+    auto section = [&](qint64 bytes) -> const uchar* {
+        offset = aligned(offset);
+        const uchar *start = m_data + offset;
+        offset += bytes;
+        return offset <= fileSize ? start : nullptr;
+    };
+    const uchar *centroids = section(qint64(header->lists) * kDimensions * sizeof(float));
+    const uchar *listOffsets = section((qint64(header->lists) + 1) * sizeof(quint32));
+    const uchar *scales = section(qint64(header->count) * sizeof(float));
+    const uchar *vectors = section(qint64(header->count) * kDimensions);
+    const uchar *textOffsets = section((qint64(header->count) + 1) * sizeof(quint32));
+    const uchar *text = section(header->textBytes);
+    if (!text) {
+        Logger::instance().warning("Asset index is truncated, ignoring: " + path);
+        unload();
+        return false;
+    }
+
+    m_header = header;
+    m_centroids = reinterpret_cast<const float*>(centroids);
+    m_listOffsets = reinterpret_cast<const quint32*>(listOffsets);
+    m_scales = reinterpret_cast<const float*>(scales);
+    m_vectors = reinterpret_cast<const qint8*>(vectors);
+    m_textOffsets = reinterpret_cast<const quint32*>(textOffsets);
+    m_text = reinterpret_cast<const char*>(text);
+
+    Logger::instance().info(QString("Asset index loaded: %1 assets").arg(header->count));
+    return true;
+}
+
+void AssetIndex::unload()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+    m_file.close();
+
+    m_data = nullptr;
+    m_header = nullptr;
+    m_centroids = nullptr;
+    m_listOffsets = nullptr;
+    m_scales = nullptr;
+    m_vectors = nullptr;
+    m_textOffsets = nullptr;
+    m_text = nullptr;
+}
+
+int AssetIndex::size() const
+{
+    return m_header ? int(m_header->count) : 0;
+}
+
+QList<AssetIndex::Match> AssetIndex::search(const QString &query, int k) const
+{
+    QList<Match> matches;
+    if (!m_header || m_header->count == 0 || k <= 0) {
+        return matches;
+    }
+
+    QVector<float> queryVector = embed(query);
+    qint8 queryQuantized[kDimensions];
+    float queryScale = quantize(queryVector.constData(), queryQuantized);
+
+    // Nearest lists first
+    const int lists = int(m_header->lists);
+    QVector<QPair<float, int>> listScores(lists);
+    for (int c = 0; c < lists; ++c) {
+        listScores[c] = {dotFloat(queryVector.constData(), m_centroids + qint64(c) * kDimensions), c};
+    }
+    int probes = std::min(kProbes, lists);
+    std::partial_sort(listScores.begin(), listScores.begin() + probes, listScores.end(),
+                      [](const QPair<float, int> &a, const QPair<float, int> &b) {
+        return a.first > b.first;
+    });
+
+    // Keep the k best as a min-heap on score
+    QVector<QPair<float, quint32>> best;
+    best.reserve(k + 1);
+    auto worse = [](const QPair<float, quint32> &a, const QPair<float, quint32> &b) {
+        return a.first > b.first;
+    };
+
+    const DotInt8 dotInt8 = dotInt8Kernel();
+    for (int p = 0; p < probes; ++p) {
+        int list = listScores[p].second;
+        for (quint32 i = m_listOffsets[list]; i < m_listOffsets[list + 1]; ++i) {
+            float score = dotInt8(queryQuantized, m_vectors + qint64(i) * kDimensions)
+                          * m_scales[i] * queryScale;
+            if (score < kMinScore || (best.size() == k && score <= best.front().first)) {
+                continue;
+            }
+            best.append({score, i});
+            std::push_heap(best.begin(), best.end(), worse);
+            if (best.size() > k) {
+                std::pop_heap(best.begin(), best.end(), worse);
+                best.removeLast();
+            }
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end(), worse);
+    for (const auto &entry : best) {
+        Match match;
+        match.score = entry.first;
+        match.summary = QString::fromUtf8(m_text + m_textOffsets[entry.second],
+                                          m_textOffsets[entry.second + 1] - m_textOffsets[entry.second]);
+        matches.append(match);
+    }
+    return matches;
+}
+
+QStringList AssetIndex::contextFor(const QString &query, int k) const
+{
+    QStringList lines;
+    const QList<Match> matches = search(query, k);
+    for (const Match &match : matches) {
+        lines << match.summary;
+    }
+    return lines;
+}
+
+} // namespace Burma
@@ -0,0 +1,211 @@
+#include "modules/BitNetCalibrator.h"
+#include "utils/Logger.h"
+
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSysInfo>
+#include <QThread>
+
+namespace Burma {
+
+namespace {
+// Benchmark sizes: long enough to be stable, short enough to finish in about a minute
+constexpr int kBenchPromptTokens = 64;
+constexpr int kBenchGenTokens = 16;
+constexpr int kBenchRepetitions = 2;
+
+// Shape of a typical world plan request, used to weigh the two rates
+constexpr double kTypicalPromptTokens = 160.0;
+constexpr double kTypicalGenTokens = 200.0;
+
+QString joinNumbers(const QList<int> &values)
+{
+    QStringList parts;
+    for (int value : values) {
+        parts << QString::number(value);
+    }
+    return parts.join(',');
+}
+}
+
+BitNetCalibrator::BitNetCalibrator(QObject *parent)
+    : QObject(parent)
+    , m_process(new QProcess(this))
+{
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &BitNetCalibrator::onProcessFinished);
+    connect(m_process, &QProcess::errorOccurred,
+            this, &BitNetCalibrator::onProcessError);
+}
+
+BitNetCalibrator::~BitNetCalibrator()
+{
+    if (m_process->state() != QProcess::NotRunning) {
+        m_process->blockSignals(true);
+        m_process->kill();
+        m_process->waitForFinished();
+    }
+}
+
+QList<int> BitNetCalibrator::threadCandidates()
+{
+    int cores = QThread::idealThreadCount();
+    QList<int> threads;
+    for (int t = 1; t < cores; t *= 2) {
+        threads << t;
+    }
+    threads << cores;
+    return threads;
+}
+
+QList<int> BitNetCalibrator::batchCandidates()
+{
+    return {1, 32, 128, 512};
+}
+
+QString BitNetCalibrator::cpuModel()
+{
+    QFile cpuinfo("/proc/cpuinfo");
+    if (cpuinfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        while (!cpuinfo.atEnd()) {
+            QString line = QString::fromUtf8(cpuinfo.readLine());
+            if (line.startsWith("model name")) {
+                return line.section(':', 1).trimmed();
+            }
+        }
+    }
+    return QSysInfo::currentCpuArchitecture();
+}
+
+QString BitNetCalibrator::settingsGroup(const QString &modelPath)
+{
+    QFileInfo model(modelPath);
+    QString identity = QString("%1|%2|%3|%4").arg(cpuModel())
+                           .arg(QThread::idealThreadCount())
+                           .arg(model.absoluteFilePath())
+                           .arg(model.size());
+    QByteArray hash = QCryptographicHash::hash(identity.toUtf8(), QCryptographicHash::Sha1);
+    return "bitnet/calibration/" + QString::fromLatin1(hash.toHex().left(16));
+}
+
+bool BitNetCalibrator::start(const QString &benchPath, const QString &modelPath)
+{
+    if (isRunning()) {
+        return false;
+    }
+
+    if (!QFile::exists(benchPath)) {
+        emit failed("llama-bench not found at " + benchPath);
+        return false;
+    }
+
+    QStringList arguments;
+    arguments << "-m" << modelPath;
+    arguments << "-t" << joinNumbers(threadCandidates());
+    arguments << "-b" << joinNumbers(batchCandidates());
+    arguments << "-p" << QString::number(kBenchPromptTokens);
+    arguments << "-n" << QString::number(kBenchGenTokens);
+    arguments << "-r" << QString::number(kBenchRepetitions);
+    arguments << "-ngl" << "0";
+    arguments << "-o" << "json";
+
+    Logger::instance().info("Calibrating BitNet inference on " + cpuModel());
+    Logger::instance().debug("Running llama-bench: " + benchPath + " " + arguments.join(" "));
+
+    m_process->start(benchPath, arguments);
+    return true;
+}
+
+void BitNetCalibrator::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+        emit failed(QString("llama-bench failed with exit code %1: %2")
+                        .arg(exitCode)
+                        .arg(QString::fromUtf8(m_process->readAllStandardError().right(512))));
+        return;
+    }
+
+    Result result;
+    QString error;
+    if (!parseResults(m_process->readAllStandardOutput(), &result, &error)) {
+        emit failed("Could not read llama-bench results: " + error);
+        return;
+    }
+
+    Logger::instance().info(QString("BitNet calibration: %1 threads, batch %2 "
+                                    "(prompt %3 tok/s, generation %4 tok/s)")
+                                .arg(result.threads)
+                                .arg(result.batchSize)
+                                .arg(result.promptTokensPerSec, 0, 'f', 1)
+                                .arg(result.generationTokensPerSec, 0, 'f', 1));
+    emit finished(result);
+}
+
+void BitNetCalibrator::onProcessError(QProcess::ProcessError error)
+{
+    if (error == QProcess::FailedToStart) {
+        emit failed("llama-bench failed to start: " + m_process->program());
+    }
+}
+
+bool BitNetCalibrator::parseResults(const QByteArray &json, Result *result, QString *error) const
+{
+    // llama-bench may print log lines before the JSON array
+    int start = json.indexOf('[');
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(start >= 0 ? json.mid(start) : json, &parseError);
+    if (!doc.isArray()) {
+        *error = parseError.errorString();
+        return false;
+    }
+
+    // Prompt eval rate per (threads, batch); generation rate per thread count
+    QHash<QPair<int, int>, double> promptRates;
+    QHash<int, double> genRates;
+
+    const QJsonArray runs = doc.array();
+    for (const QJsonValue &value : runs) {
+        QJsonObject run = value.toObject();
+        int threads = run.value("n_threads").toInt();
+        int batch = run.value("n_batch").toInt();
+        double rate = run.value("avg_ts").toDouble();
+
+        if (run.value("n_prompt").toInt() > 0) {
+            promptRates[{threads, batch}] = rate;
+        } else if (run.value("n_gen").toInt() > 0) {
+            genRates[threads] = qMax(genRates.value(threads), rate);
+        }
+    }
+
+    // Lowest estimated time for a typical request wins
+    double bestSeconds = 0.0;
+    for (auto it = promptRates.cbegin(); it != promptRates.cend(); ++it) {
+        double promptRate = it.value();
+        double genRate = genRates.value(it.key().first);
+        if (promptRate <= 0.0 || genRate <= 0.0) {
+            continue;
+        }
+
+        double seconds = kTypicalPromptTokens / promptRate + kTypicalGenTokens / genRate;
+        if (result->threads == 0 || seconds < bestSeconds) {
+            bestSeconds = seconds;
+            result->threads = it.key().first;
+            result->batchSize = it.key().second;
+            result->promptTokensPerSec = promptRate;
+            result->generationTokensPerSec = genRate;
+        }
+    }
+
+    if (result->threads == 0) {
+        *error = "no complete prompt/generation measurements";
+        return false;
+    }
+    return true;
+}
+
+} // namespace Burma
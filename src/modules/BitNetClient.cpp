@@ -1,18 +1,121 @@
 #include "modules/BitNetClient.h"
+#include "modules/BitNetWorker.h"
+#include "modules/BitNetCalibrator.h"
+#include "modules/ResponseCache.h"
+#include "modules/AssetIndex.h"
+#include "core/WorldPlanSchema.h"
+#include "core/WorldPlanPatch.h"
 #include "utils/Logger.h"
+#include "utils/JsonExtractor.h"
 
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QThread>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
 
 namespace Burma {
 
+namespace {
+// Sampling settings shared by the one-shot and resident worker paths
+constexpr int kMaxTokens = 200;        // Minimal tokens - just copy the template
+constexpr int kMaxEditTokens = 96;     // A patch only lists the changed models
+constexpr int kDefaultThreads = 4;     // Until calibrated
+constexpr int kDefaultBatchSize = 1;
+constexpr int kDefaultDraftLength = 8; // Long enough for runs like "},\n{\"name\":\""
+constexpr int kContextSize = 1024;     // Small context for simple task
+constexpr double kTemperature = 0.3;   // Lower temperature for more focused output
+constexpr double kTopP = 0.9;          // Nucleus sampling
+constexpr double kRepeatPenalty = 1.1; // Prevent repetition
+constexpr int kSeed = 42;              // Fixed seed so identical prompts are reproducible
+constexpr int kVariantSlots = 8;       // Sequences per batched variant decode
+constexpr int kMaxVariants = 1000;
+constexpr int kContextAssets = 5;      // Retrieved Fuel assets per prompt
+
+// Bump whenever createWorldPlanPrompt or createEditPrompt changes so cached responses are invalidated
+constexpr int kPromptTemplateVersion = 4;
+constexpr qint64 kDefaultCacheBytes = 64 * 1024 * 1024;
+constexpr qint64 kMetricsLogBytes = 4 * 1024 * 1024;
+
+// Failed worker requests before a job falls back to one-shot inference
+constexpr int kMaxWorkerAttempts = 2;
+
+// Read one byte per page so the whole model is in the page cache before the
+// first prompt. Runs on a background thread; returns the time taken.
+qint64 prefetchModelPages(const QString &modelPath)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(modelPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    qint64 size = file.size();
+    uchar *data = file.map(0, size);
+    if (!data) {
+        return -1;
+    }
+
+#ifdef Q_OS_UNIX
+    // Let the kernel read ahead in large chunks instead of faulting page by page
+    madvise(data, size, MADV_WILLNEED);
+#endif
+
+    constexpr qint64 kPageSize = 4096;
+    constexpr qint64 kInterruptCheckBytes = 64 * 1024 * 1024;
+    volatile uchar sink = 0;
+    for (qint64 offset = 0; offset < size; offset += kPageSize) {
+        sink ^= data[offset];
+        if (offset % kInterruptCheckBytes == 0 && QThread::currentThread()->isInterruptionRequested()) {
+            break;
+        }
+    }
+    Q_UNUSED(sink);
+
+    file.unmap(data);
+    return timer.elapsed();
+}
+}
+
 BitNetClient::BitNetClient(QObject *parent)
     : QObject(parent)
     , m_process(new QProcess(this))
     , m_isReady(false)
+    , m_threads(kDefaultThreads)
+    , m_batchSize(kDefaultBatchSize)
+    , m_draftLength(kDefaultDraftLength)
+    , m_calibrator(nullptr)
+    , m_calibrationHoldsJobs(true)
+    , m_calibrationDeferred(false)
+    , m_calibratedThreads(0)
+    , m_calibratedBatchSize(0)
+    , m_workerEnabled(true)
+    , m_poolSize(1)
+    , m_variantWorker(nullptr)
+    , m_warmUpRequested(false)
+    , m_warm(false)
+    , m_oneShotJob(nullptr)
+    , m_nextJobId(1)
+    , m_completedJobs(0)
+    , m_draftTokens(0)
+    , m_draftAccepted(0)
+    , m_metricsLog(nullptr)
+    , m_acceptedPlans(0)
+    , m_fallbackPlans(0)
+    , m_wastedInferenceMs(0)
+    , m_responseCache(nullptr)
+    , m_assetIndex(nullptr)
 {
     // Default BitNet.cpp paths
     QString homeDir = QDir::homePath();
@@ -31,6 +134,27 @@ BitNetClient::BitNetClient(QObject *parent)
         m_modelPath = QString::fromUtf8(envModelPath);
     }
 
+    QByteArray envDraftPath = qgetenv("BURMA_BITNET_DRAFT_MODEL");
+    if (!envDraftPath.isEmpty()) {
+        setDraftModel(QString::fromUtf8(envDraftPath), kDefaultDraftLength);
+    }
+
+    QDir cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    m_responseCache = new ResponseCache(cacheDir.filePath("bitnet_responses"), kDefaultCacheBytes);
+
+    QDir dataDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    m_metricsLog = new InferenceMetricsLog(dataDir.filePath("inference_metrics.jsonl"), kMetricsLogBytes);
+
+    // Resident worker can be disabled to force one-shot llama-cli runs
+    if (qgetenv("BURMA_BITNET_WORKER") == "0") {
+        m_workerEnabled = false;
+    }
+
+    int envPoolSize = qEnvironmentVariableIntValue("BURMA_BITNET_WORKERS");
+    if (envPoolSize > 0) {
+        m_poolSize = qMin(envPoolSize, QThread::idealThreadCount());
+    }
+
     // Check if BitNet.cpp is available
     if (QFile::exists(m_bitnetCliPath) && QFile::exists(m_modelPath)) {
         m_isReady = true;
@@ -41,17 +165,39 @@ BitNetClient::BitNetClient(QObject *parent)
             this, &BitNetClient::onProcessFinished);
     connect(m_process, &QProcess::errorOccurred,
             this, &BitNetClient::onProcessError);
+    connect(m_process, &QProcess::readyReadStandardOutput,
+            this, &BitNetClient::onProcessOutput);
 
     Logger::instance().info("================================");
     Logger::instance().info("BitNet.cpp Client Initialized");
     Logger::instance().info("CLI Path: " + m_bitnetCliPath);
     Logger::instance().info("Model Path: " + m_modelPath);
     Logger::instance().info("Ready: " + QString(m_isReady ? "Yes" : "No"));
+    Logger::instance().info("Draft model: " + (m_draftModelPath.isEmpty() ? QString("None") : m_draftModelPath));
+    Logger::instance().info("Resident workers: " + (m_workerEnabled ? QString::number(m_poolSize)
+                                                                    : QString("Disabled")));
     Logger::instance().info("================================");
 }
 
 BitNetClient::~BitNetClient()
 {
+    if (m_prefetchThread) {
+        m_prefetchThread->requestInterruption();
+        m_prefetchThread->wait();
+    }
+
+    for (BitNetWorker *worker : std::as_const(m_workers)) {
+        worker->disconnect(this);
+        worker->stop();
+    }
+    if (m_variantWorker) {
+        m_variantWorker->disconnect(this);
+        m_variantWorker->stop();
+    }
+    qDeleteAll(m_activeJobs);
+    delete m_responseCache;
+    delete m_metricsLog;
+
     if (m_process->state() == QProcess::Running) {
         m_process->kill();
         m_process->waitForFinished();
@@ -62,6 +208,7 @@ void BitNetClient::setBitNetPath(const QString &path)
 {
     m_bitnetCliPath = path;
     m_isReady = QFile::exists(m_bitnetCliPath) && QFile::exists(m_modelPath);
+    resetWorkers();
     Logger::instance().info("BitNet CLI path set to: " + path);
 }
 
@@ -69,100 +216,1468 @@ void BitNetClient::setModelPath(const QString &path)
 {
     m_modelPath = path;
     m_isReady = QFile::exists(m_bitnetCliPath) && QFile::exists(m_modelPath);
+    m_modelStamp.clear();
+    m_promptCacheFiles.clear();
+    resetWorkers();
     Logger::instance().info("BitNet model path set to: " + path);
 }
 
-void BitNetClient::processPrompt(const QString &prompt, const QStringList &context)
+void BitNetClient::setInferenceSettings(int threads, int batchSize)
 {
-    if (!m_isReady) {
-        emit errorOccurred("BitNet.cpp not ready. Please run ./build.sh --setup-bitnet");
+    threads = qMax(1, threads);
+    batchSize = qMax(1, batchSize);
+    if (threads == m_threads && batchSize == m_batchSize) {
         return;
     }
 
-    if (m_process->state() == QProcess::Running) {
-        emit errorOccurred("BitNet.cpp is already processing a request");
+    m_threads = threads;
+    m_batchSize = batchSize;
+    resetWorkers();
+    Logger::instance().info(QString("BitNet inference settings: %1 threads, batch %2")
+                                .arg(threads).arg(batchSize));
+}
+
+void BitNetClient::setDraftModel(const QString &path, int draftLength)
+{
+    QString draftPath = path;
+    if (!draftPath.isEmpty() && !QFile::exists(draftPath)) {
+        Logger::instance().warning("BitNet draft model not found, speculative decoding disabled: " + draftPath);
+        draftPath.clear();
+    }
+    draftLength = qMax(1, draftLength);
+    if (draftPath == m_draftModelPath && draftLength == m_draftLength) {
+        return;
+    }
+
+    m_draftModelPath = draftPath;
+    m_draftLength = draftLength;
+    resetWorkers();
+    Logger::instance().info(draftPath.isEmpty()
+        ? QString("BitNet speculative decoding disabled")
+        : QString("BitNet speculative decoding with %1, %2 draft tokens").arg(draftPath).arg(draftLength));
+}
+
+bool BitNetClient::isCalibrating() const
+{
+    return m_calibrator && m_calibrator->isRunning();
+}
+
+bool BitNetClient::calibrate(bool holdJobs)
+{
+    if (!m_isReady || isCalibrating()) {
+        return false;
+    }
+
+    // Loading and priming the workers would skew a run that doesn't hold
+    // them; finishWarmUp starts it
+    if (!holdJobs && isWarmingUp()) {
+        m_calibrationDeferred = true;
+        return true;
+    }
+    m_calibrationDeferred = false;
+
+    if (!m_calibrator) {
+        m_calibrator = new BitNetCalibrator(this);
+        connect(m_calibrator, &BitNetCalibrator::finished, this,
+                [this](const BitNetCalibrator::Result &result) {
+            if (m_calibrationHoldsJobs) {
+                setInferenceSettings(result.threads, result.batchSize);
+            } else {
+                m_calibratedThreads = result.threads;
+                m_calibratedBatchSize = result.batchSize;
+                applyCalibration();
+            }
+            emit calibrationFinished(result.threads, result.batchSize,
+                                     result.promptTokensPerSec, result.generationTokensPerSec);
+            scheduleJobs();
+        });
+        connect(m_calibrator, &BitNetCalibrator::failed, this, [this](const QString &error) {
+            Logger::instance().warning("BitNet calibration failed: " + error);
+            emit calibrationFailed(error);
+            scheduleJobs();
+        });
+    }
+
+    // Resident workers would compete with the benchmark for the same cores
+    m_calibrationHoldsJobs = holdJobs;
+    if (holdJobs) {
+        m_calibratedThreads = 0;   // Superseded by this run
+        resetWorkers();
+    }
+
+    QByteArray envBenchPath = qgetenv("BURMA_BITNET_BENCH");
+    QString benchPath = envBenchPath.isEmpty()
+        ? QFileInfo(m_bitnetCliPath).dir().filePath("llama-bench")
+        : QString::fromUtf8(envBenchPath);
+    return m_calibrator->start(benchPath, m_modelPath);
+}
+
+void BitNetClient::setWorkerEnabled(bool enabled)
+{
+    m_workerEnabled = enabled;
+    if (!enabled) {
+        resetWorkers();
+    }
+    Logger::instance().info("BitNet resident worker " + QString(enabled ? "enabled" : "disabled"));
+}
+
+void BitNetClient::setWorkerPoolSize(int size)
+{
+    size = qBound(1, size, QThread::idealThreadCount());
+    if (size == m_poolSize) {
+        return;
+    }
+
+    // Thread split and pinning change with the pool size, so relaunch
+    m_poolSize = size;
+    resetWorkers();
+    Logger::instance().info(QString("BitNet worker pool size set to %1").arg(size));
+}
+
+void BitNetClient::startWorker()
+{
+    if (!m_workerEnabled || !m_isReady) {
+        return;
+    }
+
+    if (m_workers.isEmpty()) {
+        BitNetWorker::Config config = workerConfig();
+
+        // A single worker keeps the calibrated thread count; a pool splits the
+        // machine into disjoint core sets. The weights are mmapped read-only,
+        // so every worker shares one copy in the page cache.
+        int cores = QThread::idealThreadCount();
+        config.threads = m_poolSize == 1 ? m_threads : qMax(1, cores / m_poolSize);
+
+        for (int i = 0; i < m_poolSize; ++i) {
+            if (m_poolSize > 1) {
+                int firstCore = (i * config.threads) % cores;
+                config.cpuList = QString("%1-%2").arg(firstCore).arg(firstCore + config.threads - 1);
+            }
+
+            BitNetWorker *worker = new BitNetWorker(config, this);
+            connect(worker, &BitNetWorker::ready, this, [this, worker](qint64 loadTimeMs) {
+                onWorkerReady(worker, loadTimeMs);
+            });
+            connect(worker, &BitNetWorker::tokensReceived, this, [this, worker](const QString &text) {
+                onWorkerTokens(worker, text);
+            });
+            connect(worker, &BitNetWorker::unavailable, this, [this, worker](const QString &reason) {
+                onWorkerUnavailable(worker, reason);
+            });
+            connect(worker, &BitNetWorker::completionFinished, this,
+                    [this, worker](const QString &content, const QJsonObject &response) {
+                onWorkerCompletion(worker, content, response);
+            });
+            connect(worker, &BitNetWorker::completionFailed, this, [this, worker](const QString &error) {
+                onWorkerFailed(worker, error);
+            });
+            m_workers.append(worker);
+        }
+    }
+
+    for (BitNetWorker *worker : std::as_const(m_workers)) {
+        worker->start();
+    }
+}
+
+void BitNetClient::resetWorkers()
+{
+    if (m_variantWorker) {
+        const QList<ActiveJob*> batch = jobsForWorker(m_variantWorker);
+        for (ActiveJob *job : batch) {
+            requeueJob(job);
+        }
+        m_variantWorker->disconnect(this);
+        m_variantWorker->stop();
+        m_variantWorker->deleteLater();
+        m_variantWorker = nullptr;
+    }
+
+    if (m_workers.isEmpty()) {
+        return;
+    }
+    m_primingWorkers.clear();
+
+    // Jobs running on the old workers start over on the new configuration
+    const QList<ActiveJob*> active = m_activeJobs;
+    for (ActiveJob *job : active) {
+        if (job->worker) {
+            requeueJob(job);
+        }
+    }
+
+    for (BitNetWorker *worker : std::as_const(m_workers)) {
+        worker->disconnect(this);
+        worker->stop();
+        worker->deleteLater();
+    }
+    m_workers.clear();
+}
+
+void BitNetClient::warmUp()
+{
+    if (!m_isReady || m_warmUpRequested) {
+        return;
+    }
+
+    Logger::instance().info("Warming up BitNet model: " + m_modelPath);
+    m_warmUpRequested = true;
+    m_warmUpTimer.start();
+    emit warmUpStarted();
+
+    // Lowest priority so the UI and a prompt submitted meanwhile take precedence
+    QPointer<BitNetClient> self(this);
+    QString modelPath = m_modelPath;
+    m_prefetchThread = QThread::create([self, modelPath]() {
+        qint64 prefetchMs = prefetchModelPages(modelPath);
+        if (self) {
+            QMetaObject::invokeMethod(self, [self, prefetchMs]() {
+                self->onPrefetchFinished(prefetchMs);
+            }, Qt::QueuedConnection);
+        }
+    });
+    connect(m_prefetchThread, &QThread::finished, m_prefetchThread, &QObject::deleteLater);
+    m_prefetchThread->start(QThread::LowestPriority);
+}
+
+void BitNetClient::onPrefetchFinished(qint64 prefetchMs)
+{
+    if (prefetchMs < 0) {
+        Logger::instance().warning("Could not map the BitNet model for prefetching");
+    } else {
+        Logger::instance().info(QString("BitNet model prefetched into the page cache in %1 ms")
+                                    .arg(prefetchMs));
+    }
+
+    if (!m_workerEnabled) {
+        // One-shot runs only benefit from the warm page cache
+        finishWarmUp();
+        return;
+    }
+
+    // During calibration the workers start once it finishes; onWorkerReady primes them
+    if (!isCalibrating() || !m_calibrationHoldsJobs) {
+        startWorker();
+    }
+}
+
+void BitNetClient::primeWorker(BitNetWorker *worker)
+{
+    // One token after the shared prefix leaves the prefix in the slot's KV cache
+    QJsonObject request;
+    request["prompt"] = worldPlanPromptPrefix();
+    request["n_predict"] = 1;
+    request["cache_prompt"] = true;
+
+    if (worker->complete(request)) {
+        m_primingWorkers.append(worker);
+    }
+}
+
+void BitNetClient::finishWarmUp()
+{
+    if (m_warm) {
+        return;
+    }
+
+    m_warm = true;
+    Logger::instance().info(QString("BitNet warm-up finished in %1 ms").arg(m_warmUpTimer.elapsed()));
+    emit warmUpFinished(m_warmUpTimer.elapsed());
+
+    if (m_calibrationDeferred) {
+        calibrate(false);
+    }
+}
+
+void BitNetClient::applyCalibration()
+{
+    if (m_calibratedThreads == 0 || !m_queue.isEmpty() || !m_primingWorkers.isEmpty()) {
         return;
     }
+    for (const ActiveJob *active : std::as_const(m_activeJobs)) {
+        if (active->worker) {
+            return;  // Retried when a job finishes
+        }
+    }
+
+    // Nothing runs on the workers, so restarting them loses no work. They
+    // come back primed, as after the warm-up.
+    int threads = m_calibratedThreads;
+    int batchSize = m_calibratedBatchSize;
+    m_calibratedThreads = 0;
+    setInferenceSettings(threads, batchSize);
+    if (m_warmUpRequested && m_workerEnabled && m_workers.isEmpty()) {
+        startWorker();
+    }
+}
+
+BitNetClient::ActiveJob::ActiveJob(const PromptJob &promptJob)
+    : job(promptJob)
+    , parser(promptJob.edit ? PlanKey::Operations.toUtf8() : PlanKey::Models.toUtf8())
+{
+    timer.start();
+}
+
+void BitNetClient::setResponseCacheLimit(qint64 maxBytes)
+{
+    m_responseCache->setMaxBytes(maxBytes);
+}
+
+BitNetClient::JobId BitNetClient::submitPrompt(const QString &prompt, const QStringList &context,
+                                               Priority priority, bool bypassCache)
+{
+    if (!m_isReady) {
+        emit errorOccurred(0, "BitNet.cpp not ready. Please run ./build.sh --setup-bitnet");
+        return 0;
+    }
+
+    PromptJob job;
+    job.priority = priority;
+    job.prompt = prompt;
+    job.context = context;
+    job.bypassCache = bypassCache;
+
+    // Ground the plan in real assets; a few lines keep the prompt short
+    if (job.context.isEmpty() && m_assetIndex && m_assetIndex->isLoaded()) {
+        job.context = m_assetIndex->contextFor(prompt, kContextAssets);
+    }
+    return enqueueJob(job);
+}
+
+BitNetClient::JobId BitNetClient::submitEdit(const QString &instruction, const QJsonObject &currentPlan,
+                                             Priority priority, bool bypassCache)
+{
+    if (!m_isReady) {
+        emit errorOccurred(0, "BitNet.cpp not ready. Please run ./build.sh --setup-bitnet");
+        return 0;
+    }
+
+    PromptJob job;
+    job.priority = priority;
+    job.prompt = instruction;
+    job.context = WorldPlanPatch::summarize(currentPlan);
+    job.bypassCache = bypassCache;
+    job.edit = true;
+    return enqueueJob(job);
+}
+
+BitNetClient::JobId BitNetClient::submitVariants(const QString &prompt, int count, int firstSeed,
+                                                 const QStringList &context, Priority priority)
+{
+    if (!m_isReady) {
+        emit errorOccurred(0, "BitNet.cpp not ready. Please run ./build.sh --setup-bitnet");
+        return 0;
+    }
+    if (count <= 0 || count > kMaxVariants || firstSeed < 0) {
+        emit errorOccurred(0, QString("Invalid variant request: %1 variants from seed %2 (at most %3)")
+                                  .arg(count).arg(firstSeed).arg(kMaxVariants));
+        return 0;
+    }
+
+    JobId runId = m_nextJobId++;
+    VariantRun &run = m_variantRuns[runId];
+    run.requested = count;
+    run.pending = count;
+    run.timer.start();
+
+    PromptJob job;
+    job.priority = priority;
+    job.prompt = prompt;
+    job.context = context;
+    if (job.context.isEmpty() && m_assetIndex && m_assetIndex->isLoaded()) {
+        job.context = m_assetIndex->contextFor(prompt, kContextAssets);
+    }
+    job.variantOf = runId;
+
+    for (int i = 0; i < count; ++i) {
+        job.seed = firstSeed + i;
+        job.variantIndex = i;
+        enqueueJob(job);
+    }
+
+    Logger::instance().info(QString("Queued %1 variants of BitNet job %2, seeds %3-%4")
+                                .arg(count).arg(runId).arg(firstSeed).arg(firstSeed + count - 1));
+    return runId;
+}
+
+BitNetClient::JobId BitNetClient::enqueueJob(PromptJob job)
+{
+    job.id = m_nextJobId++;
+
+    // Interactive jobs go ahead of the first queued batch job
+    int position = m_queue.size();
+    if (job.priority == Priority::Interactive) {
+        for (int i = 0; i < m_queue.size(); ++i) {
+            if (m_queue.at(i).priority == Priority::Batch) {
+                position = i;
+                break;
+            }
+        }
+    }
+    m_queue.insert(position, job);
+
+    Logger::instance().info(QString("Queued BitNet %1 %2 (%3, %4 waiting): %5")
+                                .arg(job.edit ? "edit" : "job")
+                                .arg(job.id)
+                                .arg(job.priority == Priority::Interactive ? "interactive" : "batch")
+                                .arg(m_queue.size())
+                                .arg(job.prompt));
+
+    // Start asynchronously so the caller knows the job ID before any signal
+    QMetaObject::invokeMethod(this, &BitNetClient::scheduleJobs, Qt::QueuedConnection);
+    return job.id;
+}
+
+bool BitNetClient::cancelJob(JobId jobId)
+{
+    if (m_variantRuns.contains(jobId)) {
+        Logger::instance().info(QString("Cancelling BitNet variant job %1").arg(jobId));
+        emit jobCancelled(jobId);
+
+        for (int i = m_queue.size() - 1; i >= 0; --i) {
+            if (m_queue.at(i).variantOf == jobId) {
+                emitFinished(m_queue.takeAt(i));
+            }
+        }
+
+        const QList<ActiveJob*> active = m_activeJobs;
+        for (ActiveJob *job : active) {
+            // Cancelling one variant of a batch finishes the others with it
+            if (m_activeJobs.contains(job) && job->job.variantOf == jobId && !job->cancelled) {
+                cancelJob(job->job.id);
+            }
+        }
+        return true;
+    }
+
+    for (int i = 0; i < m_queue.size(); ++i) {
+        if (m_queue.at(i).id == jobId) {
+            // Finished like a running job, so whoever waits on it lets go
+            PromptJob job = m_queue.takeAt(i);
+            Logger::instance().info(QString("BitNet job %1 cancelled before it started").arg(jobId));
+            emitCancelled(job);
+            emitFinished(job);
+            return true;
+        }
+    }
+
+    ActiveJob *active = nullptr;
+    for (ActiveJob *candidate : std::as_const(m_activeJobs)) {
+        if (candidate->job.id == jobId) {
+            active = candidate;
+            break;
+        }
+    }
+    if (!active || active->cancelled) {
+        return false;
+    }
+
+    Logger::instance().info(QString("Cancelling running BitNet job %1").arg(jobId));
+    active->cancelled = true;
+
+    if (active == m_oneShotJob && m_process->state() != QProcess::NotRunning) {
+        // onProcessFinished completes the cancellation
+        m_process->kill();
+        return true;
+    }
+
+    if (active->worker) {
+        // A batch shares one connection set, so the whole batch is stopped
+        BitNetWorker *worker = active->worker;
+        worker->cancel();
+        if (worker == m_variantWorker) {
+            const QList<ActiveJob*> batch = jobsForWorker(worker);
+            for (ActiveJob *job : batch) {
+                if (job != active) {
+                    job->cancelled = true;
+                    job->metrics.outcome = "cancelled";
+                    emitCancelled(job->job);
+                    finishJob(job);
+                }
+            }
+        }
+    }
+
+    active->metrics.outcome = "cancelled";
+    emitCancelled(active->job);
+    finishJob(active);
+    return true;
+}
+
+void BitNetClient::scheduleJobs()
+{
+    if (isCalibrating() && m_calibrationHoldsJobs) {
+        return;  // Resumed when calibration finishes
+    }
+
+    if (m_workerEnabled && m_workers.isEmpty()) {
+        startWorker();
+    }
+
+    // Cache hits never need a worker, so serve them even behind busy ones
+    for (int i = 0; i < m_queue.size(); ++i) {
+        if (m_queue.at(i).cacheChecked) {
+            continue;
+        }
+        if (serveFromCache(m_queue[i])) {
+            PromptJob job = m_queue.takeAt(i);
+            emitStarted(job);
+            emitResult(job, job.cachedPlan);
+            emitFinished(job);
+
+            // Listeners may have changed the queue; resume from a clean pass
+            QMetaObject::invokeMethod(this, &BitNetClient::scheduleJobs, Qt::QueuedConnection);
+            return;
+        }
+    }
+
+    // The variant server decodes on the pool's cores, so a batch runs only
+    // while the pool is idle, and an interactive prompt takes them back
+    preemptVariantBatch();
+
+    // Dispatch in queue order to the least loaded idle worker
+    while (!m_queue.isEmpty()) {
+        bool needsOneShot = m_queue.first().workerFailures >= kMaxWorkerAttempts;
+
+        // Variants go to the batching server together; if it can't start
+        // they take the normal path one by one
+        if (m_queue.first().variantOf && !needsOneShot && m_workerEnabled) {
+            BitNetWorker *batchWorker = variantWorker();
+            if (batchWorker->isReady()) {
+                if (poolBusy()) {
+                    return;  // Resumed when the last pool job finishes
+                }
+                runVariantBatch(batchWorker);
+                continue;
+            }
+            if (batchWorker->state() != BitNetWorker::State::Failed) {
+                return;  // Loading or busy with the previous batch
+            }
+        }
+
+        // Batch jobs wait for a running variant batch to give the cores back
+        if (m_variantWorker && !jobsForWorker(m_variantWorker).isEmpty()) {
+            return;
+        }
+
+        BitNetWorker *worker = needsOneShot ? nullptr : leastLoadedWorker();
+        if (worker) {
+            runWorkerInference(activateJob(m_queue.takeFirst()), worker);
+            continue;
+        }
+
+        if (!needsOneShot && workersPending()) {
+            // Wait for onWorkerReady or a worker to finish its request
+            return;
+        }
+
+        if (m_oneShotJob) {
+            return;  // Only one llama-cli run at a time
+        }
+
+        // Worker disabled or unavailable - fall back to a one-shot llama-cli run
+        runInference(activateJob(m_queue.takeFirst()));
+    }
+}
+
+bool BitNetClient::serveFromCache(PromptJob &job)
+{
+    job.cacheChecked = true;
+    job.cacheKey = cacheKey(job);
+
+    if (job.bypassCache) {
+        Logger::instance().info(QString("Response cache bypassed for job %1").arg(job.id));
+        return false;
+    }
+
+    QElapsedTimer lookupTimer;
+    lookupTimer.start();
+
+    if (m_responseCache->lookup(job.cacheKey, &job.cachedPlan)) {
+        Logger::instance().info(QString("Response cache hit for job %1 in %2 us (hits: %3, misses: %4)")
+                                    .arg(job.id)
+                                    .arg(lookupTimer.nsecsElapsed() / 1000)
+                                    .arg(m_responseCache->hits())
+                                    .arg(m_responseCache->misses()));
+        return true;
+    }
+
+    Logger::instance().info(QString("Response cache miss for job %1 (hits: %2, misses: %3)")
+                                .arg(job.id)
+                                .arg(m_responseCache->hits())
+                                .arg(m_responseCache->misses()));
+    return false;
+}
+
+BitNetClient::ActiveJob* BitNetClient::activateJob(const PromptJob &job)
+{
+    ActiveJob *active = new ActiveJob(job);
+    m_activeJobs.append(active);
 
-    Logger::instance().info("Processing prompt with BitNet.cpp: " + prompt);
-    emit processingStarted();
+    if (!m_poolTimer.isValid()) {
+        m_poolTimer.start();
+    }
 
     // Create full prompt with system instructions
-    QString fullPrompt = createWorldPlanPrompt(prompt, context);
+    if (active->job.fullPrompt.isEmpty()) {
+        active->job.fullPrompt = job.edit ? createEditPrompt(job.prompt, job.context)
+                                          : createWorldPlanPrompt(job.prompt, job.context);
+    }
 
-    // Run inference
-    runInference(fullPrompt);
+    emitStarted(active->job);
+    return active;
 }
 
-QString BitNetClient::createWorldPlanPrompt(const QString &prompt, const QStringList &context)
+void BitNetClient::finishJob(ActiveJob *active)
+{
+    PromptJob job = active->job;
+    reportMetrics(active);
+    m_activeJobs.removeOne(active);
+    if (active == m_oneShotJob) {
+        m_oneShotJob = nullptr;
+    }
+    delete active;
+
+    ++m_completedJobs;
+    Logger::instance().info(poolStatistics());
+
+    emitFinished(job);
+
+    if (!m_queue.isEmpty()) {
+        QMetaObject::invokeMethod(this, &BitNetClient::scheduleJobs, Qt::QueuedConnection);
+    } else if (m_calibratedThreads != 0) {
+        QMetaObject::invokeMethod(this, &BitNetClient::applyCalibration, Qt::QueuedConnection);
+    }
+}
+
+void BitNetClient::requeueJob(ActiveJob *active)
 {
-    // Ultra-simple prompt optimized for 2B model - ONE object only
-    QString systemPrompt =
-        prompt + "\n\n"
-        "JSON:\n"
+    PromptJob job = active->job;
+    m_activeJobs.removeOne(active);
+    if (active == m_oneShotJob) {
+        m_oneShotJob = nullptr;
+    }
+    delete active;
+
+    // Back to the front so it keeps its place ahead of later prompts
+    m_queue.prepend(job);
+    QMetaObject::invokeMethod(this, &BitNetClient::scheduleJobs, Qt::QueuedConnection);
+}
+
+BitNetClient::ActiveJob* BitNetClient::jobForWorker(BitNetWorker *worker) const
+{
+    for (ActiveJob *active : m_activeJobs) {
+        if (active->worker == worker) {
+            return active;
+        }
+    }
+    return nullptr;
+}
+
+BitNetWorker* BitNetClient::leastLoadedWorker() const
+{
+    BitNetWorker *best = nullptr;
+    for (BitNetWorker *worker : m_workers) {
+        if (worker->isReady() && !jobForWorker(worker)
+            && (!best || worker->busyTimeMs() < best->busyTimeMs())) {
+            best = worker;
+        }
+    }
+    return best;
+}
+
+bool BitNetClient::poolBusy() const
+{
+    if (m_oneShotJob || !m_primingWorkers.isEmpty()) {
+        return true;
+    }
+    for (const ActiveJob *active : m_activeJobs) {
+        if (active->worker && active->worker != m_variantWorker) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BitNetClient::preemptVariantBatch()
+{
+    if (!m_variantWorker) {
+        return;
+    }
+    const QList<ActiveJob*> batch = jobsForWorker(m_variantWorker);
+    bool interactiveWaiting = std::any_of(m_queue.cbegin(), m_queue.cend(), [](const PromptJob &job) {
+        return job.priority == Priority::Interactive;
+    });
+    if (batch.isEmpty() || !interactiveWaiting) {
+        return;
+    }
+
+    // The variants start over once the pool is idle again, after the
+    // interactive jobs that now precede them
+    Logger::instance().info(QString("Stopping the batch of variant job %1 for an interactive prompt")
+                                .arg(batch.first()->job.variantOf));
+    m_variantWorker->cancel();
+    for (qsizetype i = batch.size() - 1; i >= 0; --i) {
+        requeueJob(batch.at(i));
+    }
+    std::stable_partition(m_queue.begin(), m_queue.end(), [](const PromptJob &job) {
+        return job.priority == Priority::Interactive;
+    });
+}
+
+bool BitNetClient::workersPending() const
+{
+    for (BitNetWorker *worker : m_workers) {
+        if (worker->state() == BitNetWorker::State::Loading || worker->isAvailable()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString BitNetClient::poolStatistics() const
+{
+    qint64 elapsedMs = m_poolTimer.isValid() ? qMax<qint64>(1, m_poolTimer.elapsed()) : 1;
+    QString stats = QString("BitNet pool: %1 worlds in %2 s (%3 worlds/min)")
+                        .arg(m_completedJobs)
+                        .arg(elapsedMs / 1000.0, 0, 'f', 1)
+                        .arg(m_completedJobs * 60000.0 / elapsedMs, 0, 'f', 2);
+
+    for (int i = 0; i < m_workers.size(); ++i) {
+        const BitNetWorker *worker = m_workers.at(i);
+        stats += QString("; worker %1: %2% busy, %3 requests")
+                     .arg(i)
+                     .arg(100.0 * worker->busyTimeMs() / elapsedMs, 0, 'f', 0)
+                     .arg(worker->completedRequests());
+    }
+    return stats;
+}
+
+QString BitNetClient::cacheKey(const PromptJob &job)
+{
+    return ResponseCache::makeKey({
+        job.prompt.simplified().toLower(),
+        job.context.join('\n'),
+        QString::number(kPromptTemplateVersion),
+        modelStamp(),
+        job.edit ? WorldPlanSchema::patchGrammar() : WorldPlanSchema::grammar(),
+        QString("n=%1 temp=%2 top-p=%3 repeat-penalty=%4 seed=%5")
+            .arg(job.edit ? kMaxEditTokens : kMaxTokens)
+            .arg(kTemperature).arg(kTopP).arg(kRepeatPenalty).arg(samplingSeed(job))
+    });
+}
+
+void BitNetClient::emitResult(const PromptJob &job, const QJsonObject &result)
+{
+    if (job.variantOf) {
+        auto run = m_variantRuns.find(job.variantOf);
+        if (run != m_variantRuns.end()) {
+            ++run->generated;
+        }
+        emit variantGenerated(job.variantOf, job.variantIndex, samplingSeed(job), result);
+    } else if (job.edit) {
+        emit worldPatchGenerated(job.id, result);
+    } else {
+        emit worldPlanGenerated(job.id, result);
+    }
+}
+
+void BitNetClient::emitStarted(PromptJob &job)
+{
+    if (job.started) {
+        return;
+    }
+    job.started = true;
+
+    if (!job.variantOf) {
+        Logger::instance().info(QString("Processing BitNet job %1: %2").arg(job.id).arg(job.prompt));
+        emit processingStarted(job.id);
+        return;
+    }
+
+    // A variant run starts and finishes once, however many variants it has
+    auto run = m_variantRuns.find(job.variantOf);
+    if (run != m_variantRuns.end() && !run->started) {
+        run->started = true;
+        Logger::instance().info(QString("Processing BitNet variant job %1: %2").arg(job.variantOf).arg(job.prompt));
+        emit processingStarted(job.variantOf);
+    }
+}
+
+void BitNetClient::emitFinished(const PromptJob &job)
+{
+    if (!job.variantOf) {
+        emit processingFinished(job.id);
+        return;
+    }
+
+    auto run = m_variantRuns.find(job.variantOf);
+    if (run == m_variantRuns.end() || --run->pending > 0) {
+        return;
+    }
+
+    VariantRun finished = *run;
+    m_variantRuns.erase(run);
+    qint64 elapsedMs = qMax<qint64>(1, finished.timer.elapsed());
+    Logger::instance().info(QString("BitNet variant job %1: %2 of %3 variants in %4 s (%5 variants/min)")
+                                .arg(job.variantOf)
+                                .arg(finished.generated)
+                                .arg(finished.requested)
+                                .arg(elapsedMs / 1000.0, 0, 'f', 1)
+                                .arg(finished.generated * 60000.0 / elapsedMs, 0, 'f', 1));
+    emit variantsFinished(job.variantOf, finished.generated, finished.requested, elapsedMs);
+    if (finished.started) {
+        emit processingFinished(job.variantOf);
+    }
+}
+
+void BitNetClient::emitCancelled(const PromptJob &job)
+{
+    // A variant run reports its cancellation once, from cancelJob
+    if (!job.variantOf) {
+        emit jobCancelled(job.id);
+    }
+}
+
+int BitNetClient::samplingSeed(const PromptJob &job)
+{
+    return job.seed >= 0 ? job.seed : kSeed;
+}
+
+QString BitNetClient::modelStamp()
+{
+    if (!m_modelStamp.isEmpty()) {
+        return m_modelStamp;
+    }
+
+    // Reading a multi-GB model to hash it would stall the window, so the
+    // file is identified by path, size and mtime instead
+    QFileInfo info(m_modelPath);
+    QString stamp = QString("%1|%2|%3").arg(info.absoluteFilePath())
+                        .arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+    m_modelStamp = QString::fromLatin1(
+        QCryptographicHash::hash(stamp.toUtf8(), QCryptographicHash::Sha256).toHex());
+
+    return m_modelStamp;
+}
+
+QString BitNetClient::worldPlanPromptPrefix()
+{
+    // Fixed part of every prompt. It comes first so its KV state can be
+    // reused; bump kPromptTemplateVersion whenever it changes.
+    return
+        "Example world plan JSON:\n"
         "{\"world_name\":\"world\",\"models\":[{\"name\":\"box\",\"type\":\"box\","
         "\"position\":{\"x\":0,\"y\":0,\"z\":0},\"rotation\":{\"roll\":0,\"pitch\":0,\"yaw\":0},"
         "\"scale\":{\"x\":1,\"y\":1,\"z\":1},\"color\":\"#FF0000\",\"static\":false}],"
         "\"lighting\":[{\"name\":\"sun\",\"type\":\"directional\",\"position\":{\"x\":0,\"y\":0,\"z\":10}}],"
-        "\"physics\":{\"gravity\":\"0 0 -9.81\",\"max_step_size\":0.001}}";
+        "\"physics\":{\"gravity\":\"0 0 -9.81\",\"max_step_size\":0.001}}\n"
+        "For many identical objects write one model with a repeat directive, e.g. "
+        "\"repeat\":{\"pattern\":\"grid\",\"count\":60,\"spacing\":2,\"rows\":6}. "
+        "Patterns: array (a line), grid (rows), ring (circle), scatter (random, spacing apart).\n"
+        "For large layouts add \"generators\", e.g. "
+        "\"generators\":[{\"generator\":\"warehouse\",\"rows\":10,\"columns\":30,\"levels\":4}]. "
+        "Generators: warehouse (racks), office (cubicles), parking (bays), maze (rows x columns cells), "
+        "scatter (count clutter objects).\n\n";
+}
+
+QString BitNetClient::createWorldPlanPrompt(const QString &prompt, const QStringList &context)
+{
+    // Shared prefix first so its evaluated state is reused, then the request
+    QString systemPrompt = worldPlanPromptPrefix();
+    if (!context.isEmpty()) {
+        systemPrompt += "Context:\n" + context.join('\n') + "\n\n";
+    }
+    systemPrompt += "Request: " + prompt + "\nJSON:\n";
 
     return systemPrompt;
 }
 
-void BitNetClient::runInference(const QString &prompt)
+QString BitNetClient::editPromptPrefix()
+{
+    // Fixed part of every edit prompt, shared across requests like worldPlanPromptPrefix()
+    return
+        "Example edit JSON:\n"
+        "{\"operations\":[{\"op\":\"modify\",\"name\":\"box\",\"position\":{\"x\":-1,\"y\":0,\"z\":0}},"
+        "{\"op\":\"remove\",\"name\":\"ball\"}]}\n\n";
+}
+
+QString BitNetClient::createEditPrompt(const QString &instruction, const QStringList &summary)
+{
+    // Only the summary and instruction vary; the model lists just what changes
+    QString editPrompt = editPromptPrefix();
+    editPrompt += "Current world:\n" + summary.join('\n') + "\n\n";
+    editPrompt += "Edit: " + instruction + "\nJSON:\n";
+
+    return editPrompt;
+}
+
+QString BitNetClient::promptCachePath(bool edit)
+{
+    if (m_promptCacheFiles.contains(edit)) {
+        return m_promptCacheFiles.value(edit);
+    }
+
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    if (!dir.exists() && !dir.mkpath(".")) {
+        return QString();
+    }
+
+    // Saved state is only valid for this template, model and context size
+    QString kind = edit ? "prompt_edit_prefix" : "prompt_prefix";
+    QString name = QString("%1_v%2_c%3_%4.bin")
+                       .arg(kind)
+                       .arg(kPromptTemplateVersion)
+                       .arg(kContextSize)
+                       .arg(modelStamp().left(16));
+
+    const QStringList stale = dir.entryList({kind + "_v*.bin"}, QDir::Files);
+    for (const QString &file : stale) {
+        if (file != name) {
+            dir.remove(file);
+        }
+    }
+
+    m_promptCacheFiles.insert(edit, dir.filePath(name));
+    return m_promptCacheFiles.value(edit);
+}
+
+void BitNetClient::recordPromptEval(ActiveJob *active)
+{
+    PromptEvalStats &stats = active->worker ? m_workerPromptEval : m_oneShotPromptEval;
+    if (active->prefixReused) {
+        stats.warmMs += active->promptEvalMs;
+        ++stats.warmRuns;
+    } else {
+        stats.coldMs += active->promptEvalMs;
+        ++stats.coldRuns;
+    }
+
+    auto average = [](qint64 totalMs, int runs) {
+        return runs > 0 ? QString("%1 ms").arg(totalMs / runs) : QString("n/a");
+    };
+    Logger::instance().info(QString("Prompt evaluation for job %1: %2 ms (%3, %4; "
+                                    "average without prefix %5, with prefix %6)")
+                                .arg(active->job.id)
+                                .arg(active->promptEvalMs)
+                                .arg(active->worker ? "resident worker" : "one-shot, includes model load")
+                                .arg(active->prefixReused ? "prefix reused" : "prefix evaluated")
+                                .arg(average(stats.coldMs, stats.coldRuns))
+                                .arg(average(stats.warmMs, stats.warmRuns)));
+}
+
+void BitNetClient::reportMetrics(ActiveJob *active)
+{
+    InferenceMetrics &metrics = active->metrics;
+    metrics.jobId = active->job.id;
+    metrics.backend = !active->worker ? "one-shot" : active->worker == m_variantWorker ? "batch" : "worker";
+    if (metrics.outcome.isEmpty()) {
+        metrics.outcome = "failed";
+    }
+    metrics.totalMs = active->timer.elapsed();
+    metrics.timeToFirstTokenMs = active->promptEvalMs;
+    if (active->worker) {
+        metrics.modelLoadMs = 0;  // Loaded before the request was sent
+    }
+
+    // Stopped early, so llama.cpp never reported its own generation timings
+    if (metrics.generatedTokens < 0 && active->tokenEvents > 0 && active->promptEvalMs >= 0) {
+        metrics.generatedTokens = active->tokenEvents;
+        metrics.generationMs = active->evalTimer.elapsed() - active->promptEvalMs;
+        if (metrics.generationMs > 0) {
+            metrics.generationTokensPerSec = metrics.generatedTokens * 1000.0 / metrics.generationMs;
+        }
+    }
+
+    Logger::instance().info(QString("Inference metrics for job %1: %2").arg(metrics.jobId).arg(metrics.summary()));
+    if (metrics.draftTokens > 0) {
+        m_draftTokens += metrics.draftTokens;
+        m_draftAccepted += qMax(0, metrics.draftAccepted);
+        Logger::instance().info(QString("Draft acceptance since startup: %1% of %2 drafted tokens")
+                                    .arg(100.0 * m_draftAccepted / m_draftTokens, 0, 'f', 1)
+                                    .arg(m_draftTokens));
+    }
+    m_metricsLog->append(metrics);
+    emit inferenceMetricsReady(metrics);
+}
+
+void BitNetClient::runInference(ActiveJob *active)
 {
     // Prepare arguments for llama-cli
     QStringList arguments;
     arguments << "-m" << m_modelPath;
-    arguments << "-p" << prompt;
-    arguments << "-n" << "200";        // Minimal tokens - just copy the template
-    arguments << "-t" << "4";          // Threads
+    arguments << "-p" << active->job.fullPrompt;
+    arguments << "-n" << QString::number(active->job.edit ? kMaxEditTokens : kMaxTokens);
+    arguments << "-t" << QString::number(m_threads);
     arguments << "-ngl" << "0";        // No GPU layers (CPU only)
-    arguments << "-c" << "1024";       // Small context for simple task
-    arguments << "--temp" << "0.3";    // Lower temperature for more focused output
-    arguments << "-b" << "1";          // Batch size
-    arguments << "--top-p" << "0.9";   // Nucleus sampling
-    arguments << "--repeat-penalty" << "1.1"; // Prevent repetition
+    arguments << "-c" << QString::number(kContextSize);
+    arguments << "--temp" << QString::number(kTemperature);
+    arguments << "-b" << QString::number(m_batchSize);
+    arguments << "--top-p" << QString::number(kTopP);
+    arguments << "--repeat-penalty" << QString::number(kRepeatPenalty);
+    arguments << "-s" << QString::number(samplingSeed(active->job));
     arguments << "--no-display-prompt"; // Don't echo the prompt
 
+    // Constrain decoding to the world plan schema
+    QString grammarFile = grammarFilePath(active->job.edit);
+    if (!grammarFile.isEmpty()) {
+        arguments << "--grammar-file" << grammarFile;
+    }
+
+    // The first run saves the evaluated prompt; later runs only reuse the
+    // matching template prefix and leave the file untouched
+    QString promptCache = promptCachePath(active->job.edit);
+    active->prefixReused = false;
+    if (!promptCache.isEmpty()) {
+        arguments << "--prompt-cache" << promptCache;
+        if (QFile::exists(promptCache)) {
+            arguments << "--prompt-cache-ro";
+            active->prefixReused = true;
+        }
+    }
+
     Logger::instance().debug("Running BitNet.cpp: " + m_bitnetCliPath + " " + arguments.join(" "));
 
+    m_oneShotJob = active;
+    active->worker = nullptr;
+    beginStream(active);
+
     // Start the process
     m_process->start(m_bitnetCliPath, arguments);
 }
 
+void BitNetClient::beginStream(ActiveJob *active)
+{
+    // A retry after a failed worker request starts from a clean stream
+    active->parser.reset();
+    active->output.clear();
+    active->parsedModels = 0;
+    active->stopRequested = false;
+    active->promptEvalMs = -1;
+    active->tokenEvents = 0;
+    active->metrics = InferenceMetrics();
+    active->evalTimer.start();
+}
+
+bool BitNetClient::feedStream(ActiveJob *active, const QByteArray &bytes)
+{
+    if (active->promptEvalMs < 0 && !bytes.isEmpty()) {
+        active->promptEvalMs = active->evalTimer.elapsed();
+        recordPromptEval(active);
+    }
+
+    active->parser.feed(bytes);
+
+    const QList<QJsonObject> entries = active->parser.takeEntries();
+    for (const QJsonObject &model : entries) {
+        // A retried or requeued job samples with the same seed, so its first
+        // entries are already in the preview
+        if (active->parsedModels++ < active->job.streamedModels) {
+            continue;
+        }
+        if (active->job.streamedModels++ == 0) {
+            Logger::instance().info(QString("First object received after %1 ms")
+                                        .arg(active->timer.elapsed()));
+        }
+        if (active->job.edit) {
+            continue;  // Operations are only applied once the whole patch is valid
+        }
+        emit modelReceived(active->job.id, model);
+    }
+
+    return active->parser.isComplete();
+}
+
+void BitNetClient::onProcessOutput()
+{
+    QByteArray bytes = m_process->readAllStandardOutput();
+    if (!m_oneShotJob || m_oneShotJob->cancelled) {
+        return;
+    }
+    m_oneShotJob->output.append(bytes);
+
+    if (feedStream(m_oneShotJob, bytes) && !m_oneShotJob->stopRequested) {
+        // Top-level object closed - don't spend the rest of the token budget
+        Logger::instance().info("World plan complete, stopping generation early");
+        m_oneShotJob->stopRequested = true;
+        m_process->terminate();
+    }
+}
+
+BitNetWorker::Config BitNetClient::workerConfig() const
+{
+    BitNetWorker::Config config;
+    QByteArray envServerPath = qgetenv("BURMA_BITNET_SERVER");
+    config.serverPath = envServerPath.isEmpty()
+        ? QFileInfo(m_bitnetCliPath).dir().filePath("llama-server")
+        : QString::fromUtf8(envServerPath);
+    config.modelPath = m_modelPath;
+    config.contextSize = kContextSize;
+    config.threads = m_threads;
+    config.batchSize = m_batchSize;
+    config.draftModelPath = m_draftModelPath;
+    config.draftLength = m_draftLength;
+    return config;
+}
+
+QJsonObject BitNetClient::workerRequest(const ActiveJob *active) const
+{
+    QJsonObject request;
+    request["prompt"] = active->job.fullPrompt;
+    request["n_predict"] = active->job.edit ? kMaxEditTokens : kMaxTokens;
+    request["temperature"] = kTemperature;
+    request["top_p"] = kTopP;
+    request["repeat_penalty"] = kRepeatPenalty;
+    request["seed"] = samplingSeed(active->job);
+    request["grammar"] = active->job.edit ? WorldPlanSchema::patchGrammar() : WorldPlanSchema::grammar();
+    request["cache_prompt"] = true;    // Only the tokens after the shared prefix are evaluated
+    return request;
+}
+
+BitNetWorker* BitNetClient::variantWorker()
+{
+    if (m_variantWorker) {
+        return m_variantWorker;
+    }
+
+    // The pool's cores, pinned as the pool's workers are; the slots share
+    // every decode step. It only decodes while the pool is idle (see
+    // scheduleJobs), so the two never run on the same cores at once.
+    // Speculative decoding is left to the interactive workers.
+    BitNetWorker::Config config = workerConfig();
+    if (m_poolSize > 1) {
+        int cores = QThread::idealThreadCount();
+        config.threads = qMin(cores, qMax(1, cores / m_poolSize) * m_poolSize);
+        config.cpuList = QString("0-%1").arg(config.threads - 1);
+    }
+    config.parallelSlots = kVariantSlots;
+    config.draftModelPath.clear();
+
+    BitNetWorker *worker = new BitNetWorker(config, this);
+    connect(worker, &BitNetWorker::ready, this, [this](qint64 loadTimeMs) {
+        Logger::instance().info(QString("BitNet variant server ready with %1 slots (load time %2 ms)")
+                                    .arg(kVariantSlots).arg(loadTimeMs));
+        scheduleJobs();
+    });
+    connect(worker, &BitNetWorker::unavailable, this, [this](const QString &reason) {
+        Logger::instance().warning("BitNet variant server unavailable, variants run one by one: " + reason);
+        scheduleJobs();
+    });
+    connect(worker, &BitNetWorker::batchFinished, this, [this, worker](const QList<QJsonObject> &responses) {
+        onVariantBatchFinished(worker, responses);
+    });
+    connect(worker, &BitNetWorker::completionFailed, this, [this, worker](const QString &error) {
+        onWorkerFailed(worker, error);
+    });
+
+    m_variantWorker = worker;
+    worker->start();
+    return worker;
+}
+
+void BitNetClient::runVariantBatch(BitNetWorker *worker)
+{
+    // Consecutive variants of the run at the head of the queue, one per slot
+    JobId runId = m_queue.first().variantOf;
+    QList<QJsonObject> requests;
+    QList<ActiveJob*> batch;
+    for (int i = 0; i < m_queue.size() && batch.size() < worker->config().parallelSlots;) {
+        const PromptJob &job = m_queue.at(i);
+        if (job.variantOf != runId || job.workerFailures >= kMaxWorkerAttempts) {
+            ++i;
+            continue;
+        }
+
+        ActiveJob *active = activateJob(m_queue.takeAt(i));
+        active->worker = worker;
+        active->prefixReused = worker->requestCount() > 0;
+        beginStream(active);
+        requests.append(workerRequest(active));
+        batch.append(active);
+    }
+
+    Logger::instance().debug(QString("Sending %1 variants of job %2 to the variant server")
+                                 .arg(batch.size()).arg(runId));
+
+    if (!worker->completeBatch(requests)) {
+        for (ActiveJob *active : std::as_const(batch)) {
+            requeueJob(active);
+        }
+    }
+}
+
+void BitNetClient::onVariantBatchFinished(BitNetWorker *worker, const QList<QJsonObject> &responses)
+{
+    // Active jobs keep the order the requests were sent in
+    const QList<ActiveJob*> batch = jobsForWorker(worker);
+    for (int i = 0; i < batch.size(); ++i) {
+        ActiveJob *active = batch.at(i);
+        if (!m_activeJobs.contains(active)) {
+            continue;  // Finished by a listener of an earlier variant
+        }
+
+        QJsonObject response = i < responses.size() ? responses.at(i) : QJsonObject();
+        if (response.isEmpty()) {
+            ++active->job.workerFailures;
+            requeueJob(active);
+            continue;
+        }
+
+        active->metrics.applyServerTimings(response.value("timings").toObject());
+        handleOutput(active, response.value("content").toString().toUtf8());
+    }
+}
+
+QList<BitNetClient::ActiveJob*> BitNetClient::jobsForWorker(BitNetWorker *worker) const
+{
+    QList<ActiveJob*> jobs;
+    for (ActiveJob *active : m_activeJobs) {
+        if (active->worker == worker) {
+            jobs.append(active);
+        }
+    }
+    return jobs;
+}
+
+void BitNetClient::runWorkerInference(ActiveJob *active, BitNetWorker *worker)
+{
+    QJsonObject request = workerRequest(active);
+
+    Logger::instance().debug(QString("Sending job %1 to resident BitNet worker %2")
+                                 .arg(active->job.id)
+                                 .arg(m_workers.indexOf(worker)));
+
+    active->worker = worker;
+    active->prefixReused = worker->requestCount() > 0;
+    beginStream(active);
+    if (!worker->complete(request)) {
+        requeueJob(active);
+    }
+}
+
+void BitNetClient::onWorkerReady(BitNetWorker *worker, qint64 loadTimeMs)
+{
+    Logger::instance().info(QString("BitNet model resident in worker %1 (load time %2 ms)")
+                                .arg(m_workers.indexOf(worker))
+                                .arg(loadTimeMs));
+
+    // Waiting jobs take priority over priming
+    if (m_warmUpRequested && m_queue.isEmpty()) {
+        primeWorker(worker);
+    }
+
+    // Jobs may be waiting for the model to load
+    scheduleJobs();
+}
+
+void BitNetClient::onWorkerUnavailable(BitNetWorker *worker, const QString &reason)
+{
+    Logger::instance().warning(QString("BitNet worker %1 unavailable: %2")
+                                   .arg(m_workers.indexOf(worker))
+                                   .arg(reason));
+
+    // Without a usable worker the warm page cache is all the warm-up achieves
+    m_primingWorkers.removeOne(worker);
+    if (m_warmUpRequested && !workersPending()) {
+        finishWarmUp();
+    }
+
+    // Waiting jobs move to the remaining workers, or one-shot if none are left
+    scheduleJobs();
+}
+
+void BitNetClient::onWorkerTokens(BitNetWorker *worker, const QString &text)
+{
+    ActiveJob *active = jobForWorker(worker);
+    if (!active || active->stopRequested) {
+        return;
+    }
+
+    // The grammar ends generation right after the closing brace, so the
+    // reply is left to finish; its final event carries the server timings
+    ++active->tokenEvents;
+    if (feedStream(active, text.toUtf8())) {
+        active->stopRequested = true;
+    }
+}
+
+void BitNetClient::onWorkerCompletion(BitNetWorker *worker, const QString &content,
+                                      const QJsonObject &response)
+{
+    ActiveJob *active = jobForWorker(worker);
+    if (!active) {
+        if (m_primingWorkers.removeOne(worker)) {
+            finishWarmUp();
+            applyCalibration();
+            scheduleJobs();  // A prompt may have arrived while the worker was priming
+        }
+        return;
+    }
+    active->metrics.applyServerTimings(response.value("timings").toObject());
+    Logger::instance().debug("BitNet worker output: " + content);
+    handleOutput(active, active->stopRequested ? active->parser.document() : content.toUtf8());
+}
+
+void BitNetClient::onWorkerFailed(BitNetWorker *worker, const QString &error)
+{
+    Logger::instance().warning(error);
+
+    // A variant server fails a whole batch at once
+    const QList<ActiveJob*> jobs = jobsForWorker(worker);
+    if (jobs.isEmpty() && m_primingWorkers.removeOne(worker)) {
+        finishWarmUp();
+        scheduleJobs();
+        return;
+    }
+
+    // Retry on another worker; repeated failures go to one-shot inference
+    for (ActiveJob *active : jobs) {
+        if (active->cancelled) {
+            continue;
+        }
+        ++active->job.workerFailures;
+        Logger::instance().info(QString("Requeueing BitNet job %1 after worker failure").arg(active->job.id));
+        requeueJob(active);
+    }
+}
+
 void BitNetClient::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
-    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+    ActiveJob *active = m_oneShotJob;
+    if (!active) {
+        return;
+    }
+
+    // llama-cli prints its timing summary on stderr when it exits normally
+    QString stderrText = QString::fromUtf8(m_process->readAllStandardError());
+    active->metrics.applyCliTimings(stderrText);
+    active->metrics.exitCode = exitCode;
+
+    if (active->cancelled) {
+        active->metrics.outcome = "cancelled";
+        emitCancelled(active->job);
+        finishJob(active);
+        return;
+    }
+
+    // Terminated on purpose once the world plan was complete
+    bool stoppedEarly = active->stopRequested;
+
+    if (!stoppedEarly && (exitStatus != QProcess::NormalExit || exitCode != 0)) {
         QString error = QString("BitNet.cpp process failed with exit code %1: %2")
                             .arg(exitCode)
-                            .arg(QString::fromUtf8(m_process->readAllStandardError()));
+                            .arg(stderrText);
         Logger::instance().error(error);
 
-        // Use fallback world on error
-        Logger::instance().info("Using fallback: creating simple default world");
-        emit worldPlanGenerated(createFallbackWorld());
-        emit processingFinished();
+        // Use fallback world on error; a failed variant is simply left out,
+        // and a failed edit leaves the current world as it is
+        recordOutcome(false, active->timer.elapsed());
+        if (active->job.edit) {
+            emit errorOccurred(active->job.id, error);
+        } else if (!active->job.variantOf) {
+            Logger::instance().info("Using fallback: creating simple default world");
+            emit worldPlanGenerated(active->job.id, createFallbackWorld());
+        }
+        finishJob(active);
         return;
     }
 
-    // Read output
-    QString output = QString::fromUtf8(m_process->readAllStandardOutput());
-    Logger::instance().debug("BitNet.cpp output: " + output);
+    // Read whatever arrived after the last readyRead
+    active->output.append(m_process->readAllStandardOutput());
+    Logger::instance().debug("BitNet.cpp output: " + QString::fromUtf8(active->output));
+
+    handleOutput(active, active->output);
+}
+
+void BitNetClient::handleOutput(ActiveJob *active, const QByteArray &output)
+{
+    JobId jobId = active->job.id;
+    qint64 elapsedMs = active->timer.elapsed();
+    Logger::instance().info(QString("Prompt latency for job %1: %2 ms (%3)")
+                                .arg(jobId)
+                                .arg(elapsedMs)
+                                .arg(active->worker ? "resident worker"
+                                                    : "one-shot, includes model load"));
 
     // Parse response
-    QJsonObject worldPlan = parseResponse(output);
+    QJsonObject worldPlan = parseResponse(output, active->job.edit);
 
-    if (!worldPlan.isEmpty()) {
+    if (active->job.edit) {
+        // No fallback for edits - the current world simply stays as it is
+        recordOutcome(!worldPlan.isEmpty(), elapsedMs);
+        active->metrics.outcome = worldPlan.isEmpty() ? "rejected" : "ok";
+        if (!worldPlan.isEmpty()) {
+            Logger::instance().info("World edit generated successfully");
+            m_responseCache->store(active->job.cacheKey, worldPlan);
+            emit worldPatchGenerated(jobId, worldPlan);
+        } else {
+            emit errorOccurred(jobId, "Could not understand the edit; the world was left unchanged");
+        }
+    } else if (!worldPlan.isEmpty()) {
         Logger::instance().info("World plan generated successfully");
-        emit worldPlanGenerated(worldPlan);
+        recordOutcome(true, elapsedMs);
+        active->metrics.outcome = "ok";
+        m_responseCache->store(active->job.cacheKey, worldPlan);
+        emitResult(active->job, worldPlan);
+    } else if (active->job.variantOf) {
+        // A dataset is better off one variant short than padded with default worlds
+        Logger::instance().warning(QString("Variant %1 of job %2 produced no valid world plan")
+                                       .arg(active->job.variantIndex).arg(active->job.variantOf));
+        recordOutcome(false, elapsedMs);
+        active->metrics.outcome = "rejected";
     } else {
         // BitNet failed to generate valid JSON - use fallback
         Logger::instance().warning("BitNet.cpp output invalid, using fallback world");
-        emit worldPlanGenerated(createFallbackWorld());
+        recordOutcome(false, elapsedMs);
+        active->metrics.outcome = "fallback";
+        emit worldPlanGenerated(jobId, createFallbackWorld());
     }
 
-    emit processingFinished();
+    finishJob(active);
+}
+
+QString BitNetClient::grammarFilePath(bool edit)
+{
+    QString cached = m_grammarFiles.value(edit);
+    if (!cached.isEmpty() && QFile::exists(cached)) {
+        return cached;
+    }
+
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+
+    QFile file(dir.filePath(edit ? "world_patch.gbnf" : "world_plan.gbnf"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        Logger::instance().warning("Failed to write world plan grammar: " + file.errorString());
+        return QString();
+    }
+    file.write((edit ? WorldPlanSchema::patchGrammar() : WorldPlanSchema::grammar()).toUtf8());
+    file.close();
+
+    m_grammarFiles.insert(edit, file.fileName());
+    Logger::instance().debug("World plan grammar written to: " + file.fileName());
+    return file.fileName();
+}
+
+void BitNetClient::recordOutcome(bool accepted, qint64 elapsedMs)
+{
+    if (accepted) {
+        ++m_acceptedPlans;
+    } else {
+        ++m_fallbackPlans;
+        m_wastedInferenceMs += elapsedMs;
+    }
+
+    int total = m_acceptedPlans + m_fallbackPlans;
+    Logger::instance().info(QString("World plans: %1 accepted, %2 fallback (%3% fallback rate), "
+                                    "%4 s inference wasted")
+                                .arg(m_acceptedPlans)
+                                .arg(m_fallbackPlans)
+                                .arg(100.0 * m_fallbackPlans / total, 0, 'f', 1)
+                                .arg(m_wastedInferenceMs / 1000.0, 0, 'f', 1));
 }
 
 QJsonObject BitNetClient::createFallbackWorld()
@@ -226,6 +1741,11 @@ QJsonObject BitNetClient::createFallbackWorld()
 
 void BitNetClient::onProcessError(QProcess::ProcessError error)
 {
+    if (error == QProcess::Crashed && m_oneShotJob
+        && (m_oneShotJob->stopRequested || m_oneShotJob->cancelled)) {
+        return;  // We stopped it ourselves
+    }
+
     QString errorMsg;
     switch (error) {
         case QProcess::FailedToStart:
@@ -243,63 +1763,50 @@ void BitNetClient::onProcessError(QProcess::ProcessError error)
     }
 
     Logger::instance().error(errorMsg);
-    emit errorOccurred(errorMsg);
-    emit processingFinished();
-}
 
-QJsonObject BitNetClient::parseResponse(const QString &output)
-{
-    // Try to find JSON in the output
-    // BitNet.cpp output may contain debug info, so extract JSON portion
+    JobId jobId = m_oneShotJob ? m_oneShotJob->job.id : 0;
+    emit errorOccurred(jobId, errorMsg);
 
-    int jsonStart = output.indexOf('{');
-    int jsonEnd = output.lastIndexOf('}');
+    // finished() is not emitted when the process never started
+    if (error == QProcess::FailedToStart && m_oneShotJob) {
+        finishJob(m_oneShotJob);
+    }
+}
 
-    if (jsonStart == -1 || jsonEnd == -1 || jsonStart >= jsonEnd) {
+QJsonObject BitNetClient::parseResponse(const QByteArray &output, bool edit)
+{
+    // BitNet.cpp output may contain debug info around the JSON; take the first
+    // top-level object and close it if generation stopped partway through
+    JsonExtractor::Result range = JsonExtractor::scan(output);
+    if (!range.found()) {
         Logger::instance().warning("No JSON found in output");
         return QJsonObject();
     }
-
-    QString jsonStr = output.mid(jsonStart, jsonEnd - jsonStart + 1);
-
-    // Try to fix truncated JSON by closing arrays/objects
-    if (jsonStr.count('{') > jsonStr.count('}')) {
-        // Add missing closing braces
-        int missing = jsonStr.count('{') - jsonStr.count('}');
-        for (int i = 0; i < missing; i++) {
-            jsonStr.append("}");
-        }
-    }
-    if (jsonStr.count('[') > jsonStr.count(']')) {
-        // Add missing closing brackets
-        int missing = jsonStr.count('[') - jsonStr.count(']');
-        for (int i = 0; i < missing; i++) {
-            jsonStr.append("]");
-        }
+    if (!range.isComplete()) {
+        Logger::instance().debug(QString("Repairing truncated JSON with \"%1\"")
+                                     .arg(QString::fromLatin1(range.closing)));
     }
 
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonStr.toUtf8(), &parseError);
-
-    if (parseError.error != QJsonParseError::NoError) {
-        Logger::instance().error("JSON parse error: " + parseError.errorString());
-        Logger::instance().debug("Attempted JSON: " + jsonStr);
+    QString parseError;
+    QJsonObject response = JsonExtractor::parse(output, range, &parseError);
+    if (response.isEmpty()) {
+        Logger::instance().error("JSON parse error: " + parseError);
+        Logger::instance().debug("Attempted JSON: "
+                                 + QString::fromUtf8(output.constData() + range.begin,
+                                                     range.end - range.begin)
+                                 + QString::fromLatin1(range.closing));
         return QJsonObject();
     }
 
-    if (!doc.isObject()) {
-        Logger::instance().error("Parsed JSON is not an object");
-        return QJsonObject();
-    }
-
-    QJsonObject response = doc.object();
-
-    // Validate it's a world plan
-    if (response.contains("world_name") && response.contains("models")) {
+    // Validate it's a world plan, or a patch for an edit
+    QString schemaError;
+    if (edit ? WorldPlanSchema::validatePatch(response, &schemaError)
+             : WorldPlanSchema::validate(response, &schemaError)) {
         return response;
     }
 
-    Logger::instance().warning("JSON doesn't match expected world plan format");
+    Logger::instance().warning(QString("JSON doesn't match expected %1 format: %2")
+                                   .arg(edit ? "edit patch" : "world plan", schemaError));
     return QJsonObject();
 }
 
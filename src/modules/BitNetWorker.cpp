@@ -0,0 +1,408 @@
+#include "modules/BitNetWorker.h"
+#include "utils/Logger.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QJsonDocument>
+#include <QTcpServer>
+#include <QHostAddress>
+#include <QTimer>
+#include <QUrl>
+#include <QFile>
+#include <QStandardPaths>
+
+namespace Burma {
+
+namespace {
+// How often to poll /health while the model loads, and how long to wait
+constexpr int kHealthIntervalMs = 250;
+constexpr qint64 kLoadTimeoutMs = 180000;
+
+// Server log kept to explain a failure; llama-server logs every request, so
+// the rest is dropped as it arrives
+constexpr int kLogTailBytes = 4096;
+}
+
+BitNetWorker::BitNetWorker(const Config &config, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_state(State::Stopped)
+    , m_port(0)
+    , m_process(new QProcess(this))
+    , m_networkManager(new QNetworkAccessManager(this))
+    , m_activeReply(nullptr)
+    , m_healthTimer(new QTimer(this))
+    , m_batchPending(0)
+    , m_loadTimeMs(-1)
+    , m_busyMs(0)
+    , m_completedRequests(0)
+    , m_requestCount(0)
+{
+    m_healthTimer->setInterval(kHealthIntervalMs);
+
+    connect(m_healthTimer, &QTimer::timeout, this, &BitNetWorker::onHealthCheck);
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &BitNetWorker::onProcessFinished);
+    connect(m_process, &QProcess::errorOccurred,
+            this, &BitNetWorker::onProcessError);
+
+    // Nothing else reads the server's output, so it would pile up in
+    // QProcess for the whole session
+    m_process->setProcessChannelMode(QProcess::MergedChannels);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, [this]() {
+        m_logTail.append(m_process->readAllStandardOutput());
+        if (m_logTail.size() > kLogTailBytes) {
+            m_logTail.remove(0, m_logTail.size() - kLogTailBytes);
+        }
+    });
+}
+
+BitNetWorker::~BitNetWorker()
+{
+    stop();
+}
+
+void BitNetWorker::start()
+{
+    if (m_state == State::Loading || m_state == State::Ready || m_state == State::Busy) {
+        return;
+    }
+
+    if (!QFile::exists(m_config.serverPath)) {
+        fail("llama-server not found at " + m_config.serverPath);
+        return;
+    }
+
+    m_port = findFreePort();
+    if (m_port <= 0) {
+        fail("No free local port for llama-server");
+        return;
+    }
+
+    // llama-server splits the context evenly between its slots
+    int slots = qMax(1, m_config.parallelSlots);
+
+    QStringList arguments;
+    arguments << "-m" << m_config.modelPath;
+    arguments << "-c" << QString::number(m_config.contextSize * slots);
+    arguments << "-t" << QString::number(m_config.threads);
+    arguments << "-b" << QString::number(m_config.batchSize);
+    arguments << "-ngl" << "0";        // CPU only, same as the one-shot path
+    arguments << "--host" << "127.0.0.1";
+    arguments << "--port" << QString::number(m_port);
+    if (slots > 1) {
+        arguments << "-np" << QString::number(slots);
+        arguments << "-cb";            // Continuous batching: all slots share each decode step
+    }
+
+    // The draft model proposes tokens and the main model verifies them in one batch
+    if (!m_config.draftModelPath.isEmpty()) {
+        arguments << "-md" << m_config.draftModelPath;
+        arguments << "--draft" << QString::number(m_config.draftLength);
+        arguments << "-ngld" << "0";
+    }
+
+    // Pin to a core set so pooled workers don't fight over the same caches
+    QString program = m_config.serverPath;
+    if (!m_config.cpuList.isEmpty()) {
+        QString taskset = QStandardPaths::findExecutable("taskset");
+        if (!taskset.isEmpty()) {
+            arguments.prepend(m_config.serverPath);
+            arguments.prepend(m_config.cpuList);
+            arguments.prepend("-c");
+            program = taskset;
+        } else {
+            Logger::instance().debug("taskset not found, BitNet worker runs unpinned");
+        }
+    }
+
+    Logger::instance().info(QString("Starting resident BitNet worker on port %1").arg(m_port));
+    Logger::instance().debug("Running BitNet worker: " + program + " " + arguments.join(" "));
+
+    m_state = State::Loading;
+    m_loadTimeMs = -1;
+    m_requestCount = 0;
+    m_logTail.clear();
+    m_loadTimer.start();
+    m_process->start(program, arguments);
+    m_healthTimer->start();
+}
+
+void BitNetWorker::stop()
+{
+    m_healthTimer->stop();
+    abortRequests();
+    markIdle();
+
+    if (m_process->state() != QProcess::NotRunning) {
+        m_process->blockSignals(true);
+        m_process->terminate();
+        if (!m_process->waitForFinished(2000)) {
+            m_process->kill();
+            m_process->waitForFinished();
+        }
+        m_process->blockSignals(false);
+    }
+
+    m_state = State::Stopped;
+}
+
+bool BitNetWorker::complete(const QJsonObject &request)
+{
+    if (m_state != State::Ready) {
+        return false;
+    }
+
+    QJsonObject streamingRequest = request;
+    streamingRequest["stream"] = true;
+
+    QNetworkRequest httpRequest(QUrl(QString("http://127.0.0.1:%1/completion").arg(m_port)));
+    httpRequest.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    httpRequest.setTransferTimeout(0);
+
+    m_state = State::Busy;
+    ++m_requestCount;
+    m_busyTimer.start();
+    m_eventBuffer.clear();
+    m_content.clear();
+    m_finalEvent = QJsonObject();
+    m_activeReply = m_networkManager->post(httpRequest,
+                                           QJsonDocument(streamingRequest).toJson(QJsonDocument::Compact));
+
+    QNetworkReply *reply = m_activeReply;
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        if (reply == m_activeReply) {
+            readStreamEvents(reply);
+        }
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (reply != m_activeReply) {
+            return;  // Cancelled or aborted by stop()
+        }
+        m_activeReply = nullptr;
+        markIdle();
+        if (m_state == State::Busy) {
+            m_state = State::Ready;
+        }
+
+        if (reply->error() != QNetworkReply::NoError) {
+            emit completionFailed("BitNet worker request failed: " + reply->errorString());
+            return;
+        }
+
+        ++m_completedRequests;
+        readStreamEvents(reply);
+        emit completionFinished(m_content, m_finalEvent);
+    });
+
+    return true;
+}
+
+bool BitNetWorker::completeBatch(const QList<QJsonObject> &requests)
+{
+    if (m_state != State::Ready || requests.isEmpty()) {
+        return false;
+    }
+
+    m_state = State::Busy;
+    ++m_requestCount;
+    m_busyTimer.start();
+    m_batchResponses = QList<QJsonObject>(requests.size());
+    m_batchPending = requests.size();
+
+    for (int i = 0; i < requests.size(); ++i) {
+        QJsonObject request = requests.at(i);
+        request["stream"] = false;
+
+        QNetworkRequest httpRequest(QUrl(QString("http://127.0.0.1:%1/completion").arg(m_port)));
+        httpRequest.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        httpRequest.setTransferTimeout(0);
+
+        QNetworkReply *reply = m_networkManager->post(httpRequest,
+                                                      QJsonDocument(request).toJson(QJsonDocument::Compact));
+        m_batchReplies.append(reply);
+        connect(reply, &QNetworkReply::finished, this, [this, reply, i]() {
+            reply->deleteLater();
+            if (!m_batchReplies.removeOne(reply)) {
+                return;  // Cancelled or aborted by stop()
+            }
+
+            if (reply->error() == QNetworkReply::NoError) {
+                m_batchResponses[i] = QJsonDocument::fromJson(reply->readAll()).object();
+            } else {
+                Logger::instance().warning(QString("BitNet batch request %1 failed: %2")
+                                               .arg(i).arg(reply->errorString()));
+            }
+
+            if (--m_batchPending > 0) {
+                return;
+            }
+            markIdle();
+            if (m_state == State::Busy) {
+                m_state = State::Ready;
+            }
+            ++m_completedRequests;
+            emit batchFinished(m_batchResponses);
+        });
+    }
+    return true;
+}
+
+void BitNetWorker::abortRequests()
+{
+    // Cleared first so the finished handlers ignore the aborted replies
+    QList<QNetworkReply*> replies = m_batchReplies;
+    m_batchReplies.clear();
+    m_batchPending = 0;
+    if (m_activeReply) {
+        replies.append(m_activeReply);
+        m_activeReply = nullptr;
+    }
+
+    for (QNetworkReply *reply : replies) {
+        reply->abort();
+    }
+}
+
+void BitNetWorker::cancel()
+{
+    if (!m_activeReply && m_batchReplies.isEmpty()) {
+        return;
+    }
+
+    // Closing the connection makes llama-server stop generating for this slot
+    abortRequests();
+    markIdle();
+
+    if (m_state == State::Busy) {
+        m_state = State::Ready;
+    }
+}
+
+qint64 BitNetWorker::busyTimeMs() const
+{
+    return m_busyMs + (m_busyTimer.isValid() ? m_busyTimer.elapsed() : 0);
+}
+
+void BitNetWorker::markIdle()
+{
+    if (m_busyTimer.isValid()) {
+        m_busyMs += m_busyTimer.elapsed();
+        m_busyTimer.invalidate();
+    }
+}
+
+void BitNetWorker::readStreamEvents(QNetworkReply *reply)
+{
+    m_eventBuffer.append(reply->readAll());
+
+    int lineEnd;
+    while ((lineEnd = m_eventBuffer.indexOf('\n')) >= 0) {
+        QByteArray line = m_eventBuffer.left(lineEnd).trimmed();
+        m_eventBuffer.remove(0, lineEnd + 1);
+
+        if (!line.startsWith("data:")) {
+            continue;
+        }
+
+        QJsonDocument doc = QJsonDocument::fromJson(line.mid(5).trimmed());
+        if (!doc.isObject()) {
+            continue;
+        }
+
+        QJsonObject event = doc.object();
+        QString text = event.value("content").toString();
+        if (!text.isEmpty()) {
+            m_content += text;
+            emit tokensReceived(text);
+        }
+        if (event.value("stop").toBool()) {
+            m_finalEvent = event;
+        }
+    }
+}
+
+void BitNetWorker::onHealthCheck()
+{
+    if (m_state != State::Loading) {
+        m_healthTimer->stop();
+        return;
+    }
+
+    if (m_loadTimer.elapsed() > kLoadTimeoutMs) {
+        fail("BitNet worker did not finish loading the model in time");
+        return;
+    }
+
+    QNetworkRequest request(QUrl(QString("http://127.0.0.1:%1/health").arg(m_port)));
+    QNetworkReply *reply = m_networkManager->get(request);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+
+        // llama-server answers 503 until the model is loaded
+        if (m_state != State::Loading || reply->error() != QNetworkReply::NoError) {
+            return;
+        }
+
+        m_healthTimer->stop();
+        m_loadTimeMs = m_loadTimer.elapsed();
+        m_state = State::Ready;
+
+        Logger::instance().info(QString("BitNet worker ready, model load time: %1 ms").arg(m_loadTimeMs));
+        emit ready(m_loadTimeMs);
+    });
+}
+
+void BitNetWorker::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    Q_UNUSED(exitStatus);
+    m_logTail.append(m_process->readAllStandardOutput());
+    fail(QString("BitNet worker exited with code %1: %2")
+             .arg(exitCode)
+             .arg(QString::fromUtf8(m_logTail.right(512))));
+}
+
+void BitNetWorker::onProcessError(QProcess::ProcessError error)
+{
+    if (error == QProcess::FailedToStart) {
+        fail("BitNet worker failed to start: " + m_config.serverPath);
+    }
+}
+
+int BitNetWorker::findFreePort() const
+{
+    QTcpServer probe;
+    if (!probe.listen(QHostAddress::LocalHost, 0)) {
+        return -1;
+    }
+    int port = probe.serverPort();
+    probe.close();
+    return port;
+}
+
+void BitNetWorker::fail(const QString &reason)
+{
+    bool wasBusy = m_state == State::Busy;
+
+    m_healthTimer->stop();
+    abortRequests();
+    markIdle();
+    if (m_process->state() != QProcess::NotRunning) {
+        m_process->blockSignals(true);
+        m_process->kill();
+        m_process->waitForFinished();
+        m_process->blockSignals(false);
+    }
+
+    m_state = State::Failed;
+    Logger::instance().warning(reason);
+
+    if (wasBusy) {
+        emit completionFailed(reason);
+    }
+    emit unavailable(reason);
+}
+
+} // namespace Burma
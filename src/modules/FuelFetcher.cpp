@@ -8,6 +8,11 @@
 #include <QDir>
 #include <QFile>
 #include <QStandardPaths>
+#include <QSaveFile>
+#include <QThread>
+#include <QPointer>
+#include <QXmlStreamReader>
+#include <QUrlQuery>
 
 namespace Burma {
 
@@ -15,6 +20,7 @@ FuelFetcher::FuelFetcher(QObject *parent)
     : QObject(parent)
     , m_networkManager(new QNetworkAccessManager(this))
     , m_fuelApiBase("https://fuel.gazebosim.org/1.0")
+    , m_syncingCatalog(false)
 {
     m_cacheDirectory = getCacheDirectory();
     ensureCacheDirectory();
@@ -83,6 +89,190 @@ QString FuelFetcher::getLocalModelPath(const QString &modelName) const
     return QDir(m_cacheDirectory).filePath(modelName);
 }
 
+QString FuelFetcher::catalogPath() const
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return QDir(cacheDir).filePath("fuel_catalog.json");
+}
+
+bool FuelFetcher::hasCatalog() const
+{
+    return QFile::exists(catalogPath());
+}
+
+void FuelFetcher::syncCatalog()
+{
+    if (m_syncingCatalog) {
+        return;
+    }
+
+    Logger::instance().info("Syncing Gazebo Fuel model catalog...");
+    m_syncingCatalog = true;
+    m_catalog = QJsonArray();
+    requestCatalogPage(1);
+}
+
+void FuelFetcher::requestCatalogPage(int page)
+{
+    QUrl url(m_fuelApiBase + "/models");
+    QUrlQuery query;
+    query.addQueryItem("page", QString::number(page));
+    query.addQueryItem("per_page", "100");
+    url.setQuery(query);
+
+    QNetworkRequest request{url};
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+
+    QNetworkReply *reply = m_networkManager->get(request);
+    reply->setProperty("page", page);
+    connect(reply, &QNetworkReply::finished, this, &FuelFetcher::onCatalogPageFinished);
+}
+
+void FuelFetcher::onCatalogPageFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        m_syncingCatalog = false;
+        QString error = "Catalog sync failed: " + reply->errorString();
+        Logger::instance().error(error);
+        emit errorOccurred(error);
+        return;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+    QJsonArray models = doc.isArray() ? doc.array() : doc.object()["models"].toArray();
+    for (const QJsonValue &model : models) {
+        m_catalog.append(model);
+    }
+
+    // A short page is the last one
+    if (models.size() == 100) {
+        requestCatalogPage(reply->property("page").toInt() + 1);
+        return;
+    }
+
+    m_syncingCatalog = false;
+    QSaveFile file(catalogPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        QString error = "Failed to save model catalog: " + file.errorString();
+        Logger::instance().error(error);
+        emit errorOccurred(error);
+        return;
+    }
+    file.write(QJsonDocument(m_catalog).toJson(QJsonDocument::Compact));
+    file.commit();
+
+    int count = m_catalog.size();
+    m_catalog = QJsonArray();
+    Logger::instance().info(QString("Fuel catalog synced: %1 models").arg(count));
+    emit catalogSynced(count);
+}
+
+AssetIndex::Asset FuelFetcher::localAsset(const QString &modelDirectory)
+{
+    QDir dir(modelDirectory);
+    AssetIndex::Asset asset;
+    asset.name = dir.dirName();
+    asset.owner = "local";
+
+    QFile config(dir.filePath("model.config"));
+    if (config.open(QIODevice::ReadOnly)) {
+        QXmlStreamReader xml(&config);
+        // Only direct children of <model>; <author> has a <name> of its own
+        if (xml.readNextStartElement() && xml.name() == QLatin1String("model")) {
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QLatin1String("name")) {
+                    asset.name = xml.readElementText().simplified();
+                } else if (xml.name() == QLatin1String("description")) {
+                    asset.description = xml.readElementText().simplified();
+                } else {
+                    xml.skipCurrentElement();
+                }
+            }
+        }
+    }
+
+    // The first box size is a good enough footprint for the prompt
+    QFile sdf(dir.filePath("model.sdf"));
+    if (sdf.open(QIODevice::ReadOnly)) {
+        QXmlStreamReader xml(&sdf);
+        while (!xml.atEnd() && asset.dimensions.isEmpty()) {
+            if (xml.readNext() == QXmlStreamReader::StartElement
+                && xml.name() == QLatin1String("size")) {
+                asset.dimensions = xml.readElementText().simplified().replace(' ', " x ");
+            }
+        }
+    }
+    return asset;
+}
+
+QList<AssetIndex::Asset> FuelFetcher::catalogAssets(const QString &catalogPath,
+                                                    const QString &cacheDirectory)
+{
+    QList<AssetIndex::Asset> assets;
+
+    QFile file(catalogPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QJsonArray catalog = QJsonDocument::fromJson(file.readAll()).array();
+        assets.reserve(catalog.size());
+        for (const QJsonValue &value : catalog) {
+            QJsonObject model = value.toObject();
+            AssetIndex::Asset asset;
+            asset.name = model["name"].toString();
+            asset.owner = model["owner"].toString();
+            asset.description = model["description"].toString().simplified();
+            for (const QJsonValue &tag : model["tags"].toArray()) {
+                asset.tags << tag.toString();
+            }
+            if (!asset.name.isEmpty()) {
+                assets.append(asset);
+            }
+        }
+    }
+
+    const QStringList localModels = QDir(cacheDirectory).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &model : localModels) {
+        assets.append(localAsset(QDir(cacheDirectory).filePath(model)));
+    }
+    return assets;
+}
+
+void FuelFetcher::rebuildAssetIndex(const QString &indexPath)
+{
+    // Reading the catalog and every cached model, then embedding and
+    // clustering them, takes a few seconds; keep it all off the UI thread.
+    // The thread gets copies of the paths and touches the fetcher only
+    // through a queued call, which is dropped if the fetcher is gone.
+    QPointer<FuelFetcher> self(this);
+    QString catalog = catalogPath();
+    QString cacheDirectory = m_cacheDirectory;
+    QThread *thread = QThread::create([self, catalog, cacheDirectory, indexPath]() {
+        QList<AssetIndex::Asset> assets = catalogAssets(catalog, cacheDirectory);
+        if (assets.isEmpty()) {
+            Logger::instance().info("No Fuel catalog or cached models to index yet");
+            return;
+        }
+
+        QString error;
+        if (!AssetIndex::build(assets, indexPath, &error)) {
+            Logger::instance().error("Failed to build asset index: " + error);
+            return;
+        }
+        if (self) {
+            QMetaObject::invokeMethod(self, [self, indexPath]() {
+                emit self->assetIndexReady(indexPath);
+            }, Qt::QueuedConnection);
+        }
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
+
 void FuelFetcher::onSearchFinished()
 {
     QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
@@ -0,0 +1,136 @@
+#include "modules/InferenceMetrics.h"
+#include "utils/Logger.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QRegularExpression>
+
+namespace Burma {
+
+void InferenceMetrics::applyServerTimings(const QJsonObject &timings)
+{
+    if (timings.isEmpty()) {
+        return;
+    }
+
+    promptTokens = timings.value("prompt_n").toInt(promptTokens);
+    promptEvalMs = timings.value("prompt_ms").toDouble(promptEvalMs);
+    promptTokensPerSec = timings.value("prompt_per_second").toDouble(promptTokensPerSec);
+    generatedTokens = timings.value("predicted_n").toInt(generatedTokens);
+    generationMs = timings.value("predicted_ms").toDouble(generationMs);
+    generationTokensPerSec = timings.value("predicted_per_second").toDouble(generationTokensPerSec);
+    draftTokens = timings.value("draft_n").toInt(draftTokens);
+    draftAccepted = timings.value("draft_n_accepted").toInt(draftAccepted);
+}
+
+double InferenceMetrics::draftAcceptanceRate() const
+{
+    return draftTokens > 0 && draftAccepted >= 0 ? double(draftAccepted) / draftTokens : -1;
+}
+
+bool InferenceMetrics::applyCliTimings(const QString &stderrText)
+{
+    // Both the older "llama_print_timings:" and newer "llama_perf_context_print:" forms:
+    //   prompt eval time =  234.56 ms /  45 tokens (  5.21 ms per token,  191.85 tokens per second)
+    static const QRegularExpression timing(
+        ":\\s+(load|prompt eval|eval) time\\s*=\\s*([\\d.]+) ms"
+        "(?:\\s*/\\s*(\\d+) (?:tokens|runs))?");
+
+    bool found = false;
+    QRegularExpressionMatchIterator it = timing.globalMatch(stderrText);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        QString stage = match.captured(1);
+        double ms = match.captured(2).toDouble();
+        int tokens = match.captured(3).isEmpty() ? -1 : match.captured(3).toInt();
+        double perSecond = tokens > 0 && ms > 0 ? tokens * 1000.0 / ms : -1;
+
+        if (stage == QLatin1String("load")) {
+            modelLoadMs = ms;
+        } else if (stage == QLatin1String("prompt eval")) {
+            promptEvalMs = ms;
+            promptTokens = tokens;
+            promptTokensPerSec = perSecond;
+        } else {
+            generationMs = ms;
+            generatedTokens = tokens;
+            generationTokensPerSec = perSecond;
+        }
+        found = true;
+    }
+    return found;
+}
+
+QJsonObject InferenceMetrics::toJson() const
+{
+    QJsonObject json;
+    json["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODateWithMs);
+    json["job"] = QString::number(jobId);
+    json["backend"] = backend;
+    json["outcome"] = outcome;
+    json["exit_code"] = exitCode;
+    json["model_load_ms"] = modelLoadMs;
+    json["prompt_eval_ms"] = promptEvalMs;
+    json["prompt_tokens"] = promptTokens;
+    json["prompt_tokens_per_sec"] = promptTokensPerSec;
+    json["generated_tokens"] = generatedTokens;
+    json["generation_ms"] = generationMs;
+    json["generation_tokens_per_sec"] = generationTokensPerSec;
+    json["time_to_first_token_ms"] = timeToFirstTokenMs;
+    json["draft_tokens"] = draftTokens;
+    json["draft_accepted"] = draftAccepted;
+    json["total_ms"] = totalMs;
+    return json;
+}
+
+QString InferenceMetrics::summary() const
+{
+    QStringList parts;
+    if (modelLoadMs > 0) {
+        parts << QString("load %1 ms").arg(qRound(modelLoadMs));
+    }
+    if (timeToFirstTokenMs >= 0) {
+        parts << QString("first token %1 ms").arg(timeToFirstTokenMs);
+    }
+    if (promptTokensPerSec > 0) {
+        parts << QString("prompt %1 tok/s").arg(promptTokensPerSec, 0, 'f', 1);
+    }
+    if (generationTokensPerSec > 0) {
+        parts << QString("generation %1 tok/s").arg(generationTokensPerSec, 0, 'f', 1);
+    }
+    if (draftAcceptanceRate() >= 0) {
+        parts << QString("draft acceptance %1%").arg(100.0 * draftAcceptanceRate(), 0, 'f', 0);
+    }
+    parts << QString("total %1 ms").arg(totalMs);
+
+    return QString("%1 %2: %3").arg(backend, outcome, parts.join(", "));
+}
+
+InferenceMetricsLog::InferenceMetricsLog(const QString &path, qint64 maxBytes)
+    : m_path(path)
+    , m_maxBytes(maxBytes)
+{
+    QFileInfo(m_path).dir().mkpath(".");
+}
+
+void InferenceMetricsLog::append(const InferenceMetrics &metrics)
+{
+    if (QFileInfo(m_path).size() >= m_maxBytes) {
+        QString backup = m_path + ".1";
+        QFile::remove(backup);
+        QFile::rename(m_path, backup);
+    }
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        Logger::instance().warning("Failed to write inference metrics: " + file.errorString());
+        return;
+    }
+    file.write(QJsonDocument(metrics.toJson()).toJson(QJsonDocument::Compact));
+    file.write("\n");
+}
+
+} // namespace Burma
@@ -0,0 +1,124 @@
+#include "modules/ResponseCache.h"
+#include "utils/Logger.h"
+
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+namespace Burma {
+
+ResponseCache::ResponseCache(const QString &directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+    , m_totalBytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+    QDir dir(m_directory);
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+
+    const QFileInfoList entries = dir.entryInfoList({"*.json"}, QDir::Files);
+    for (const QFileInfo &entry : entries) {
+        m_totalBytes += entry.size();
+    }
+
+    evict();
+}
+
+QString ResponseCache::makeKey(const QStringList &parts)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for (const QString &part : parts) {
+        hash.addData(part.toUtf8());
+        hash.addData(QByteArrayView("\0", 1));  // Separator so parts can't run together
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString ResponseCache::entryPath(const QString &key) const
+{
+    return QDir(m_directory).filePath(key + ".json");
+}
+
+bool ResponseCache::lookup(const QString &key, QJsonObject *plan)
+{
+    QFile file(entryPath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        ++m_misses;
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        file.close();
+        file.remove();
+        ++m_misses;
+        return false;
+    }
+
+    // Touch the entry so it counts as recently used
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    file.close();
+
+    *plan = doc.object();
+    ++m_hits;
+    return true;
+}
+
+void ResponseCache::store(const QString &key, const QJsonObject &plan)
+{
+    QString path = entryPath(key);
+    qint64 previousSize = QFileInfo(path).size();
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        Logger::instance().warning("Failed to write response cache entry: " + file.errorString());
+        return;
+    }
+
+    QByteArray data = QJsonDocument(plan).toJson(QJsonDocument::Compact);
+    file.write(data);
+    file.close();
+
+    m_totalBytes += data.size() - previousSize;
+    evict();
+}
+
+void ResponseCache::setMaxBytes(qint64 maxBytes)
+{
+    m_maxBytes = maxBytes;
+    evict();
+}
+
+void ResponseCache::evict()
+{
+    if (m_totalBytes <= m_maxBytes) {
+        return;
+    }
+
+    // Least recently used first
+    QDir dir(m_directory);
+    const QFileInfoList entries = dir.entryInfoList({"*.json"}, QDir::Files,
+                                                    QDir::Time | QDir::Reversed);
+    int evicted = 0;
+    for (const QFileInfo &entry : entries) {
+        if (m_totalBytes <= m_maxBytes) {
+            break;
+        }
+        if (QFile::remove(entry.filePath())) {
+            m_totalBytes -= entry.size();
+            ++evicted;
+        }
+    }
+
+    if (evicted > 0) {
+        Logger::instance().debug(QString("Response cache evicted %1 entries").arg(evicted));
+    }
+}
+
+} // namespace Burma
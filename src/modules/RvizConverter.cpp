@@ -1,12 +1,13 @@
 #include "modules/RvizConverter.h"
+#include "core/Scene.h"
 #include "utils/Logger.h"
 
 #include <QFile>
 #include <QTextStream>
-#include <QFileInfo>
 #include <QDir>
 #include <QImage>
 #include <QPainter>
+#include <QTransform>
 
 namespace Burma {
 
@@ -15,10 +16,11 @@ RvizConverter::RvizConverter(QObject *parent)
 {
 }
 
-void RvizConverter::convertWorld(const QString &worldFile, const QString &outputDir,
+void RvizConverter::convertWorld(const Scene &scene, const QString &outputDir, const QString &baseName,
                                 double resolution, int width, int height)
 {
-    Logger::instance().info("Converting world to RViz format: " + worldFile);
+    Logger::instance().info(QString("Converting world to RViz format: %1 (%2 models)")
+                                .arg(baseName).arg(scene.size()));
 
     // Ensure output directory exists
     QDir dir(outputDir);
@@ -26,14 +28,13 @@ void RvizConverter::convertWorld(const QString &worldFile, const QString &output
         dir.mkpath(".");
     }
 
-    QString baseName = QFileInfo(worldFile).completeBaseName();
     QString pgmFile = dir.filePath(baseName + ".pgm");
     QString yamlFile = dir.filePath(baseName + ".yaml");
 
     emit conversionProgress(10);
 
     // Generate occupancy grid image
-    if (!generateOccupancyGrid(worldFile, pgmFile, resolution, width, height)) {
+    if (!generateOccupancyGrid(scene, pgmFile, resolution, width, height)) {
         emit conversionError("Failed to generate occupancy grid");
         return;
     }
@@ -52,28 +53,50 @@ void RvizConverter::convertWorld(const QString &worldFile, const QString &output
     Logger::instance().info("RViz conversion complete");
 }
 
-bool RvizConverter::generateOccupancyGrid(const QString &worldFile, const QString &pgmFile,
+bool RvizConverter::generateOccupancyGrid(const Scene &scene, const QString &pgmFile,
                                          double resolution, int width, int height)
 {
     Logger::instance().info("Generating occupancy grid image...");
 
-    // TODO: Implement actual world parsing and occupancy grid generation
-    // For now, create a simple placeholder image
-
     QImage image(width, height, QImage::Format_Grayscale8);
     image.fill(Qt::white);  // Free space
 
     QPainter painter(&image);
-
-    // Draw some example obstacles (this would be replaced with actual world parsing)
+    painter.setPen(Qt::NoPen);
     painter.setBrush(Qt::black);  // Occupied space
 
-    // Example: draw some rectangles representing obstacles
-    painter.drawRect(100, 100, 200, 50);
-    painter.drawRect(400, 300, 100, 150);
-    painter.drawRect(700, 500, 300, 100);
+    // World metres to pixels: the origin is the image centre and +y points up
+    QTransform toImage = QTransform().scale(1.0 / resolution, -1.0 / resolution)
+                         * QTransform::fromTranslate(width / 2.0, height / 2.0);
+
+    int drawn = 0;
+    for (int i = 0; i < scene.size(); ++i) {
+        const Scene::Vec3 &position = scene.position(i);
+        const Scene::Vec3 &scale = scene.scale(i);
+
+        // Footprint in the model's frame, turned by its yaw
+        QTransform modelToImage = QTransform().rotateRadians(scene.rotation(i).z)
+                                  * QTransform::fromTranslate(position.x, position.y) * toImage;
+        painter.setTransform(modelToImage);
+
+        switch (scene.geometry(i)) {
+        case Scene::Geometry::Box:
+            painter.drawRect(QRectF(-scale.x / 2.0, -scale.y / 2.0, scale.x, scale.y));
+            break;
+        case Scene::Geometry::Sphere:
+        case Scene::Geometry::Cylinder:
+            painter.drawEllipse(QPointF(0.0, 0.0), scale.x, scale.x);
+            break;
+        case Scene::Geometry::Mesh:
+            continue;  // Bounds unknown without loading the mesh
+        case Scene::Geometry::Unknown:
+            continue;  // No shape in the SDF either
+        }
+        ++drawn;
+    }
 
     painter.end();
+    Logger::instance().info(QString("Marked %1 model footprints as occupied").arg(drawn));
 
     // Save as PGM
     if (!image.save(pgmFile, "PGM")) {
@@ -1,295 +1,437 @@
 #include "modules/SDFBuilder.h"
+#include "modules/SDFWriter.h"
+#include "modules/WorldStore.h"
 #include "utils/Logger.h"
 
 #include <QFile>
 #include <QTextStream>
 #include <QFileInfo>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
 
 namespace Burma {
 
 SDFBuilder::SDFBuilder(QObject *parent)
     : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_jobs(new QThreadPool(this))
+    , m_instancing(true)
+    , m_storeRequests(0)
+    , m_sceneRequests(0)
+    , m_store(nullptr)
 {
+    QDir cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    m_store = new WorldStore(cacheDir.filePath("worlds"), kDefaultStoreBytes);
+
+    m_pool->setMaxThreadCount(QThread::idealThreadCount());
+
+    // One at a time, so a later write of a file can't be overtaken
+    m_jobs->setMaxThreadCount(1);
 }
 
-QString SDFBuilder::buildWorldSDF(const QJsonObject &worldPlan)
+SDFBuilder::~SDFBuilder()
 {
-    Logger::instance().info("Building SDF world from plan...");
+    // Background writes still use this builder and its pool
+    m_jobs->waitForDone();
+    m_pool->waitForDone();
+    delete m_store;
+}
 
+QString SDFBuilder::buildWorldSDF(const QJsonObject &worldPlan)
+{
     if (worldPlan.isEmpty()) {
         Logger::instance().error("Empty world plan provided");
         emit buildError("Empty world plan");
         return QString();
     }
 
-    QString worldName = worldPlan.value("world_name").toString("generated_world");
-    QJsonObject physics = worldPlan.value("physics").toObject();
-    QJsonArray lights = worldPlan.value("lighting").toArray();
-    QJsonArray models = worldPlan.value("models").toArray();
-
-    QString sdf;
-    QTextStream stream(&sdf);
-
-    // XML header
-    stream << "<?xml version=\"1.0\" ?>\n";
-
-    // World header
-    stream << generateWorldHeader(worldName);
+    return buildWorldSDF(Scene::fromPlan(worldPlan, threadCount() > 1 ? m_pool : nullptr));
+}
 
-    // Physics
-    stream << generatePhysicsSection(physics);
+quint64 SDFBuilder::buildSceneAsync(const QJsonObject &worldPlan)
+{
+    // Layout generators can add up to a million models, far too many to
+    // build on the GUI thread. The scene is handed over on the builder's
+    // thread, as Scene has no metatype for a queued signal.
+    quint64 requestId = ++m_sceneRequests;
+    m_jobs->start([this, worldPlan, requestId]() {
+        Scene scene = Scene::fromPlan(worldPlan, threadCount() > 1 ? m_pool : nullptr);
+        QMetaObject::invokeMethod(this, [this, requestId, scene]() {
+            emit sceneBuilt(requestId, scene);
+        }, Qt::QueuedConnection);
+    });
+    return requestId;
+}
 
-    // Lighting
-    stream << generateLightingSection(lights);
+QString SDFBuilder::buildWorldSDF(const Scene &scene)
+{
+    return QString::fromUtf8(buildWorldUtf8(scene));
+}
 
-    // Models
-    stream << generateModelsSection(models);
+QByteArray SDFBuilder::buildWorldUtf8(const Scene &scene)
+{
+    Logger::instance().info("Building SDF world from plan...");
 
-    // Close world tag
-    stream << "</world>\n";
-    stream << "</sdf>\n";
+    QByteArray sdf;
+    sdf.reserve(SDFWriter::estimateSize(scene));
+    SDFWriter writer(&sdf);
+    writer.writeWorld(scene, threadCount() > 1 ? m_pool : nullptr);
 
     Logger::instance().info("SDF world generated successfully");
     return sdf;
 }
 
-bool SDFBuilder::saveToFile(const QString &sdfContent, const QString &filePath)
+bool SDFBuilder::writeWorld(const Scene &scene, const QString &filePath)
 {
-    Logger::instance().info("Saving SDF to: " + filePath);
+    Logger::instance().info(QString("Writing SDF world with %1 models to: %2")
+                                .arg(scene.size()).arg(filePath));
 
-    // Ensure directory exists
-    QFileInfo fileInfo(filePath);
-    QDir dir = fileInfo.dir();
-    if (!dir.exists()) {
-        dir.mkpath(".");
-    }
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
 
     QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
         QString error = "Failed to open file for writing: " + file.errorString();
         Logger::instance().error(error);
         emit buildError(error);
         return false;
     }
 
-    QTextStream out(&file);
-    out << sdfContent;
+    // The writer buffers in 64 KB chunks, so QFile's own buffer is skipped
+    QElapsedTimer timer;
+    timer.start();
+    SDFWriter writer(&file);
+    if (!writer.writeWorld(scene, threadCount() > 1 ? m_pool : nullptr)) {
+        QString error = "Failed to write SDF file: " + file.errorString();
+        Logger::instance().error(error);
+        emit buildError(error);
+        return false;
+    }
     file.close();
 
-    Logger::instance().info("SDF saved successfully");
+    Logger::instance().info(QString("SDF saved successfully (%1 bytes in %2 ms, %3 threads)")
+                                .arg(writer.bytesWritten())
+                                .arg(timer.elapsed())
+                                .arg(threadCount()));
     emit buildComplete(filePath);
     return true;
 }
 
-QString SDFBuilder::buildModelSDF(const QJsonObject &modelData)
+bool SDFBuilder::updateWorld(const Scene &scene, const QString &filePath)
 {
-    return generateModelElement(modelData);
+    if (scene.size() > kMaxCachedModels) {
+        // Keeping every model's SDF would cost as much memory as the file
+        QMutexLocker locker(&m_cacheMutex);
+        m_cache.clear();
+        return writeWorld(scene, filePath);
+    }
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    QElapsedTimer timer;
+    timer.start();
+    SDFFragmentCache::Stats stats;
+    QString error;
+    bool ok;
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        ok = m_cache.writeWorld(scene, filePath, threadCount() > 1 ? m_pool : nullptr, &stats, &error);
+    }
+    if (!ok) {
+        Logger::instance().error(error);
+        emit buildError(error);
+        return false;
+    }
+
+    Logger::instance().info(QString("SDF %1: %2 of %3 models re-emitted, %4 bytes written in %5 ms")
+                                .arg(stats.patchedInPlace ? "patched in place" : "rewritten")
+                                .arg(stats.formatted)
+                                .arg(scene.size())
+                                .arg(stats.bytesWritten)
+                                .arg(timer.elapsed()));
+    emit buildComplete(filePath);
+    return true;
 }
 
-QString SDFBuilder::generateWorldHeader(const QString &worldName)
+bool SDFBuilder::storeWorld(const Scene &scene, QString *filePath)
 {
-    return QString(
-        "<sdf version=\"1.9\">\n"
-        "  <world name=\"%1\">\n"
-    ).arg(escapeXML(worldName));
+    QElapsedTimer timer;
+    timer.start();
+    QThreadPool *pool = threadCount() > 1 ? m_pool : nullptr;
+    bool written = false;
+    QString error;
+    bool ok;
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (scene.size() > kMaxCachedModels) {
+            // Too large to keep each model's SDF; hashed as it is streamed
+            m_cache.clear();
+            ok = m_store->storeStreamed([&](QIODevice *device) {
+                SDFWriter writer(device);
+                return writer.writeWorld(scene, pool);
+            }, filePath, &written, &error);
+        } else {
+            // Models unchanged since the last world keep their SDF, so the
+            // same world again is hashed from memory and writes nothing.
+            // The file last updated no longer matches the cache.
+            m_cache.update(scene, pool);
+            m_cache.forgetFile();
+            auto write = [this](QIODevice *device) { return m_cache.write(device); };
+            ok = m_store->store(WorldStore::hash(write), write, filePath, &written, &error);
+        }
+    }
+    if (!ok) {
+        Logger::instance().error(error);
+        emit buildError(error);
+        return false;
+    }
+
+    Logger::instance().info(QString("SDF world %1: %2 (%3 models in %4 ms)")
+                                .arg(written ? "stored" : "already stored")
+                                .arg(*filePath)
+                                .arg(scene.size())
+                                .arg(timer.elapsed()));
+    return true;
 }
 
-QString SDFBuilder::generatePhysicsSection(const QJsonObject &physicsData)
+quint64 SDFBuilder::storeWorldAsync(const Scene &scene)
 {
-    QString gravity = physicsData.value("gravity").toString("0 0 -9.81");
-    double maxStepSize = physicsData.value("max_step_size").toDouble(0.001);
-    double realTimeFactor = physicsData.value("real_time_factor").toDouble(1.0);
-
-    return QString(
-        "    <physics type=\"ode\">\n"
-        "      <max_step_size>%1</max_step_size>\n"
-        "      <real_time_factor>%2</real_time_factor>\n"
-        "      <gravity>%3</gravity>\n"
-        "    </physics>\n"
-    ).arg(maxStepSize).arg(realTimeFactor).arg(gravity);
+    quint64 requestId = ++m_storeRequests;
+    m_jobs->start([this, scene, requestId]() {
+        QString filePath;
+        if (storeWorld(scene, &filePath)) {
+            emit worldStored(requestId, filePath);
+        }
+    });
+    return requestId;
 }
 
-QString SDFBuilder::generateLightingSection(const QJsonArray &lights)
+void SDFBuilder::setStoreLimit(qint64 maxBytes)
 {
-    QString result;
-
-    if (lights.isEmpty()) {
-        // Add default sun light
-        result += "    <light type=\"directional\" name=\"sun\">\n"
-                 "      <pose>0 0 10 0 0 0</pose>\n"
-                 "      <diffuse>1 1 1 1</diffuse>\n"
-                 "      <specular>0.5 0.5 0.5 1</specular>\n"
-                 "      <direction>-0.5 0.1 -0.9</direction>\n"
-                 "    </light>\n";
-    } else {
-        for (const QJsonValue &lightVal : lights) {
-            QJsonObject light = lightVal.toObject();
-            QString name = light.value("name").toString("light");
-            QString type = light.value("type").toString("directional");
-
-            result += QString("    <light type=\"%1\" name=\"%2\">\n").arg(type, name);
-
-            QJsonObject pos = light.value("position").toObject();
-            result += QString("      <pose>%1 %2 %3 0 0 0</pose>\n")
-                .arg(pos.value("x").toDouble(0))
-                .arg(pos.value("y").toDouble(0))
-                .arg(pos.value("z").toDouble(10));
-
-            QString diffuse = light.value("diffuse").toString("1 1 1 1");
-            result += QString("      <diffuse>%1</diffuse>\n").arg(diffuse);
-
-            result += "    </light>\n";
-        }
-    }
+    QMutexLocker locker(&m_cacheMutex);
+    m_store->setMaxBytes(maxBytes);
+}
 
-    return result;
+QString SDFBuilder::workingWorldPath() const
+{
+    return m_store->workingPath();
 }
 
-QString SDFBuilder::generateModelsSection(const QJsonArray &models)
+bool SDFBuilder::writeInstancedWorld(const Scene &scene, const QString &filePath, InstancingStats *stats)
 {
-    QString result;
+    Logger::instance().info(QString("Writing instanced SDF world with %1 models to: %2")
+                                .arg(scene.size()).arg(filePath));
 
-    for (const QJsonValue &modelVal : models) {
-        QJsonObject model = modelVal.toObject();
-        result += generateModelElement(model);
+    InstancingStats localStats;
+    if (!stats) {
+        stats = &localStats;
+    }
+    *stats = InstancingStats();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Group the models by body, in order of first use
+    QList<int> bodyOf(scene.size(), -1);
+    QList<int> firstModel;
+    QList<int> uses;
+    QHash<size_t, int> bodyByHash;
+    for (int i = 0; i < scene.size(); ++i) {
+        size_t hash = scene.bodyHash(i);
+        auto it = bodyByHash.constFind(hash);
+        if (it == bodyByHash.constEnd()) {
+            bodyOf[i] = int(firstModel.size());
+            bodyByHash.insert(hash, bodyOf[i]);
+            firstModel.append(i);
+            uses.append(1);
+        } else if (scene.sameBody(i, firstModel.at(*it))) {
+            bodyOf[i] = *it;
+            ++uses[*it];
+        }
+        // Otherwise two bodies share a hash; this model is written in full
     }
 
-    return result;
-}
+    QFileInfo worldInfo(filePath);
+    QDir worldDir = worldInfo.absoluteDir();
+    QString modelsDirName = worldInfo.completeBaseName() + "_models";
+    worldDir.mkpath(".");
 
-QString SDFBuilder::generateModelElement(const QJsonObject &model)
-{
-    QString name = model.value("name").toString("unnamed_model");
-    QString type = model.value("type").toString("box");
-    bool isStatic = model.value("static").toBool(false);
+    // Bodies are written to a staging directory that replaces the old one
+    // once the world file is written, so those of an earlier write that are
+    // no longer used don't pile up
+    QString modelsPath = worldDir.filePath(modelsDirName);
+    QDir stagingDir(modelsPath + ".tmp");
+    stagingDir.removeRecursively();
 
-    QString result = QString("    <model name=\"%1\">\n").arg(escapeXML(name));
+    auto fail = [this, &stagingDir](const QString &error) {
+        stagingDir.removeRecursively();
+        Logger::instance().error(error);
+        emit buildError(error);
+        return false;
+    };
 
-    if (isStatic) {
-        result += "      <static>true</static>\n";
-    }
+    // Shared bodies, each a model directory
+    QList<QString> uris(firstModel.size());
+    for (int body = 0; body < firstModel.size(); ++body) {
+        if (uses.at(body) < kMinInstances) {
+            continue;
+        }
+        int model = firstModel.at(body);
+        QString name = QString("%1_%2").arg(Scene::geometryName(scene.geometry(model))).arg(stats->bodies);
+        QString dirPath = stagingDir.filePath(name);
+        if (!QDir().mkpath(dirPath)) {
+            return fail("Failed to create model directory: " + dirPath);
+        }
 
-    // Pose
-    QJsonObject position = model.value("position").toObject();
-    QJsonObject rotation = model.value("rotation").toObject();
-    result += generatePoseElement(position, rotation);
+        qint64 bodyBytes = 0;
+        for (bool config : {false, true}) {
+            QFile file(dirPath + (config ? "/model.config" : "/model.sdf"));
+            if (!file.open(QIODevice::WriteOnly)) {
+                return fail("Failed to open file for writing: " + file.errorString());
+            }
+            SDFWriter writer(&file);
+            if (config) {
+                writer.writeModelConfig(name);
+            } else {
+                writer.writeBody(scene, model, name);
+            }
+            if (!writer.flush()) {
+                return fail("Failed to write SDF file: " + file.errorString());
+            }
+            bodyBytes += writer.bytesWritten();
+        }
 
-    // Link
-    result += "      <link name=\"link\">\n";
+        // Name, static flag and pose are the same text in a model and an
+        // include, so each instance saves the same bytes as the first
+        QByteArray full;
+        QByteArray include;
+        {
+            SDFWriter fullWriter(&full);
+            fullWriter.writeModel(scene, model);
+            SDFWriter includeWriter(&include);
+            includeWriter.writeInclude(scene, model, modelsDirName + "/" + name);
+        }
 
-    // Visual
-    result += generateVisualElement(model);
+        uris[body] = modelsDirName + "/" + name;
+        ++stats->bodies;
+        stats->instances += uses.at(body);
+        stats->bytesWritten += bodyBytes;
+        stats->bytesSaved += qint64(uses.at(body)) * (full.size() - include.size()) - bodyBytes;
+    }
 
-    // Collision
-    result += generateCollisionElement(model);
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        return fail("Failed to open file for writing: " + file.errorString());
+    }
 
-    result += "      </link>\n";
-    result += "    </model>\n";
+    SDFWriter writer(&file);
+    writer.writeHeader(scene);
+    for (int i = 0; i < scene.size(); ++i) {
+        if (bodyOf.at(i) >= 0 && !uris.at(bodyOf.at(i)).isEmpty()) {
+            writer.writeInclude(scene, i, uris.at(bodyOf.at(i)));
+        } else {
+            writer.writeModel(scene, i);
+        }
+    }
+    writer.writeFooter();
+    if (!writer.flush()) {
+        return fail("Failed to write SDF file: " + file.errorString());
+    }
+    file.close();
+    stats->bytesWritten += writer.bytesWritten();
+
+    QDir oldModels(modelsPath);
+    if (oldModels.exists() && !oldModels.removeRecursively()) {
+        return fail("Failed to remove old model directory: " + modelsPath);
+    }
+    if (stats->bodies > 0 && !worldDir.rename(stagingDir.path(), modelsPath)) {
+        return fail("Failed to move model directory into place: " + modelsPath);
+    }
 
-    return result;
+    Logger::instance().info(QString("SDF saved with %1 shared bodies for %2 models: %3 bytes, "
+                                    "%4 bytes saved (%5 ms)")
+                                .arg(stats->bodies)
+                                .arg(stats->instances)
+                                .arg(stats->bytesWritten)
+                                .arg(stats->bytesSaved)
+                                .arg(timer.elapsed()));
+    emit buildComplete(filePath);
+    return true;
 }
 
-QString SDFBuilder::generatePoseElement(const QJsonObject &position, const QJsonObject &rotation)
+void SDFBuilder::saveWorldAsync(const Scene &scene, const QString &filePath)
 {
-    double x = position.value("x").toDouble(0);
-    double y = position.value("y").toDouble(0);
-    double z = position.value("z").toDouble(0);
-
-    double roll = rotation.value("roll").toDouble(0);
-    double pitch = rotation.value("pitch").toDouble(0);
-    double yaw = rotation.value("yaw").toDouble(0);
-
-    return QString("      <pose>%1 %2 %3 %4 %5 %6</pose>\n")
-        .arg(x).arg(y).arg(z).arg(roll).arg(pitch).arg(yaw);
+    bool instanced = m_instancing;
+    m_jobs->start([this, scene, filePath, instanced]() {
+        if (instanced) {
+            writeInstancedWorld(scene, filePath);
+        } else {
+            writeWorld(scene, filePath);
+        }
+    });
 }
 
-QString SDFBuilder::generateScaleElement(const QJsonObject &scale)
+void SDFBuilder::writeWorldAsync(const Scene &scene, const QString &filePath)
 {
-    double x = scale.value("x").toDouble(1);
-    double y = scale.value("y").toDouble(1);
-    double z = scale.value("z").toDouble(1);
+    // Tens of thousands of models take long enough to freeze the window;
+    // the signals are queued back to the builder's thread
+    m_jobs->start([this, scene, filePath]() {
+        updateWorld(scene, filePath);
+    });
+}
 
-    return QString("          <scale>%1 %2 %3</scale>\n").arg(x).arg(y).arg(z);
+int SDFBuilder::threadCount() const
+{
+    return m_pool->maxThreadCount();
 }
 
-QString SDFBuilder::generateVisualElement(const QJsonObject &model)
+void SDFBuilder::setThreadCount(int count)
 {
-    QString type = model.value("type").toString("box");
-    QJsonObject scale = model.value("scale").toObject();
-    QString color = model.value("color").toString("#FFFFFF");
-
-    QString result = "        <visual name=\"visual\">\n";
-    result += "          <geometry>\n";
-
-    if (type == "box") {
-        double sx = scale.value("x").toDouble(1);
-        double sy = scale.value("y").toDouble(1);
-        double sz = scale.value("z").toDouble(1);
-        result += QString("            <box><size>%1 %2 %3</size></box>\n").arg(sx).arg(sy).arg(sz);
-    } else if (type == "sphere") {
-        double radius = scale.value("x").toDouble(0.5);
-        result += QString("            <sphere><radius>%1</radius></sphere>\n").arg(radius);
-    } else if (type == "cylinder") {
-        double radius = scale.value("x").toDouble(0.5);
-        double length = scale.value("z").toDouble(1.0);
-        result += QString("            <cylinder><radius>%1</radius><length>%2</length></cylinder>\n")
-            .arg(radius).arg(length);
-    }
+    m_pool->setMaxThreadCount(qMax(1, count));
+}
 
-    result += "          </geometry>\n";
+bool SDFBuilder::saveToFile(const QString &sdfContent, const QString &filePath)
+{
+    Logger::instance().info("Saving SDF to: " + filePath);
 
-    // Material/Color
-    if (!color.isEmpty()) {
-        result += "          <material>\n";
-        result += QString("            <ambient>%1</ambient>\n").arg(color);
-        result += QString("            <diffuse>%1</diffuse>\n").arg(color);
-        result += "          </material>\n";
+    // Ensure directory exists
+    QFileInfo fileInfo(filePath);
+    QDir dir = fileInfo.dir();
+    if (!dir.exists()) {
+        dir.mkpath(".");
     }
 
-    result += "        </visual>\n";
-
-    return result;
-}
-
-QString SDFBuilder::generateCollisionElement(const QJsonObject &model)
-{
-    QString type = model.value("type").toString("box");
-    QJsonObject scale = model.value("scale").toObject();
-
-    QString result = "        <collision name=\"collision\">\n";
-    result += "          <geometry>\n";
-
-    if (type == "box") {
-        double sx = scale.value("x").toDouble(1);
-        double sy = scale.value("y").toDouble(1);
-        double sz = scale.value("z").toDouble(1);
-        result += QString("            <box><size>%1 %2 %3</size></box>\n").arg(sx).arg(sy).arg(sz);
-    } else if (type == "sphere") {
-        double radius = scale.value("x").toDouble(0.5);
-        result += QString("            <sphere><radius>%1</radius></sphere>\n").arg(radius);
-    } else if (type == "cylinder") {
-        double radius = scale.value("x").toDouble(0.5);
-        double length = scale.value("z").toDouble(1.0);
-        result += QString("            <cylinder><radius>%1</radius><length>%2</length></cylinder>\n")
-            .arg(radius).arg(length);
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QString error = "Failed to open file for writing: " + file.errorString();
+        Logger::instance().error(error);
+        emit buildError(error);
+        return false;
     }
 
-    result += "          </geometry>\n";
-    result += "        </collision>\n";
+    QTextStream out(&file);
+    out << sdfContent;
+    file.close();
 
-    return result;
+    Logger::instance().info("SDF saved successfully");
+    emit buildComplete(filePath);
+    return true;
 }
 
-QString SDFBuilder::escapeXML(const QString &text)
+QString SDFBuilder::buildModelSDF(const QJsonObject &modelData)
 {
-    QString escaped = text;
-    escaped.replace("&", "&amp;");
-    escaped.replace("<", "&lt;");
-    escaped.replace(">", "&gt;");
-    escaped.replace("\"", "&quot;");
-    escaped.replace("'", "&apos;");
-    return escaped;
+    // A model with a repeat directive yields all of its copies
+    Scene scene = Scene::fromModels(QJsonArray{modelData});
+    QByteArray sdf;
+    SDFWriter writer(&sdf);
+    for (int i = 0; i < scene.size(); ++i) {
+        writer.writeModel(scene, i);
+    }
+    writer.flush();
+    return QString::fromUtf8(sdf);
 }
 
 } // namespace Burma
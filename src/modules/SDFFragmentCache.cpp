@@ -0,0 +1,250 @@
+#include "modules/SDFFragmentCache.h"
+#include "modules/SDFWriter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSemaphore>
+#include <QThreadPool>
+
+namespace Burma {
+
+void SDFFragmentCache::update(const Scene &scene, QThreadPool *pool, Stats *stats)
+{
+    Stats localStats;
+    if (!stats) {
+        stats = &localStats;
+    }
+    *stats = Stats();
+
+    QByteArray header;
+    {
+        SDFWriter writer(&header);
+        writer.writeHeader(scene);
+    }
+    bool sameLayout = header == m_header && scene.size() == m_fragments.size();
+
+    QList<Fragment> fragments(scene.size());
+    QList<int> occurrences;   // By name ID
+    QList<int> dirty;
+    for (int i = 0; i < scene.size(); ++i) {
+        Fragment &fragment = fragments[i];
+        quint32 nameId = scene.nameId(i);
+        if (nameId >= quint32(occurrences.size())) {
+            occurrences.resize(nameId + 1);
+        }
+        fragment.key = Key(scene.name(i), occurrences[nameId]++);
+        fragment.hash = scene.modelHash(i);
+
+        // Usually the model is where it was last time
+        int previous = i;
+        if (i >= m_fragments.size() || m_fragments.at(i).key != fragment.key) {
+            previous = m_index.value(fragment.key, -1);
+            sameLayout = false;
+        }
+        if (previous >= 0) {
+            const Fragment &old = m_fragments.at(previous);
+            fragment.offset = old.offset;
+            fragment.slot = old.slot;
+            if (old.hash == fragment.hash) {
+                fragment.sdf = old.sdf;
+                continue;
+            }
+        }
+        dirty.append(i);
+    }
+
+    m_fragments = std::move(fragments);
+    m_header = header;
+    m_sameLayout = sameLayout;
+    m_dirty = std::move(dirty);
+    formatFragments(scene, pool);
+    stats->formatted = int(m_dirty.size());
+    stats->reused = scene.size() - stats->formatted;
+
+    if (!sameLayout) {
+        m_index.clear();
+        m_index.reserve(m_fragments.size());
+        for (int i = 0; i < m_fragments.size(); ++i) {
+            m_index.insert(m_fragments.at(i).key, i);
+        }
+    }
+}
+
+bool SDFFragmentCache::write(QIODevice *device) const
+{
+    QByteArray footer;
+    {
+        SDFWriter writer(&footer);
+        writer.writeFooter();
+    }
+
+    bool ok = device->write(m_header) == m_header.size();
+    for (const Fragment &fragment : m_fragments) {
+        if (!ok) {
+            break;
+        }
+        ok = device->write(fragment.sdf) == fragment.sdf.size();
+    }
+    return ok && device->write(footer) == footer.size();
+}
+
+bool SDFFragmentCache::writeWorld(const Scene &scene, const QString &filePath, QThreadPool *pool,
+                                  Stats *stats, QString *error)
+{
+    Stats localStats;
+    if (!stats) {
+        stats = &localStats;
+    }
+
+    // Patching in place needs the file as it was left, with the same header
+    // and the same models in the same order
+    QFileInfo fileInfo(filePath);
+    bool sameFile = filePath == m_filePath && fileInfo.size() == m_fileSize
+                    && fileInfo.lastModified() == m_fileModified;
+    update(scene, pool, stats);
+
+    bool fits = sameFile && m_sameLayout;
+    for (int i : m_dirty) {
+        if (!fits) {
+            break;
+        }
+        fits = m_fragments.at(i).sdf.size() <= m_fragments.at(i).slot;
+    }
+
+    bool ok = fits ? patchFile(filePath, stats, error) : rewriteFile(filePath, stats, error);
+    if (!ok) {
+        // The file is in an unknown state; start over next time
+        clear();
+        return false;
+    }
+
+    m_filePath = filePath;
+    m_fileModified = QFileInfo(filePath).lastModified();
+    return true;
+}
+
+void SDFFragmentCache::forgetFile()
+{
+    m_filePath.clear();
+    m_fileSize = 0;
+    m_fileModified = QDateTime();
+}
+
+void SDFFragmentCache::clear()
+{
+    forgetFile();
+    m_header.clear();
+    m_fragments.clear();
+    m_index.clear();
+    m_sameLayout = false;
+    m_dirty.clear();
+}
+
+void SDFFragmentCache::formatFragments(const Scene &scene, QThreadPool *pool)
+{
+    const QList<int> &dirty = m_dirty;
+    Fragment *fragments = m_fragments.data();
+    auto format = [&](qsizetype first, qsizetype last) {
+        // One writer per run: each model is flushed into its own array,
+        // which is then handed to the fragment
+        QByteArray sdf;
+        SDFWriter writer(&sdf);
+        for (qsizetype k = first; k < last; ++k) {
+            writer.writeModel(scene, dirty.at(k));
+            writer.flush();
+            fragments[dirty.at(k)].sdf = std::move(sdf);
+            sdf = QByteArray();
+        }
+    };
+
+    if (!pool || dirty.size() <= SDFWriter::kModelsPerTask) {
+        format(0, dirty.size());
+        return;
+    }
+
+    // A whole world's worth of models, e.g. the first write
+    int taskCount = int((dirty.size() + SDFWriter::kModelsPerTask - 1) / SDFWriter::kModelsPerTask);
+    QSemaphore done;
+    for (int task = 0; task < taskCount; ++task) {
+        qsizetype first = qsizetype(task) * SDFWriter::kModelsPerTask;
+        qsizetype last = qMin(first + SDFWriter::kModelsPerTask, dirty.size());
+        pool->start([&, first, last]() {
+            format(first, last);
+            done.release();
+        });
+    }
+    done.acquire(taskCount);
+}
+
+bool SDFFragmentCache::patchFile(const QString &filePath, Stats *stats, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        if (error) {
+            *error = "Failed to open file for writing: " + file.errorString();
+        }
+        return false;
+    }
+
+    for (int i : m_dirty) {
+        const Fragment &fragment = m_fragments.at(i);
+        QByteArray bytes = fragment.sdf;
+        if (bytes.size() < fragment.slot) {
+            // Whitespace between elements; the closing newline stays last
+            bytes.chop(1);
+            bytes.append(fragment.slot - fragment.sdf.size(), ' ');
+            bytes.append('\n');
+        }
+        if (!file.seek(fragment.offset) || file.write(bytes) != bytes.size()) {
+            if (error) {
+                *error = "Failed to write SDF file: " + file.errorString();
+            }
+            return false;
+        }
+        stats->bytesWritten += bytes.size();
+    }
+    file.close();
+    if (file.error() != QFileDevice::NoError) {
+        if (error) {
+            *error = "Failed to write SDF file: " + file.errorString();
+        }
+        return false;
+    }
+
+    stats->patchedInPlace = true;
+    return true;
+}
+
+bool SDFFragmentCache::rewriteFile(const QString &filePath, Stats *stats, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) {
+            *error = "Failed to open file for writing: " + file.errorString();
+        }
+        return false;
+    }
+
+    qint64 offset = m_header.size();
+    for (Fragment &fragment : m_fragments) {
+        fragment.offset = offset;
+        fragment.slot = fragment.sdf.size();
+        offset += fragment.slot;
+    }
+    bool ok = write(&file);
+    qint64 size = file.pos();
+    file.close();
+
+    if (!ok || file.error() != QFileDevice::NoError) {
+        if (error) {
+            *error = "Failed to write SDF file: " + file.errorString();
+        }
+        return false;
+    }
+
+    m_fileSize = size;
+    stats->bytesWritten = size;
+    return true;
+}
+
+} // namespace Burma
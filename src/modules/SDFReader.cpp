@@ -0,0 +1,1097 @@
+#include "modules/SDFReader.h"
+#include "utils/Logger.h"
+
+#include <QByteArrayView>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QtMath>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace Burma {
+
+namespace {
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+template <qsizetype N>
+bool is(QByteArrayView text, const char (&literal)[N])
+{
+    return text.size() == N - 1 && std::memcmp(text.data(), literal, N - 1) == 0;
+}
+
+QByteArrayView trimmed(QByteArrayView text)
+{
+    const char *begin = text.data();
+    const char *end = begin + text.size();
+    while (begin < end && isSpace(*begin)) {
+        ++begin;
+    }
+    while (end > begin && isSpace(end[-1])) {
+        --end;
+    }
+    return QByteArrayView(begin, end - begin);
+}
+
+const char* find(const char *p, const char *end, const char *needle, qsizetype size)
+{
+    while (end - p >= size) {
+        p = static_cast<const char*>(std::memchr(p, needle[0], end - p - size + 1));
+        if (!p) {
+            return nullptr;
+        }
+        if (std::memcmp(p, needle, size) == 0) {
+            return p;
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+// Appends text with the predefined entities and character references decoded
+void appendDecoded(QByteArray &out, QByteArrayView text)
+{
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end) {
+        const char *amp = static_cast<const char*>(std::memchr(p, '&', end - p));
+        if (!amp) {
+            out.append(p, end - p);
+            return;
+        }
+        out.append(p, amp - p);
+
+        const char *semicolon = static_cast<const char*>(std::memchr(amp, ';', std::min<qsizetype>(end - amp, 12)));
+        if (!semicolon) {
+            out.append('&');
+            p = amp + 1;
+            continue;
+        }
+        QByteArrayView entity(amp + 1, semicolon - amp - 1);
+        if (is(entity, "amp")) {
+            out.append('&');
+        } else if (is(entity, "lt")) {
+            out.append('<');
+        } else if (is(entity, "gt")) {
+            out.append('>');
+        } else if (is(entity, "quot")) {
+            out.append('"');
+        } else if (is(entity, "apos")) {
+            out.append('\'');
+        } else if (entity.size() > 1 && entity[0] == '#') {
+            bool hex = entity[1] == 'x' || entity[1] == 'X';
+            const char *digits = entity.data() + (hex ? 2 : 1);
+            uint code = 0;
+            auto result = std::from_chars(digits, semicolon, code, hex ? 16 : 10);
+            if (result.ec == std::errc() && result.ptr == semicolon) {
+                char32_t character = code;
+                out.append(QString::fromUcs4(&character, 1).toUtf8());
+            } else {
+                out.append(amp, semicolon + 1 - amp);
+            }
+        } else {
+            out.append(amp, semicolon + 1 - amp);
+        }
+        p = semicolon + 1;
+    }
+}
+
+// Whitespace-separated numbers into out; returns how many were read
+int parseNumbers(QByteArrayView text, double *out, int max)
+{
+    const char *p = text.data();
+    const char *end = p + text.size();
+    int count = 0;
+    while (count < max) {
+        while (p < end && isSpace(*p)) {
+            ++p;
+        }
+        if (p < end && *p == '+') {
+            ++p;
+        }
+        if (p >= end) {
+            break;
+        }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        auto result = std::from_chars(p, end, out[count]);
+        if (result.ec != std::errc()) {
+            break;
+        }
+        p = result.ptr;
+#else
+        const char *token = p;
+        while (p < end && !isSpace(*p)) {
+            ++p;
+        }
+        bool ok = false;
+        out[count] = QByteArray(token, p - token).toDouble(&ok);
+        if (!ok) {
+            break;
+        }
+#endif
+        ++count;
+    }
+    return count;
+}
+
+bool parseBool(QByteArrayView text)
+{
+    text = trimmed(text);
+    return is(text, "true") || is(text, "1");
+}
+
+// "r g b [a]" in 0..1, or the "#RRGGBB" SDFWriter emits
+bool parseColorText(QByteArrayView text, quint32 *rgb)
+{
+    text = trimmed(text);
+    if (!text.isEmpty() && text[0] == '#') {
+        return Scene::parseColor(QString::fromLatin1(text), rgb);
+    }
+    double channels[4];
+    if (parseNumbers(text, channels, 4) < 3) {
+        return false;
+    }
+    *rgb = 0;
+    for (int i = 0; i < 3; ++i) {
+        *rgb = *rgb << 8 | quint32(qRound(qBound(0.0, channels[i], 1.0) * 255.0));
+    }
+    return true;
+}
+
+/**
+ * Start and end tags of an XML document, with text, comments, processing
+ * instructions and the doctype passed over. Names and attributes are views
+ * into the document.
+ */
+struct Tag {
+    enum Kind { Start, End, EndOfInput, Malformed };
+    Kind kind = EndOfInput;
+    QByteArrayView name;
+    QByteArrayView attributes;  // Raw text between the name and the end of the tag
+    bool selfClosing = false;
+};
+
+class TagScanner
+{
+public:
+    TagScanner(const char *begin, const char *end)
+        : m_begin(begin)
+        , m_p(begin)
+        , m_end(end)
+    {
+    }
+
+    // Stays at a malformed tag, so every later call reports it again
+    Tag next()
+    {
+        Tag tag;
+        for (;;) {
+            const char *lt = static_cast<const char*>(std::memchr(m_p, '<', m_end - m_p));
+            if (!lt) {
+                m_p = m_end;
+                return tag;
+            }
+            m_p = lt;
+            if (m_end - lt < 2) {
+                tag.kind = Tag::Malformed;
+                return tag;
+            }
+            if (lt[1] == '!' || lt[1] == '?') {
+                if (!skipMarkup()) {
+                    tag.kind = Tag::Malformed;
+                    return tag;
+                }
+                continue;
+            }
+
+            const char *gt = tagEnd(lt + 1);
+            const char *nameBegin = lt + (lt[1] == '/' ? 2 : 1);
+            const char *nameEnd = nameBegin;
+            while (gt && nameEnd < gt && !isSpace(*nameEnd) && *nameEnd != '/') {
+                ++nameEnd;
+            }
+            if (!gt || nameEnd == nameBegin) {
+                tag.kind = Tag::Malformed;
+                return tag;
+            }
+
+            tag.name = QByteArrayView(nameBegin, nameEnd - nameBegin);
+            m_p = gt + 1;
+            if (lt[1] == '/') {
+                tag.kind = Tag::End;
+                return tag;
+            }
+            tag.kind = Tag::Start;
+            tag.selfClosing = gt[-1] == '/';
+            const char *attributesEnd = tag.selfClosing ? gt - 1 : gt;
+            tag.attributes = QByteArrayView(nameEnd, std::max<qsizetype>(attributesEnd - nameEnd, 0));
+            return tag;
+        }
+    }
+
+    // Text of the element just started, up to and including its end tag.
+    // Valid until the next call.
+    QByteArrayView text()
+    {
+        // Nearly always plain text straight up to the end tag
+        const char *start = m_p;
+        const char *lt = static_cast<const char*>(std::memchr(m_p, '<', m_end - m_p));
+        if (lt && m_end - lt > 1 && lt[1] == '/' && !std::memchr(start, '&', lt - start)) {
+            skipEndTag(lt);
+            return QByteArrayView(start, lt - start);
+        }
+
+        // Entities, CDATA, comments or child elements
+        m_text.clear();
+        for (;;) {
+            lt = static_cast<const char*>(std::memchr(m_p, '<', m_end - m_p));
+            if (!lt) {
+                appendDecoded(m_text, QByteArrayView(m_p, m_end - m_p));
+                m_p = m_end;
+                break;
+            }
+            appendDecoded(m_text, QByteArrayView(m_p, lt - m_p));
+            m_p = lt;
+            if (m_end - lt > 1 && lt[1] == '/') {
+                skipEndTag(lt);
+                break;
+            }
+            if (m_end - lt >= 9 && std::memcmp(lt, "<![CDATA[", 9) == 0) {
+                const char *cdataEnd = find(lt + 9, m_end, "]]>", 3);
+                if (!cdataEnd) {
+                    m_p = m_end;
+                    break;
+                }
+                m_text.append(lt + 9, cdataEnd - lt - 9);
+                m_p = cdataEnd + 3;
+                continue;
+            }
+            if (m_end - lt > 1 && (lt[1] == '!' || lt[1] == '?')) {
+                if (!skipMarkup()) {
+                    break;
+                }
+                continue;
+            }
+            // An element where text was expected
+            Tag child = next();
+            if (child.kind != Tag::Start) {
+                break;
+            }
+            if (!child.selfClosing) {
+                skip();
+            }
+        }
+        return QByteArrayView(m_text);
+    }
+
+    // Past the end tag of the element just started, by matching tags only
+    void skip()
+    {
+        int depth = 1;
+        while (depth > 0) {
+            Tag tag = next();
+            if (tag.kind == Tag::Start) {
+                if (!tag.selfClosing) {
+                    ++depth;
+                }
+            } else if (tag.kind == Tag::End) {
+                --depth;
+            } else {
+                return;
+            }
+        }
+    }
+
+    // Value of an attribute of tag, or an empty view. Valid until the next
+    // call.
+    QByteArrayView attribute(const Tag &tag, QByteArrayView name)
+    {
+        const char *p = tag.attributes.data();
+        const char *end = p + tag.attributes.size();
+        while (p < end) {
+            while (p < end && isSpace(*p)) {
+                ++p;
+            }
+            const char *nameBegin = p;
+            while (p < end && *p != '=' && !isSpace(*p)) {
+                ++p;
+            }
+            QByteArrayView attributeName(nameBegin, p - nameBegin);
+            while (p < end && isSpace(*p)) {
+                ++p;
+            }
+            if (p >= end || *p != '=') {
+                return {};
+            }
+            ++p;
+            while (p < end && isSpace(*p)) {
+                ++p;
+            }
+            if (p >= end || (*p != '"' && *p != '\'')) {
+                return {};
+            }
+            char quote = *p++;
+            const char *valueEnd = static_cast<const char*>(std::memchr(p, quote, end - p));
+            if (!valueEnd) {
+                return {};
+            }
+            QByteArrayView value(p, valueEnd - p);
+            p = valueEnd + 1;
+
+            if (attributeName.size() == name.size()
+                && std::memcmp(attributeName.data(), name.data(), name.size()) == 0) {
+                if (!std::memchr(value.data(), '&', value.size())) {
+                    return value;
+                }
+                m_attribute.clear();
+                appendDecoded(m_attribute, value);
+                return QByteArrayView(m_attribute);
+            }
+        }
+        return {};
+    }
+
+    int line() const
+    {
+        return int(std::count(m_begin, m_p, '\n')) + 1;
+    }
+
+private:
+    // Closing '>' of a tag, skipping quoted attribute values
+    const char* tagEnd(const char *p) const
+    {
+        char quote = 0;
+        for (; p < m_end; ++p) {
+            char c = *p;
+            if (quote) {
+                if (c == quote) {
+                    quote = 0;
+                }
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '>') {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    void skipEndTag(const char *lt)
+    {
+        const char *gt = static_cast<const char*>(std::memchr(lt, '>', m_end - lt));
+        m_p = gt ? gt + 1 : m_end;
+    }
+
+    // A comment, CDATA section, processing instruction or doctype at m_p
+    bool skipMarkup()
+    {
+        const char *end = nullptr;
+        if (m_p[1] == '?') {
+            end = find(m_p + 2, m_end, "?>", 2);
+            m_p = end ? end + 2 : m_p;
+        } else if (m_end - m_p >= 4 && std::memcmp(m_p, "<!--", 4) == 0) {
+            end = find(m_p + 4, m_end, "-->", 3);
+            m_p = end ? end + 3 : m_p;
+        } else if (m_end - m_p >= 9 && std::memcmp(m_p, "<![CDATA[", 9) == 0) {
+            end = find(m_p + 9, m_end, "]]>", 3);
+            m_p = end ? end + 3 : m_p;
+        } else {
+            // <!DOCTYPE ...>, possibly with an internal subset in brackets
+            int brackets = 0;
+            for (const char *p = m_p + 2; p < m_end; ++p) {
+                if (*p == '[') {
+                    ++brackets;
+                } else if (*p == ']') {
+                    --brackets;
+                } else if (*p == '>' && brackets <= 0) {
+                    end = p;
+                    break;
+                }
+            }
+            m_p = end ? end + 1 : m_p;
+        }
+        return end != nullptr;
+    }
+
+    const char *m_begin;
+    const char *m_p;
+    const char *m_end;
+    QByteArray m_text;
+    QByteArray m_attribute;
+};
+
+// A model directory's config names its SDF file
+QString modelFileIn(const QString &directory)
+{
+    QFile config(QDir(directory).filePath("model.config"));
+    if (config.open(QIODevice::ReadOnly)) {
+        QByteArray data = config.readAll();
+        TagScanner scanner(data.constData(), data.constData() + data.size());
+        for (Tag tag = scanner.next(); tag.kind == Tag::Start || tag.kind == Tag::End; tag = scanner.next()) {
+            if (tag.kind == Tag::Start && is(tag.name, "sdf") && !tag.selfClosing) {
+                QByteArrayView file = trimmed(scanner.text());
+                if (!file.isEmpty()) {
+                    return QDir(directory).filePath(QString::fromUtf8(file));
+                }
+            }
+        }
+    }
+    return QDir(directory).filePath("model.sdf");
+}
+
+} // namespace
+
+class SDFReader::Parser
+{
+public:
+    Parser(SDFReader *reader, const char *begin, const char *end, const QString &baseDir)
+        : m_reader(reader)
+        , m_scanner(begin, end)
+        , m_baseDir(baseDir)
+    {
+    }
+
+    bool readWorldFile(Scene *scene, QString *error)
+    {
+        for (;;) {
+            Tag tag = m_scanner.next();
+            if (tag.kind == Tag::Start) {
+                if (is(tag.name, "sdf")) {
+                    continue;   // Its children are read in this loop
+                }
+                if (is(tag.name, "world")) {
+                    readWorld(tag, scene);
+                } else if (is(tag.name, "model")) {
+                    // A model file opened as a world
+                    ModelData model;
+                    readModel(tag, &model);
+                    place(scene, model, model.name, model.pose, model.isStatic);
+                } else {
+                    unsupported("sdf", tag);
+                }
+            } else if (tag.kind != Tag::End) {
+                m_malformed = tag.kind == Tag::Malformed;
+                break;
+            }
+        }
+        return finish(error);
+    }
+
+    bool readModelFile(ModelData *model, QString *error)
+    {
+        for (;;) {
+            Tag tag = m_scanner.next();
+            if (tag.kind == Tag::Start) {
+                if (is(tag.name, "model")) {
+                    readModel(tag, model);
+                    return finish(error);
+                }
+                if (!is(tag.name, "sdf")) {
+                    unsupported("sdf", tag);
+                }
+            } else if (tag.kind != Tag::End) {
+                m_malformed = tag.kind == Tag::Malformed;
+                break;
+            }
+        }
+        if (finish(error) && error) {
+            *error = "No <model> element";
+        }
+        return false;
+    }
+
+private:
+    bool finish(QString *error)
+    {
+        if (m_malformed) {
+            if (error) {
+                *error = QString("Malformed XML at line %1").arg(m_scanner.line());
+            }
+            return false;
+        }
+        return true;
+    }
+
+    // Calls handle for each child of tag; handle reads or skips the child
+    template <typename Handler>
+    void forEachChild(const Tag &tag, Handler handle)
+    {
+        if (tag.selfClosing) {
+            return;
+        }
+        for (;;) {
+            Tag child = m_scanner.next();
+            if (child.kind == Tag::Start) {
+                handle(child);
+            } else {
+                m_malformed = m_malformed || child.kind == Tag::Malformed;
+                return;
+            }
+        }
+    }
+
+    QByteArrayView text(const Tag &tag)
+    {
+        return tag.selfClosing ? QByteArrayView() : m_scanner.text();
+    }
+
+    QString attribute(const Tag &tag, const char *name)
+    {
+        return QString::fromUtf8(m_scanner.attribute(tag, name));
+    }
+
+    void unsupported(const char *parent, const Tag &tag)
+    {
+        ++m_reader->m_unsupported[QByteArray(parent) + '/' + tag.name.toByteArray()];
+        if (!tag.selfClosing) {
+            m_scanner.skip();
+        }
+    }
+
+    void readWorld(const Tag &tag, Scene *scene)
+    {
+        QString name = attribute(tag, "name");
+        scene->setWorldName(name.isEmpty() ? QStringLiteral("world") : name);
+
+        Scene::Physics physics;
+        forEachChild(tag, [&](const Tag &child) {
+            if (is(child.name, "model")) {
+                ModelData model;
+                readModel(child, &model);
+                place(scene, model, model.name, model.pose, model.isStatic);
+            } else if (is(child.name, "include")) {
+                Placement placement;
+                if (readInclude(child, &placement)) {
+                    place(scene, *placement.model, placement.name, placement.pose, placement.isStatic);
+                }
+            } else if (is(child.name, "light")) {
+                scene->addLight(readLight(child));
+            } else if (is(child.name, "physics")) {
+                readPhysics(child, &physics);
+            } else if (is(child.name, "gravity")) {
+                physics.gravity = QString::fromUtf8(trimmed(text(child)));
+            } else {
+                unsupported("world", child);
+            }
+        });
+        scene->setPhysics(physics);
+    }
+
+    void readModel(const Tag &tag, ModelData *model)
+    {
+        model->name = attribute(tag, "name");
+        forEachChild(tag, [&](const Tag &child) {
+            if (is(child.name, "link")) {
+                Part part;
+                if (readLink(child, &part)) {
+                    model->parts.append(part);
+                }
+            } else if (is(child.name, "pose")) {
+                model->pose = readPose(child);
+            } else if (is(child.name, "static")) {
+                model->isStatic = parseBool(text(child));
+            } else if (is(child.name, "model")) {
+                ModelData nested;
+                readModel(child, &nested);
+                adopt(model, nested, nested.name, nested.pose, nested.isStatic);
+            } else if (is(child.name, "include")) {
+                Placement placement;
+                if (readInclude(child, &placement)) {
+                    adopt(model, *placement.model, placement.name, placement.pose, placement.isStatic);
+                }
+            } else {
+                unsupported("model", child);
+            }
+        });
+    }
+
+    struct Placement {
+        QSharedPointer<const ModelData> model;
+        QString name;
+        Pose pose;
+        bool isStatic = false;
+    };
+
+    // The include's name, pose and static flag replace the model's own
+    bool readInclude(const Tag &tag, Placement *placement)
+    {
+        QString uri;
+        bool hasPose = false;
+        bool hasStatic = false;
+        forEachChild(tag, [&](const Tag &child) {
+            if (is(child.name, "uri")) {
+                uri = QString::fromUtf8(trimmed(text(child)));
+            } else if (is(child.name, "name")) {
+                placement->name = QString::fromUtf8(trimmed(text(child)));
+            } else if (is(child.name, "pose")) {
+                placement->pose = readPose(child);
+                hasPose = true;
+            } else if (is(child.name, "static")) {
+                placement->isStatic = parseBool(text(child));
+                hasStatic = true;
+            } else {
+                unsupported("include", child);
+            }
+        });
+
+        placement->model = m_reader->includedModel(uri, m_baseDir);
+        if (!placement->model) {
+            return false;
+        }
+        if (placement->name.isEmpty()) {
+            placement->name = placement->model->name;
+        }
+        if (!hasPose) {
+            placement->pose = placement->model->pose;
+        }
+        if (!hasStatic) {
+            placement->isStatic = placement->model->isStatic;
+        }
+        return true;
+    }
+
+    // The first visual with a supported shape, or failing that a collision
+    bool readLink(const Tag &tag, Part *part)
+    {
+        part->path = attribute(tag, "name");
+        Pose linkPose;
+        Pose visualPose;
+        Pose collisionPose;
+        Scene::Model collision;
+        bool hasVisual = false;
+        bool hasCollision = false;
+        forEachChild(tag, [&](const Tag &child) {
+            if (is(child.name, "pose")) {
+                linkPose = readPose(child);
+            } else if (is(child.name, "visual")) {
+                if (hasVisual) {
+                    unsupported("link", child);     // Only one shape per link is kept
+                } else {
+                    hasVisual = readShape(child, &part->model, &visualPose);
+                }
+            } else if (is(child.name, "collision") && !hasCollision) {
+                hasCollision = readShape(child, &collision, &collisionPose);
+            } else if (is(child.name, "collision")) {
+                if (!child.selfClosing) {
+                    m_scanner.skip();
+                }
+            } else {
+                unsupported("link", child);
+            }
+        });
+
+        if (!hasVisual) {
+            if (!hasCollision) {
+                return false;
+            }
+            part->model = collision;
+            visualPose = collisionPose;
+        }
+        part->pose = compose(linkPose, visualPose);
+        return true;
+    }
+
+    bool readShape(const Tag &tag, Scene::Model *model, Pose *pose)
+    {
+        const char *parent = is(tag.name, "visual") ? "visual" : "collision";
+        bool shaped = false;
+        forEachChild(tag, [&](const Tag &child) {
+            if (is(child.name, "pose")) {
+                *pose = readPose(child);
+            } else if (is(child.name, "geometry")) {
+                shaped = readGeometry(child, model);
+            } else if (is(child.name, "material")) {
+                readMaterial(child, model);
+            } else {
+                unsupported(parent, child);
+            }
+        });
+        return shaped;
+    }
+
+    bool readGeometry(const Tag &tag, Scene::Model *model)
+    {
+        bool shaped = false;
+        forEachChild(tag, [&](const Tag &child) {
+            double v[3];
+            if (shaped) {
+                unsupported("geometry", child);
+            } else if (is(child.name, "box")) {
+                model->geometry = Scene::Geometry::Box;
+                model->scale = {1.0f, 1.0f, 1.0f};
+                forEachChild(child, [&](const Tag &size) {
+                    if (is(size.name, "size") && parseNumbers(text(size), v, 3) == 3) {
+                        model->scale = {float(v[0]), float(v[1]), float(v[2])};
+                    } else {
+                        unsupported("box", size);
+                    }
+                });
+                shaped = true;
+            } else if (is(child.name, "sphere") || is(child.name, "cylinder")) {
+                // Scale holds the radius in x and y and the length in z
+                bool sphere = is(child.name, "sphere");
+                double radius = sphere ? 1.0 : 0.5;
+                double length = 1.0;
+                forEachChild(child, [&](const Tag &field) {
+                    if (is(field.name, "radius") && parseNumbers(text(field), v, 1) == 1) {
+                        radius = v[0];
+                    } else if (!sphere && is(field.name, "length") && parseNumbers(text(field), v, 1) == 1) {
+                        length = v[0];
+                    } else {
+                        unsupported(sphere ? "sphere" : "cylinder", field);
+                    }
+                });
+                model->geometry = sphere ? Scene::Geometry::Sphere : Scene::Geometry::Cylinder;
+                model->scale = {float(radius), float(radius), float(sphere ? radius : length)};
+                shaped = true;
+            } else if (is(child.name, "mesh")) {
+                model->geometry = Scene::Geometry::Mesh;
+                model->scale = {1.0f, 1.0f, 1.0f};
+                forEachChild(child, [&](const Tag &field) {
+                    if (is(field.name, "uri")) {
+                        model->meshUri = meshUri(QString::fromUtf8(trimmed(text(field))));
+                    } else if (is(field.name, "scale") && parseNumbers(text(field), v, 3) == 3) {
+                        model->scale = {float(v[0]), float(v[1]), float(v[2])};
+                    } else {
+                        unsupported("mesh", field);
+                    }
+                });
+                shaped = !model->meshUri.isEmpty();
+            } else {
+                unsupported("geometry", child);
+            }
+        });
+        return shaped;
+    }
+
+    void readMaterial(const Tag &tag, Scene::Model *model)
+    {
+        bool hasDiffuse = false;
+        forEachChild(tag, [&](const Tag &child) {
+            quint32 rgb = 0;
+            if (is(child.name, "diffuse")) {
+                if (parseColorText(text(child), &rgb)) {
+                    model->color = rgb;
+                    model->hasColor = hasDiffuse = true;
+                }
+            } else if (is(child.name, "ambient")) {
+                if (parseColorText(text(child), &rgb) && !hasDiffuse) {
+                    model->color = rgb;
+                    model->hasColor = true;
+                }
+            } else {
+                unsupported("material", child);
+            }
+        });
+    }
+
+    Scene::Light readLight(const Tag &tag)
+    {
+        Scene::Light light;
+        light.name = attribute(tag, "name");
+        light.type = attribute(tag, "type");
+        if (light.type.isEmpty()) {
+            light.type = QStringLiteral("point");
+        }
+        light.diffuse = QStringLiteral("1 1 1 1");
+        forEachChild(tag, [&](const Tag &child) {
+            if (is(child.name, "pose")) {
+                Pose pose = readPose(child);
+                light.position = {float(pose.position[0]), float(pose.position[1]), float(pose.position[2])};
+            } else if (is(child.name, "diffuse")) {
+                light.diffuse = QString::fromUtf8(trimmed(text(child)));
+            } else {
+                unsupported("light", child);
+            }
+        });
+        return light;
+    }
+
+    void readPhysics(const Tag &tag, Scene::Physics *physics)
+    {
+        forEachChild(tag, [&](const Tag &child) {
+            double value = 0.0;
+            if (is(child.name, "max_step_size") && parseNumbers(text(child), &value, 1) == 1) {
+                physics->maxStepSize = value;
+            } else if (is(child.name, "real_time_factor") && parseNumbers(text(child), &value, 1) == 1) {
+                physics->realTimeFactor = value;
+            } else if (is(child.name, "gravity")) {
+                // Where SDFWriter puts it; SDF itself has it on the world
+                physics->gravity = QString::fromUtf8(trimmed(text(child)));
+            } else {
+                unsupported("physics", child);
+            }
+        });
+    }
+
+    Pose readPose(const Tag &tag)
+    {
+        if (!m_scanner.attribute(tag, "relative_to").isEmpty()) {
+            // Taken as relative to the parent, the default frame
+            ++m_reader->m_unsupported["pose@relative_to"];
+        }
+        bool degrees = is(m_scanner.attribute(tag, "degrees"), "true");
+        bool quaternion = is(m_scanner.attribute(tag, "rotation_format"), "quat_xyzw");
+
+        double v[7] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        int count = parseNumbers(text(tag), v, 7);
+
+        Pose pose;
+        std::copy(v, v + 3, pose.position);
+        if (quaternion && count == 7) {
+            double norm = std::sqrt(v[3] * v[3] + v[4] * v[4] + v[5] * v[5] + v[6] * v[6]);
+            if (norm > 0.0) {
+                pose.rotation[0] = v[6] / norm;
+                pose.rotation[1] = v[3] / norm;
+                pose.rotation[2] = v[4] / norm;
+                pose.rotation[3] = v[5] / norm;
+            }
+        } else {
+            double scale = degrees ? M_PI / 180.0 : 1.0;
+            fromRpy(v[3] * scale, v[4] * scale, v[5] * scale, pose.rotation);
+        }
+        return pose;
+    }
+
+    // Relative mesh paths are resolved against this file, so they still
+    // work once the world is saved elsewhere
+    QString meshUri(const QString &uri) const
+    {
+        if (uri.isEmpty() || uri.contains(QLatin1String("://")) || QDir::isAbsolutePath(uri)) {
+            return uri;
+        }
+        return QDir(m_baseDir).absoluteFilePath(uri);
+    }
+
+    static void adopt(ModelData *parent, const ModelData &child, const QString &name, const Pose &pose,
+                      bool isStatic)
+    {
+        for (const Part &part : child.parts) {
+            Part adopted = part;
+            adopted.path = name + "::" + part.path;
+            adopted.pose = compose(pose, part.pose);
+            adopted.model.isStatic = part.model.isStatic || isStatic;
+            parent->parts.append(adopted);
+        }
+    }
+
+    static void place(Scene *scene, const ModelData &model, const QString &name, const Pose &pose,
+                      bool isStatic)
+    {
+        for (const Part &part : model.parts) {
+            Scene::Model entry = part.model;
+            entry.name = model.parts.size() == 1 ? name : name + "::" + part.path;
+            Pose world = compose(pose, part.pose);
+            double roll, pitch, yaw;
+            toRpy(world.rotation, &roll, &pitch, &yaw);
+            entry.position = {snap(world.position[0]), snap(world.position[1]), snap(world.position[2])};
+            entry.rotation = {snap(roll), snap(pitch), snap(yaw)};
+            entry.isStatic = part.model.isStatic || isStatic;
+            scene->append(entry);
+        }
+    }
+
+    // Rounding noise from composing rotations, e.g. 1e-17 for 0
+    static float snap(double value)
+    {
+        return std::abs(value) < 1e-9 ? 0.0f : float(value);
+    }
+
+    // Fixed-axis roll, pitch and yaw, as SDF uses
+    static void fromRpy(double roll, double pitch, double yaw, double *q)
+    {
+        double cr = std::cos(roll / 2), sr = std::sin(roll / 2);
+        double cp = std::cos(pitch / 2), sp = std::sin(pitch / 2);
+        double cy = std::cos(yaw / 2), sy = std::sin(yaw / 2);
+        q[0] = cr * cp * cy + sr * sp * sy;
+        q[1] = sr * cp * cy - cr * sp * sy;
+        q[2] = cr * sp * cy + sr * cp * sy;
+        q[3] = cr * cp * sy - sr * sp * cy;
+    }
+
+    static void toRpy(const double *q, double *roll, double *pitch, double *yaw)
+    {
+        double w = q[0], x = q[1], y = q[2], z = q[3];
+        *roll = std::atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y));
+        double sinPitch = 2 * (w * y - z * x);
+        *pitch = std::abs(sinPitch) >= 1 ? std::copysign(M_PI / 2, sinPitch) : std::asin(sinPitch);
+        *yaw = std::atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z));
+    }
+
+    // child expressed in parent's frame
+    static Pose compose(const Pose &parent, const Pose &child)
+    {
+        const double *a = parent.rotation;
+        const double *b = child.rotation;
+        const double *v = child.position;
+
+        // v + 2w(u x v) + 2u x (u x v), with u the quaternion's vector part
+        double t[3] = {2 * (a[2] * v[2] - a[3] * v[1]),
+                       2 * (a[3] * v[0] - a[1] * v[2]),
+                       2 * (a[1] * v[1] - a[2] * v[0])};
+        Pose pose;
+        pose.position[0] = parent.position[0] + v[0] + a[0] * t[0] + (a[2] * t[2] - a[3] * t[1]);
+        pose.position[1] = parent.position[1] + v[1] + a[0] * t[1] + (a[3] * t[0] - a[1] * t[2]);
+        pose.position[2] = parent.position[2] + v[2] + a[0] * t[2] + (a[1] * t[1] - a[2] * t[0]);
+
+        pose.rotation[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+        pose.rotation[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+        pose.rotation[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+        pose.rotation[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+        return pose;
+    }
+
+    SDFReader *m_reader;
+    TagScanner m_scanner;
+    QString m_baseDir;
+    bool m_malformed = false;
+};
+
+bool SDFReader::read(const QString &filePath, Scene *scene, QString *error)
+{
+    m_unsupported.clear();
+    m_missingIncludes.clear();
+    m_includes.clear();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = "Failed to open " + filePath + ": " + file.errorString();
+        }
+        return false;
+    }
+    qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data) {
+        if (error) {
+            *error = size > 0 ? "Failed to map " + filePath + ": " + file.errorString()
+                              : filePath + " is empty";
+        }
+        return false;
+    }
+
+    const char *begin = reinterpret_cast<const char*>(data);
+    Parser parser(this, begin, begin + size, QFileInfo(filePath).absolutePath());
+    Scene result;
+    bool ok = parser.readWorldFile(&result, error);
+    m_includes.clear();
+    if (!ok) {
+        return false;
+    }
+
+    if (result.worldName().isEmpty()) {
+        result.setWorldName(QFileInfo(filePath).completeBaseName());
+    }
+    *scene = std::move(result);
+    Logger::instance().info(QString("Read %1 models from %2 (%3 MB in %4 ms)")
+                                .arg(scene->size())
+                                .arg(filePath)
+                                .arg(size / 1048576.0, 0, 'f', 1)
+                                .arg(timer.elapsed()));
+    if (!m_unsupported.isEmpty()) {
+        Logger::instance().warning("Skipped SDF elements the scene doesn't support: " + unsupportedSummary());
+    }
+    if (!m_missingIncludes.isEmpty()) {
+        Logger::instance().warning("Could not resolve included models: " + m_missingIncludes.join(", "));
+    }
+    return true;
+}
+
+QString SDFReader::unsupportedSummary() const
+{
+    // Most frequent first
+    QList<QPair<int, QByteArray>> counts;
+    for (auto it = m_unsupported.constBegin(); it != m_unsupported.constEnd(); ++it) {
+        counts.append({it.value(), it.key()});
+    }
+    std::sort(counts.begin(), counts.end(), [](const auto &a, const auto &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    QStringList parts;
+    for (const auto &count : counts) {
+        parts.append(QString("%1 x%2").arg(QString::fromUtf8(count.second)).arg(count.first));
+    }
+    return parts.join(", ");
+}
+
+QSharedPointer<const SDFReader::ModelData> SDFReader::includedModel(const QString &uri, const QString &baseDir)
+{
+    QString path = resolveUri(uri, baseDir);
+    if (path.isEmpty()) {
+        if (!m_missingIncludes.contains(uri)) {
+            m_missingIncludes.append(uri);
+        }
+        return {};
+    }
+
+    auto it = m_includes.constFind(path);
+    if (it != m_includes.constEnd()) {
+        return *it;
+    }
+
+    // Taken as missing while it is read, so an include cycle ends here
+    m_includes.insert(path, {});
+
+    QString sdfPath = QFileInfo(path).isDir() ? modelFileIn(path) : path;
+    QFile file(sdfPath);
+    qint64 size = file.open(QIODevice::ReadOnly) ? file.size() : 0;
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+
+    auto model = QSharedPointer<ModelData>::create();
+    QString error = "Failed to read " + sdfPath;
+    const char *begin = reinterpret_cast<const char*>(data);
+    if (!data || !Parser(this, begin, begin + size, QFileInfo(sdfPath).absolutePath())
+                      .readModelFile(model.data(), &error)) {
+        Logger::instance().warning("Included model " + uri + ": " + error);
+        m_missingIncludes.append(uri);
+        return {};
+    }
+
+    m_includes.insert(path, model);
+    return model;
+}
+
+QString SDFReader::resolveUri(const QString &uri, const QString &baseDir) const
+{
+    if (uri.startsWith(QLatin1String("model://"))) {
+        QStringList directories;
+        for (const char *variable : {"GZ_SIM_RESOURCE_PATH", "IGN_GAZEBO_RESOURCE_PATH", "GAZEBO_MODEL_PATH"}) {
+            directories += qEnvironmentVariable(variable).split(':', Qt::SkipEmptyParts);
+        }
+        directories += m_resourcePaths;
+        directories += baseDir;
+
+        QString name = uri.mid(8);
+        for (const QString &directory : directories) {
+            QString candidate = QDir(directory).filePath(name);
+            if (QFileInfo::exists(candidate)) {
+                return QFileInfo(candidate).absoluteFilePath();
+            }
+        }
+        return {};
+    }
+
+    QString path;
+    if (uri.startsWith(QLatin1String("file://"))) {
+        path = uri.mid(7);
+    } else if (uri.contains(QLatin1String("://")) || uri.isEmpty()) {
+        return {};  // e.g. a Fuel URL, which would need a download
+    } else {
+        path = QDir(baseDir).filePath(uri);
+    }
+    return QFileInfo::exists(path) ? QFileInfo(path).absoluteFilePath() : QString();
+}
+
+} // namespace Burma
@@ -0,0 +1,469 @@
+#include "modules/SDFWriter.h"
+
+#include <QIODevice>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <charconv>
+#include <cstring>
+#include <vector>
+
+namespace Burma {
+
+namespace {
+
+// Room for any number with 6 significant digits, e.g. "-1.23457e+308"
+constexpr qsizetype kMaxNumberSize = 32;
+
+// Same text as QString::arg(double): %g with 6 significant digits,
+// independent of the C locale
+char* formatNumber(char *out, double value)
+{
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    return std::to_chars(out, out + kMaxNumberSize, value, std::chars_format::general, 6).ptr;
+#else
+    QByteArray text = QByteArray::number(value, 'g', 6);
+    std::memcpy(out, text.constData(), text.size());
+    return out + text.size();
+#endif
+}
+
+template <qsizetype N>
+char* copy(char *out, const char (&literal)[N])
+{
+    std::memcpy(out, literal, N - 1);
+    return out + N - 1;
+}
+
+// The <geometry> element, written once and used by both visual and collision
+qsizetype formatGeometry(char *out, Scene::Geometry geometry, const Scene::Vec3 &scale)
+{
+    char *begin = out;
+    out = copy(out, "          <geometry>\n");
+    switch (geometry) {
+    case Scene::Geometry::Box:
+        out = copy(out, "            <box><size>");
+        out = formatNumber(out, scale.x);
+        *out++ = ' ';
+        out = formatNumber(out, scale.y);
+        *out++ = ' ';
+        out = formatNumber(out, scale.z);
+        out = copy(out, "</size></box>\n");
+        break;
+    case Scene::Geometry::Sphere:
+        out = copy(out, "            <sphere><radius>");
+        out = formatNumber(out, scale.x);
+        out = copy(out, "</radius></sphere>\n");
+        break;
+    case Scene::Geometry::Cylinder:
+        out = copy(out, "            <cylinder><radius>");
+        out = formatNumber(out, scale.x);
+        out = copy(out, "</radius><length>");
+        out = formatNumber(out, scale.z);
+        out = copy(out, "</length></cylinder>\n");
+        break;
+    case Scene::Geometry::Mesh:     // Written by writeLink(); the URI has no length limit
+    case Scene::Geometry::Unknown:
+        break;
+    }
+    out = copy(out, "          </geometry>\n");
+    return out - begin;
+}
+
+} // namespace
+
+SDFWriter::SDFWriter(QIODevice *device)
+    : m_device(device)
+    , m_target(nullptr)
+    , m_chunk(kChunkSize, Qt::Uninitialized)
+    , m_used(0)
+    , m_bytesWritten(0)
+    , m_error(false)
+{
+}
+
+SDFWriter::SDFWriter(QByteArray *target)
+    : m_device(nullptr)
+    , m_target(target)
+    , m_chunk(kChunkSize, Qt::Uninitialized)
+    , m_used(0)
+    , m_bytesWritten(0)
+    , m_error(false)
+{
+}
+
+SDFWriter::~SDFWriter()
+{
+    flush();
+}
+
+bool SDFWriter::writeWorld(const Scene &scene, QThreadPool *pool)
+{
+    writeHeader(scene);
+
+    if (pool && scene.size() > kModelsPerTask) {
+        writeModelsParallel(scene, pool);
+    } else {
+        for (int i = 0; i < scene.size(); ++i) {
+            writeModel(scene, i);
+        }
+    }
+
+    writeFooter();
+    return flush();
+}
+
+void SDFWriter::writeHeader(const Scene &scene)
+{
+    write("<?xml version=\"1.0\" ?>\n");
+    write("<sdf version=\"1.9\">\n");
+    write("  <world name=\"");
+    writeEscaped(scene.worldName());
+    write("\">\n");
+
+    writePhysics(scene.physics());
+    writeLights(scene.lights());
+}
+
+void SDFWriter::writeFooter()
+{
+    write("</world>\n");
+    write("</sdf>\n");
+}
+
+void SDFWriter::writeModel(const Scene &scene, int index)
+{
+    write("    <model name=\"");
+    writeEscaped(scene.name(index));
+    write("\">\n");
+
+    if (scene.isStatic(index)) {
+        write("      <static>true</static>\n");
+    }
+
+    write("      <pose>");
+    writeVec3(scene.position(index));
+    *reserve(1) = ' ';
+    writeVec3(scene.rotation(index));
+    write("</pose>\n");
+
+    writeLink(scene, index);
+    write("    </model>\n");
+}
+
+void SDFWriter::writeInclude(const Scene &scene, int index, const QString &uri)
+{
+    // The name, static flag and pose are written as in writeModel(), so an
+    // include saves the same number of bytes for every model of a body
+    write("    <include>\n"
+          "      <uri>");
+    writeEscaped(uri);
+    write("</uri>\n"
+          "      <name>");
+    writeEscaped(scene.name(index));
+    write("</name>\n");
+
+    if (scene.isStatic(index)) {
+        write("      <static>true</static>\n");
+    }
+
+    write("      <pose>");
+    writeVec3(scene.position(index));
+    *reserve(1) = ' ';
+    writeVec3(scene.rotation(index));
+    write("</pose>\n"
+          "    </include>\n");
+}
+
+void SDFWriter::writeBody(const Scene &scene, int index, const QString &name)
+{
+    write("<?xml version=\"1.0\" ?>\n");
+    write("<sdf version=\"1.9\">\n");
+    write("  <model name=\"");
+    writeEscaped(name);
+    write("\">\n");
+    writeLink(scene, index);
+    write("  </model>\n");
+    write("</sdf>\n");
+}
+
+void SDFWriter::writeModelConfig(const QString &name)
+{
+    write("<?xml version=\"1.0\" ?>\n"
+          "<model>\n"
+          "  <name>");
+    writeEscaped(name);
+    write("</name>\n"
+          "  <version>1.0</version>\n"
+          "  <sdf version=\"1.9\">model.sdf</sdf>\n"
+          "</model>\n");
+}
+
+void SDFWriter::writeLink(const Scene &scene, int index)
+{
+    char geometry[256];
+    qsizetype geometrySize = formatGeometry(geometry, scene.geometry(index), scene.scale(index));
+    bool mesh = scene.geometry(index) == Scene::Geometry::Mesh;
+
+    write("      <link name=\"link\">\n");
+    write("        <visual name=\"visual\">\n");
+    if (mesh) {
+        writeMesh(scene, index);
+    } else {
+        write(geometry, geometrySize);
+    }
+    if (scene.hasColor(index)) {
+        write("          <material>\n"
+              "            <ambient>");
+        writeColor(scene.color(index));
+        write("</ambient>\n"
+              "            <diffuse>");
+        writeColor(scene.color(index));
+        write("</diffuse>\n"
+              "          </material>\n");
+    }
+    write("        </visual>\n");
+    write("        <collision name=\"collision\">\n");
+    if (mesh) {
+        writeMesh(scene, index);
+    } else {
+        write(geometry, geometrySize);
+    }
+    write("        </collision>\n");
+    write("      </link>\n");
+}
+
+void SDFWriter::writeMesh(const Scene &scene, int index)
+{
+    write("          <geometry>\n"
+          "            <mesh><uri>");
+    writeEscaped(scene.meshUri(index));
+    write("</uri><scale>");
+    writeVec3(scene.scale(index));
+    write("</scale></mesh>\n"
+          "          </geometry>\n");
+}
+
+void SDFWriter::writeModelsParallel(const Scene &scene, QThreadPool *pool)
+{
+    struct Task {
+        QByteArray sdf;
+        bool done = false;
+    };
+
+    int taskCount = (scene.size() + kModelsPerTask - 1) / kModelsPerTask;
+    std::vector<Task> tasks(taskCount);
+    QMutex mutex;
+    QWaitCondition taskDone;
+
+    auto submit = [&](int task) {
+        pool->start([&, task]() {
+            int first = task * kModelsPerTask;
+            int last = qMin(first + kModelsPerTask, scene.size());
+
+            QByteArray sdf;
+            sdf.reserve(qsizetype(last - first) * 640);
+            {
+                SDFWriter writer(&sdf);
+                for (int i = first; i < last; ++i) {
+                    writer.writeModel(scene, i);
+                }
+            }
+
+            QMutexLocker locker(&mutex);
+            tasks[task].sdf = std::move(sdf);
+            tasks[task].done = true;
+            taskDone.wakeAll();
+        });
+    };
+
+    // Keep a bounded window of tasks in flight, so memory stays at a few
+    // chunks per thread however large the world is
+    int window = qMax(2, 2 * pool->maxThreadCount());
+    int submitted = 0;
+    while (submitted < qMin(window, taskCount)) {
+        submit(submitted++);
+    }
+
+    // Write the chunks back in model order as they complete
+    for (int task = 0; task < taskCount; ++task) {
+        QByteArray sdf;
+        {
+            QMutexLocker locker(&mutex);
+            while (!tasks[task].done) {
+                taskDone.wait(&mutex);
+            }
+            sdf = std::move(tasks[task].sdf);
+        }
+        if (submitted < taskCount) {
+            submit(submitted++);
+        }
+        write(sdf.constData(), sdf.size());
+    }
+}
+
+bool SDFWriter::flush()
+{
+    if (m_used > 0) {
+        if (!m_device) {
+            m_target->append(m_chunk.constData(), m_used);
+        } else if (!m_error && m_device->write(m_chunk.constData(), m_used) != m_used) {
+            // Keep going so callers can check once at the end
+            m_error = true;
+        }
+        m_bytesWritten += m_used;
+        m_used = 0;
+    }
+    return !m_error;
+}
+
+qsizetype SDFWriter::estimateSize(const Scene &scene)
+{
+    // Header, physics and a few lights, then the longest model template
+    // (cylinder with material) with six-digit numbers
+    qsizetype size = 1024 + scene.worldName().size() * 6 + scene.lights().size() * 256;
+    for (int i = 0; i < scene.size(); ++i) {
+        size += 900 + scene.name(i).size() * 6;
+        if (scene.geometry(i) == Scene::Geometry::Mesh) {
+            size += 2 * scene.meshUri(i).size() * 6;
+        }
+    }
+    return size;
+}
+
+void SDFWriter::write(const char *data, qsizetype size)
+{
+    if (size > m_chunk.size() - m_used) {
+        flush();
+        if (size > m_chunk.size()) {
+            // Larger than a chunk: pass it through
+            if (!m_device) {
+                m_target->append(data, size);
+            } else if (!m_error && m_device->write(data, size) != size) {
+                m_error = true;
+            }
+            m_bytesWritten += size;
+            return;
+        }
+    }
+    std::memcpy(m_chunk.data() + m_used, data, size);
+    m_used += size;
+}
+
+char* SDFWriter::reserve(qsizetype size)
+{
+    if (size > m_chunk.size() - m_used) {
+        flush();
+    }
+    char *out = m_chunk.data() + m_used;
+    m_used += size;
+    return out;
+}
+
+void SDFWriter::writeNumber(double value)
+{
+    char *out = reserve(kMaxNumberSize);
+    char *end = formatNumber(out, value);
+    m_used -= kMaxNumberSize - (end - out);
+}
+
+void SDFWriter::writeVec3(const Scene::Vec3 &v)
+{
+    char *out = reserve(3 * kMaxNumberSize + 2);
+    char *end = formatNumber(out, v.x);
+    *end++ = ' ';
+    end = formatNumber(end, v.y);
+    *end++ = ' ';
+    end = formatNumber(end, v.z);
+    m_used -= 3 * kMaxNumberSize + 2 - (end - out);
+}
+
+void SDFWriter::writeColor(quint32 rgb)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    char *out = reserve(7);
+    out[0] = '#';
+    for (int i = 0; i < 6; ++i) {
+        out[6 - i] = digits[(rgb >> (4 * i)) & 0xF];
+    }
+}
+
+void SDFWriter::writeEscaped(const QString &text)
+{
+    // Plan names are nearly always ASCII: escape them as they are copied
+    for (QChar c : text) {
+        if (c.unicode() >= 0x80) {
+            // Rare: transcode the whole string once
+            QByteArray utf8 = text.toUtf8();
+            for (char byte : utf8) {
+                switch (byte) {
+                case '&': write("&amp;"); break;
+                case '<': write("&lt;"); break;
+                case '>': write("&gt;"); break;
+                case '"': write("&quot;"); break;
+                case '\'': write("&apos;"); break;
+                default: *reserve(1) = byte; break;
+                }
+            }
+            return;
+        }
+    }
+
+    for (QChar c : text) {
+        switch (c.unicode()) {
+        case '&': write("&amp;"); break;
+        case '<': write("&lt;"); break;
+        case '>': write("&gt;"); break;
+        case '"': write("&quot;"); break;
+        case '\'': write("&apos;"); break;
+        default: *reserve(1) = char(c.unicode()); break;
+        }
+    }
+}
+
+void SDFWriter::writePhysics(const Scene::Physics &physics)
+{
+    write("    <physics type=\"ode\">\n"
+          "      <max_step_size>");
+    writeNumber(physics.maxStepSize);
+    write("</max_step_size>\n"
+          "      <real_time_factor>");
+    writeNumber(physics.realTimeFactor);
+    write("</real_time_factor>\n"
+          "      <gravity>");
+    writeEscaped(physics.gravity);
+    write("</gravity>\n"
+          "    </physics>\n");
+}
+
+void SDFWriter::writeLights(const QList<Scene::Light> &lights)
+{
+    if (lights.isEmpty()) {
+        // Default sun light
+        write("    <light type=\"directional\" name=\"sun\">\n"
+              "      <pose>0 0 10 0 0 0</pose>\n"
+              "      <diffuse>1 1 1 1</diffuse>\n"
+              "      <specular>0.5 0.5 0.5 1</specular>\n"
+              "      <direction>-0.5 0.1 -0.9</direction>\n"
+              "    </light>\n");
+        return;
+    }
+
+    for (const Scene::Light &light : lights) {
+        write("    <light type=\"");
+        writeEscaped(light.type);
+        write("\" name=\"");
+        writeEscaped(light.name);
+        write("\">\n"
+              "      <pose>");
+        writeVec3(light.position);
+        write(" 0 0 0</pose>\n"
+              "      <diffuse>");
+        writeEscaped(light.diffuse);
+        write("</diffuse>\n"
+              "    </light>\n");
+    }
+}
+
+} // namespace Burma
@@ -0,0 +1,224 @@
+#include "modules/WorldStore.h"
+#include "utils/Logger.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryFile>
+
+namespace Burma {
+
+namespace {
+
+// Hashes what is written on its way to target, if any
+class HashingDevice : public QIODevice
+{
+public:
+    explicit HashingDevice(QIODevice *target = nullptr)
+        : m_hash(QCryptographicHash::Sha256)
+        , m_target(target)
+    {
+        open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+
+    QByteArray result() const { return m_hash.result(); }
+
+protected:
+    qint64 readData(char *, qint64) override { return -1; }
+
+    qint64 writeData(const char *data, qint64 size) override
+    {
+        if (m_target && m_target->write(data, size) != size) {
+            setErrorString(m_target->errorString());
+            return -1;
+        }
+        m_hash.addData(QByteArrayView(data, size));
+        return size;
+    }
+
+private:
+    QCryptographicHash m_hash;
+    QIODevice *m_target;
+};
+
+// Marks an entry as recently used
+bool touch(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return true;
+}
+
+} // namespace
+
+WorldStore::WorldStore(const QString &directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+    , m_totalBytes(0)
+{
+    QDir dir(m_directory);
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+
+    // Partial entries and working files of sessions that ended abruptly
+    QDateTime stale = QDateTime::currentDateTime().addDays(-1);
+    const QFileInfoList leftovers = dir.entryInfoList({"*.part", "edit-*.world"}, QDir::Files);
+    for (const QFileInfo &leftover : leftovers) {
+        if (leftover.lastModified() < stale) {
+            QFile::remove(leftover.filePath());
+        }
+    }
+
+    const QFileInfoList entries = dir.entryInfoList({"*.sdf"}, QDir::Files);
+    for (const QFileInfo &entry : entries) {
+        m_totalBytes += entry.size();
+    }
+
+    evict();
+}
+
+WorldStore::~WorldStore()
+{
+    QFile::remove(workingPath());
+}
+
+QByteArray WorldStore::hash(const Writer &write)
+{
+    HashingDevice device;
+    write(&device);
+    return device.result();
+}
+
+QString WorldStore::entryPath(const QByteArray &hash) const
+{
+    return QDir(m_directory).filePath(QString::fromLatin1(hash.toHex()) + ".sdf");
+}
+
+QString WorldStore::workingPath() const
+{
+    return QDir(m_directory).filePath(QString("edit-%1.world").arg(QCoreApplication::applicationPid()));
+}
+
+bool WorldStore::store(const QByteArray &hash, const Writer &write, QString *path, bool *written,
+                       QString *error)
+{
+    *path = entryPath(hash);
+    if (touch(*path)) {
+        if (written) {
+            *written = false;
+        }
+        return true;
+    }
+
+    QSaveFile file(*path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) {
+            *error = "Failed to open file for writing: " + file.errorString();
+        }
+        return false;
+    }
+    if (!write(&file) || !file.commit()) {
+        if (error) {
+            *error = "Failed to write world file: " + file.errorString();
+        }
+        return false;
+    }
+
+    if (written) {
+        *written = true;
+    }
+    added(*path, QFileInfo(*path).size());
+    return true;
+}
+
+bool WorldStore::storeStreamed(const Writer &write, QString *path, bool *written, QString *error)
+{
+    QTemporaryFile file(QDir(m_directory).filePath("XXXXXX.part"));
+    if (!file.open()) {
+        if (error) {
+            *error = "Failed to open file for writing: " + file.errorString();
+        }
+        return false;
+    }
+
+    HashingDevice device(&file);
+    if (!write(&device) || !file.flush()) {
+        if (error) {
+            *error = "Failed to write world file: " + file.errorString();
+        }
+        return false;
+    }
+
+    *path = entryPath(device.result());
+    if (touch(*path)) {
+        // The temporary file goes with it
+        if (written) {
+            *written = false;
+        }
+        return true;
+    }
+
+    qint64 size = file.size();
+    if (!file.rename(*path)) {
+        if (error) {
+            *error = "Failed to store world file: " + file.errorString();
+        }
+        return false;
+    }
+    file.setAutoRemove(false);
+
+    if (written) {
+        *written = true;
+    }
+    added(*path, size);
+    return true;
+}
+
+void WorldStore::setMaxBytes(qint64 maxBytes)
+{
+    m_maxBytes = maxBytes;
+    evict();
+}
+
+void WorldStore::added(const QString &path, qint64 size)
+{
+    m_totalBytes += size;
+    evict(path);
+}
+
+void WorldStore::evict(const QString &keep)
+{
+    if (m_totalBytes <= m_maxBytes) {
+        return;
+    }
+
+    // Least recently used first; the entry just stored stays even if it
+    // is larger than the cap on its own
+    QDir dir(m_directory);
+    const QFileInfoList entries = dir.entryInfoList({"*.sdf"}, QDir::Files,
+                                                    QDir::Time | QDir::Reversed);
+    int evicted = 0;
+    for (const QFileInfo &entry : entries) {
+        if (m_totalBytes <= m_maxBytes) {
+            break;
+        }
+        if (entry.filePath() != keep && QFile::remove(entry.filePath())) {
+            m_totalBytes -= entry.size();
+            ++evicted;
+        }
+    }
+
+    if (evicted > 0) {
+        Logger::instance().debug(QString("World store evicted %1 entries").arg(evicted));
+    }
+}
+
+} // namespace Burma
@@ -6,8 +6,13 @@
 #include "ui/AssetBrowser.h"
 #include "ui/ExportPanel.h"
 #include "core/Application.h"
+#include "core/WorldPlanPatch.h"
+#include "core/WorldPlanSchema.h"
 #include "modules/BitNetClient.h"
+#include "modules/FuelFetcher.h"
 #include "modules/SDFBuilder.h"
+#include "modules/RvizConverter.h"
+#include "modules/SDFReader.h"
 #include "utils/Logger.h"
 
 #include <QMenuBar>
@@ -20,8 +25,12 @@
 #include <QApplication>
 #include <QAction>
 #include <QIcon>
-#include <QDir>
-#include <QDateTime>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QTimer>
+#include <QtMath>
+#include <QPointer>
+#include <QThread>
 
 namespace Burma {
 
@@ -38,6 +47,12 @@ MainWindow::MainWindow(QWidget *parent)
     , m_eventLog(nullptr)
     , m_assetBrowser(nullptr)
     , m_exportPanel(nullptr)
+    , m_metricsLabel(nullptr)
+    , m_pendingStoreRequest(0)
+    , m_pendingSceneRequest(0)
+    , m_sdfUpdateScheduled(false)
+    , m_promptJobId(0)
+    , m_promptIsEdit(false)
 {
     setupUi();
     createMenus();
@@ -69,6 +84,9 @@ void MainWindow::setupUi()
     // Create central render widget
     m_renderWidget = new RenderWidget(this);
     setCentralWidget(m_renderWidget);
+
+    m_metricsLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_metricsLabel);
 }
 
 void MainWindow::createMenus()
@@ -120,6 +138,9 @@ void MainWindow::createMenus()
     // Tools Menu
     m_toolsMenu = menuBar()->addMenu(tr("&Tools"));
 
+    QAction *calibrateAction = m_toolsMenu->addAction(tr("&Calibrate BitNet Inference"));
+    connect(calibrateAction, &QAction::triggered, this, &MainWindow::onCalibrateBitNet);
+
     // Help Menu
     m_helpMenu = menuBar()->addMenu(tr("&Help"));
 
@@ -197,6 +218,58 @@ void MainWindow::setupConnections()
     // Connect prompt panel to processing
     connect(m_promptPanel, &PromptPanel::promptSubmitted,
             this, &MainWindow::onProcessPrompt);
+    connect(m_promptPanel, &PromptPanel::cancelRequested,
+            this, &MainWindow::onCancelPrompt);
+
+    // Models are selected by clicking them in the viewport, then edited in
+    // the property editor
+    connect(m_renderWidget, &RenderWidget::selectionChanged, this, [this](const QString &entityName) {
+        if (entityName.isEmpty()) {
+            m_propertyEditor->clearSelection();
+        } else {
+            m_propertyEditor->setSelectedEntity(entityName);
+            m_propertyDock->raise();
+        }
+    });
+    connect(m_propertyEditor, &PropertyEditor::propertyChanged,
+            this, &MainWindow::onPropertyChanged);
+
+    // RViz export of the world on screen
+    connect(m_exportPanel, &ExportPanel::exportRequested,
+            this, &MainWindow::onExportRequested);
+    RvizConverter *rvizConverter = Application::instance().rvizConverter();
+    if (rvizConverter) {
+        connect(rvizConverter, &RvizConverter::conversionProgress,
+                m_exportPanel, &ExportPanel::setExportProgress);
+        connect(rvizConverter, &RvizConverter::conversionError, this, [this](const QString &error) {
+            m_exportPanel->setExportStatus(error);
+            m_exportPanel->setExportProgress(-1);
+        });
+    }
+
+    // World SDF written in the background by showWorldPlan()
+    SDFBuilder *sdfBuilder = Application::instance().sdfBuilder();
+    if (sdfBuilder) {
+        connect(sdfBuilder, &SDFBuilder::buildComplete, this, [this](const QString &filePath) {
+            // A newer plan may have replaced the one being written
+            if (filePath == m_pendingWorldFile) {
+                m_pendingWorldFile.clear();
+                onWorldGenerated(filePath);
+            } else if (filePath == m_currentWorldFile) {
+                statusBar()->showMessage("World saved: " + filePath, 3000);
+            }
+        });
+        connect(sdfBuilder, &SDFBuilder::worldStored, this, [this](quint64 requestId, const QString &filePath) {
+            if (requestId == m_pendingStoreRequest) {
+                m_pendingStoreRequest = 0;
+                onWorldGenerated(filePath);
+            }
+        });
+        connect(sdfBuilder, &SDFBuilder::sceneBuilt, this, &MainWindow::onSceneBuilt);
+        connect(sdfBuilder, &SDFBuilder::buildError, this, [this](const QString &error) {
+            statusBar()->showMessage("Error: " + error, 5000);
+        });
+    }
 
     // Connect event log to logger
     connect(&Logger::instance(), &Logger::messageLogged,
@@ -207,12 +280,41 @@ void MainWindow::setupConnections()
     if (bitNetClient) {
         connect(bitNetClient, &BitNetClient::worldPlanGenerated,
                 this, &MainWindow::onWorldPlanGenerated);
+        connect(bitNetClient, &BitNetClient::worldPatchGenerated,
+                this, &MainWindow::onWorldPatchGenerated);
+        connect(bitNetClient, &BitNetClient::modelReceived,
+                this, &MainWindow::onModelReceived);
         connect(bitNetClient, &BitNetClient::errorOccurred,
                 this, &MainWindow::onBitNetError);
         connect(bitNetClient, &BitNetClient::processingStarted,
                 this, &MainWindow::onBitNetProcessingStarted);
         connect(bitNetClient, &BitNetClient::processingFinished,
                 this, &MainWindow::onBitNetProcessingFinished);
+        connect(bitNetClient, &BitNetClient::jobCancelled,
+                this, &MainWindow::onBitNetJobCancelled);
+        connect(bitNetClient, &BitNetClient::calibrationFinished, this,
+                [this](int threads, int batchSize) {
+            statusBar()->showMessage(QString("BitNet calibrated: %1 threads, batch %2")
+                                         .arg(threads).arg(batchSize), 5000);
+        });
+        connect(bitNetClient, &BitNetClient::calibrationFailed, this, [this](const QString &error) {
+            statusBar()->showMessage("BitNet calibration failed: " + error, 5000);
+        });
+        connect(bitNetClient, &BitNetClient::inferenceMetricsReady,
+                this, &MainWindow::onInferenceMetrics);
+        connect(bitNetClient, &BitNetClient::warmUpStarted, this, [this]() {
+            m_promptPanel->setModelStatus(tr("Warming up model..."));
+        });
+        connect(bitNetClient, &BitNetClient::warmUpFinished, this, [this](qint64 elapsedMs) {
+            m_promptPanel->setModelStatus(tr("Model ready (warmed up in %1 s)")
+                                              .arg(elapsedMs / 1000.0, 0, 'f', 1));
+        });
+        // The warm-up starts with the application, before this window exists
+        if (bitNetClient->isWarmingUp()) {
+            m_promptPanel->setModelStatus(tr("Warming up model..."));
+        } else if (bitNetClient->isWarm()) {
+            m_promptPanel->setModelStatus(tr("Model ready"));
+        }
     }
 }
 
@@ -220,7 +322,14 @@ void MainWindow::onNewWorld()
 {
     Logger::instance().info("Creating new world...");
     m_currentWorldFile.clear();
+    m_worldSdfFile.clear();
+    m_pendingWorldFile.clear();
+    m_pendingStoreRequest = 0;
+    m_pendingSceneRequest = 0;
+    m_worldPlan = QJsonObject();
+    m_scene.clear();
     m_renderWidget->clearWorld();
+    m_propertyEditor->setScene(m_scene);
     statusBar()->showMessage("New world created", 3000);
 }
 
@@ -233,12 +342,68 @@ void MainWindow::onOpenWorld()
         tr("SDF Files (*.sdf *.world);;All Files (*)")
     );
 
-    if (!fileName.isEmpty()) {
-        Logger::instance().info("Opening world: " + fileName);
-        m_currentWorldFile = fileName;
-        m_renderWidget->loadWorld(fileName);
-        statusBar()->showMessage("World loaded: " + fileName, 3000);
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    Logger::instance().info("Opening world: " + fileName);
+    m_currentWorldFile = fileName;
+
+    // Until the read is done, don't let a save replace the file with the
+    // previous world. The file has no plan, so edit prompts start afresh.
+    m_worldPlan = QJsonObject();
+    m_scene.clear();
+    m_worldSdfFile.clear();
+    m_pendingWorldFile.clear();
+    m_pendingStoreRequest = 0;
+    m_pendingSceneRequest = 0;
+    m_renderWidget->setScene(m_scene);
+    m_propertyEditor->setScene(m_scene);
+    statusBar()->showMessage("Reading world...");
+
+    QStringList resourcePaths;
+    if (FuelFetcher *fuelFetcher = Application::instance().fuelFetcher()) {
+        resourcePaths.append(fuelFetcher->modelCacheDirectory());
     }
+
+    // Large worlds take a moment even from a mapped file; keep it off the UI thread
+    QPointer<MainWindow> self(this);
+    QThread *thread = QThread::create([self, fileName, resourcePaths]() {
+        SDFReader reader;
+        reader.setResourcePaths(resourcePaths);
+        Scene scene;
+        QString error;
+        bool ok = reader.read(fileName, &scene, &error);
+        QString skipped = reader.unsupportedSummary();
+        int missing = int(reader.missingIncludes().size());
+
+        QMetaObject::invokeMethod(self, [self, fileName, ok, scene, error, skipped, missing]() {
+            // Another world may have been opened or created meanwhile
+            if (!self || self->m_currentWorldFile != fileName || !self->m_scene.isEmpty()) {
+                return;
+            }
+            if (!ok) {
+                self->statusBar()->showMessage("Failed to open world: " + error, 5000);
+                return;
+            }
+
+            self->m_scene = scene;
+            self->m_renderWidget->setScene(self->m_scene);
+            self->m_propertyEditor->setScene(self->m_scene);
+            self->m_renderWidget->loadWorld(fileName);
+
+            QString message = QString("World loaded: %1 (%2 models)").arg(fileName).arg(scene.size());
+            if (missing > 0) {
+                message += QString(", %1 includes not found").arg(missing);
+            }
+            if (!skipped.isEmpty()) {
+                message += ", skipped " + skipped;
+            }
+            self->statusBar()->showMessage(message, 8000);
+        }, Qt::QueuedConnection);
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
 }
 
 void MainWindow::onSaveWorld()
@@ -247,8 +412,7 @@ void MainWindow::onSaveWorld()
         onSaveWorldAs();
     } else {
         Logger::instance().info("Saving world: " + m_currentWorldFile);
-        // TODO: Implement actual save functionality
-        statusBar()->showMessage("World saved", 3000);
+        saveWorld(m_currentWorldFile);
     }
 }
 
@@ -264,9 +428,26 @@ void MainWindow::onSaveWorldAs()
     if (!fileName.isEmpty()) {
         m_currentWorldFile = fileName;
         Logger::instance().info("Saving world as: " + fileName);
-        // TODO: Implement actual save functionality
-        statusBar()->showMessage("World saved as: " + fileName, 3000);
+        saveWorld(fileName);
+    }
+}
+
+void MainWindow::saveWorld(const QString &filePath)
+{
+    SDFBuilder *sdfBuilder = Application::instance().sdfBuilder();
+    if (!sdfBuilder) {
+        statusBar()->showMessage("Error: SDF builder not available", 5000);
+        return;
+    }
+    if (m_scene.isEmpty()) {
+        statusBar()->showMessage("Generate a world before saving it", 5000);
+        return;
     }
+
+    // Repeated bodies are written once next to the file; buildComplete
+    // reports when it is done
+    statusBar()->showMessage("Saving world...");
+    sdfBuilder->saveWorldAsync(m_scene, filePath);
 }
 
 void MainWindow::onExportRViz()
@@ -293,7 +474,7 @@ void MainWindow::onAbout()
            "<p>Copyright © 2025 Burma Robotics</p>"));
 }
 
-void MainWindow::onProcessPrompt(const QString &prompt)
+void MainWindow::onProcessPrompt(const QString &prompt, bool bypassCache, bool editCurrentWorld)
 {
     Logger::instance().info("Processing prompt: " + prompt);
     statusBar()->showMessage("Processing prompt with BitNet...");
@@ -301,7 +482,23 @@ void MainWindow::onProcessPrompt(const QString &prompt)
     // Send prompt to BitNet client for processing
     BitNetClient *bitNetClient = Application::instance().bitNetClient();
     if (bitNetClient) {
-        bitNetClient->processPrompt(prompt);
+        // A new interactive prompt supersedes the one still running
+        if (m_promptJobId != 0) {
+            bitNetClient->cancelJob(m_promptJobId);
+        }
+        m_promptIsEdit = editCurrentWorld && !m_worldPlan.isEmpty();
+        if (editCurrentWorld && !m_promptIsEdit) {
+            Logger::instance().info("No world to edit yet, generating a new one");
+        }
+
+        if (m_promptIsEdit) {
+            m_promptJobId = bitNetClient->submitEdit(prompt, m_worldPlan,
+                                                     BitNetClient::Priority::Interactive, bypassCache);
+        } else {
+            m_promptJobId = bitNetClient->submitPrompt(prompt, QStringList(),
+                                                       BitNetClient::Priority::Interactive, bypassCache);
+        }
+        m_promptPanel->setGenerating(m_promptJobId != 0);
     } else {
         Logger::instance().error("BitNetClient not available");
         statusBar()->showMessage("Error: BitNet client not initialized", 5000);
@@ -315,38 +512,247 @@ void MainWindow::onWorldGenerated(const QString &sdfPath)
     statusBar()->showMessage("World generated and loaded", 3000);
 }
 
-void MainWindow::onWorldPlanGenerated(const QJsonObject &worldPlan)
+void MainWindow::onExportRequested(const QString &outputPath, double resolution, int width, int height)
+{
+    RvizConverter *rvizConverter = Application::instance().rvizConverter();
+    if (!rvizConverter) {
+        m_exportPanel->setExportStatus(tr("RViz converter not available"));
+        m_exportPanel->setExportProgress(-1);
+        return;
+    }
+    if (m_scene.isEmpty()) {
+        m_exportPanel->setExportStatus(tr("Generate a world before exporting it"));
+        m_exportPanel->setExportProgress(-1);
+        return;
+    }
+
+    QString baseName = m_currentWorldFile.isEmpty() ? m_scene.worldName()
+                                                    : QFileInfo(m_currentWorldFile).completeBaseName();
+    rvizConverter->convertWorld(m_scene, outputPath, baseName, resolution, width, height);
+}
+
+void MainWindow::onWorldPlanGenerated(quint64 jobId, const QJsonObject &worldPlan)
 {
+    if (jobId != m_promptJobId) {
+        return;
+    }
+
     Logger::instance().info("World plan received from BitNet");
 
-    // Build SDF from world plan
+    // A new world gets its own file; edits update the current one
+    m_worldSdfFile.clear();
+    showWorldPlan(worldPlan);
+}
+
+void MainWindow::onWorldPatchGenerated(quint64 jobId, const QJsonObject &patch)
+{
+    if (jobId != m_promptJobId) {
+        return;
+    }
+
+    QJsonObject editedPlan = m_worldPlan;
+    QStringList changedModels;
+    QString error;
+    if (!WorldPlanPatch::apply(editedPlan, patch, &changedModels, &error)) {
+        Logger::instance().warning("Edit not applied: " + error);
+        statusBar()->showMessage("Edit not applied: " + error, 5000);
+        return;
+    }
+
+    Logger::instance().info("World edit applied to: " + changedModels.join(", "));
+    showWorldPlan(editedPlan);
+}
+
+void MainWindow::showWorldPlan(const QJsonObject &worldPlan)
+{
+    m_worldPlan = worldPlan;
+    m_pendingSceneRequest = 0;
+
     SDFBuilder *sdfBuilder = Application::instance().sdfBuilder();
     if (!sdfBuilder) {
         Logger::instance().error("SDFBuilder not available");
         return;
     }
 
-    QString sdfContent = sdfBuilder->buildWorldSDF(worldPlan);
-    if (sdfContent.isEmpty()) {
+    if (worldPlan.isEmpty()) {
         Logger::instance().error("Failed to build SDF from world plan");
         statusBar()->showMessage("Error: Failed to generate world", 5000);
         return;
     }
 
-    // Save SDF to temporary file
-    QString tempPath = QDir::tempPath() + "/burma_world_" +
-                      QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss") + ".sdf";
+    // Layout generators can make a million models, so the scene is built on
+    // the builder's thread. The preview or previous world stays on screen
+    // meanwhile, but without a scene to edit or save.
+    m_scene.clear();
+    m_propertyEditor->setScene(m_scene);
+    m_pendingSceneRequest = sdfBuilder->buildSceneAsync(worldPlan);
+    statusBar()->showMessage("Building world...");
+}
+
+void MainWindow::onSceneBuilt(quint64 requestId, const Scene &scene)
+{
+    // A newer plan, or an opened or new world, may have replaced this one
+    if (requestId != m_pendingSceneRequest) {
+        return;
+    }
+    m_pendingSceneRequest = 0;
+    m_scene = scene;
+
+    // Replace the streamed preview with the final plan
+    m_renderWidget->setScene(m_scene);
+    m_propertyEditor->setScene(m_scene);
+
+    SDFBuilder *sdfBuilder = Application::instance().sdfBuilder();
+    if (m_worldSdfFile.isEmpty()) {
+        // A new world goes to the store under the hash of its content, so
+        // the same world again costs no writing. Its edits go to the
+        // builder's working file, patched in place.
+        m_worldSdfFile = sdfBuilder->workingWorldPath();
+        m_pendingWorldFile.clear();
+        m_pendingStoreRequest = sdfBuilder->storeWorldAsync(m_scene);
+        statusBar()->showMessage("Writing world...");
+        return;
+    }
+    writeWorldSdf();
+}
+
+void MainWindow::writeWorldSdf()
+{
+    SDFBuilder *sdfBuilder = Application::instance().sdfBuilder();
+    if (!sdfBuilder || m_worldSdfFile.isEmpty() || m_pendingSceneRequest) {
+        return;  // onSceneBuilt writes the new scene once it is there
+    }
+
+    // Written off the GUI thread, re-emitting only the models that changed
+    // since the last write; the world is loaded when buildComplete reports
+    // this path
+    m_pendingWorldFile = m_worldSdfFile;
+    m_pendingStoreRequest = 0;
+    statusBar()->showMessage("Writing world...");
+    sdfBuilder->writeWorldAsync(m_scene, m_worldSdfFile);
+}
+
+void MainWindow::onPropertyChanged(const QString &entityName, const QString &property, const QVariant &value)
+{
+    int index = m_scene.indexOf(entityName);
+    if (index < 0) {
+        return;
+    }
 
-    if (sdfBuilder->saveToFile(sdfContent, tempPath)) {
-        onWorldGenerated(tempPath);
+    // "Position.X" and the like from the transform controls, or a whole
+    // "x, y, z" vector typed into the property tree
+    QString group = property.section('.', 0, 0);
+    QString axis = property.section('.', 1);
+    if (group == "Position" || group == "Rotation" || group == "Scale") {
+        Scene::Vec3 v = group == "Position" ? m_scene.position(index)
+                      : group == "Rotation" ? m_scene.rotation(index)
+                                            : m_scene.scale(index);
+        // Rotations are edited in degrees
+        double factor = group == "Rotation" ? qDegreesToRadians(1.0) : 1.0;
+        if (axis.isEmpty()) {
+            QStringList parts = value.toString().split(',');
+            if (parts.size() != 3) {
+                statusBar()->showMessage("Expected three comma-separated values for " + property, 5000);
+                return;
+            }
+            v = {float(parts[0].trimmed().toDouble() * factor),
+                 float(parts[1].trimmed().toDouble() * factor),
+                 float(parts[2].trimmed().toDouble() * factor)};
+        } else if (axis == "X" || axis == "Roll") {
+            v.x = float(value.toDouble() * factor);
+        } else if (axis == "Y" || axis == "Pitch") {
+            v.y = float(value.toDouble() * factor);
+        } else {
+            v.z = float(value.toDouble() * factor);
+        }
+
+        if (group == "Position") {
+            m_scene.setPosition(index, v);
+        } else if (group == "Rotation") {
+            m_scene.setRotation(index, v);
+        } else {
+            m_scene.setScale(index, v);
+        }
+    } else if (property == "Color") {
+        quint32 rgb = 0;
+        if (!Scene::parseColor(value.toString(), &rgb)) {
+            statusBar()->showMessage("Invalid color: " + value.toString(), 5000);
+            return;
+        }
+        m_scene.setColor(index, rgb);
+    } else if (property == "Static") {
+        m_scene.setStatic(index, value.toBool());
     } else {
-        Logger::instance().error("Failed to save SDF file");
-        statusBar()->showMessage("Error: Failed to save world file", 5000);
+        return;
+    }
+
+    updatePlanModel(index);
+
+    // Applying a transform changes nine properties at once; update the
+    // views and the SDF once they are all in
+    if (!m_sdfUpdateScheduled) {
+        m_sdfUpdateScheduled = true;
+        QTimer::singleShot(0, this, [this]() {
+            m_sdfUpdateScheduled = false;
+            m_renderWidget->setScene(m_scene);
+            m_propertyEditor->setScene(m_scene);
+            writeWorldSdf();
+        });
     }
 }
 
-void MainWindow::onBitNetError(const QString &error)
+void MainWindow::updatePlanModel(int index)
 {
+    // Keep the plan, the base of edit prompts, in step with the scene.
+    // Copies made by a repeat directive have no entry of their own.
+    QJsonArray models = m_worldPlan.value(PlanKey::Models).toArray();
+    for (qsizetype i = 0; i < models.size(); ++i) {
+        QJsonObject model = models.at(i).toObject();
+        if (model.value(PlanKey::Name).toString() != m_scene.name(index)) {
+            continue;
+        }
+
+        // Scene values are floats; an edited 0.3 would otherwise come back as
+        // 0.30000001192092896 in every edit prompt and cache key. Six
+        // significant digits is what the SDF writer keeps.
+        auto plain = [](float value) {
+            return QString::number(value, 'g', 6).toDouble();
+        };
+        const Scene::Vec3 &position = m_scene.position(index);
+        const Scene::Vec3 &rotation = m_scene.rotation(index);
+        const Scene::Vec3 &scale = m_scene.scale(index);
+        model[PlanKey::Position] = QJsonObject{{"x", plain(position.x)}, {"y", plain(position.y)},
+                                               {"z", plain(position.z)}};
+        model[PlanKey::Rotation] = QJsonObject{{"roll", plain(rotation.x)}, {"pitch", plain(rotation.y)},
+                                               {"yaw", plain(rotation.z)}};
+        model[PlanKey::Scale] = QJsonObject{{"x", plain(scale.x)}, {"y", plain(scale.y)},
+                                            {"z", plain(scale.z)}};
+        if (m_scene.hasColor(index)) {
+            model[PlanKey::Color] = Scene::colorName(m_scene.color(index));
+        }
+        model[PlanKey::Static] = m_scene.isStatic(index);
+        models[i] = model;
+        m_worldPlan[PlanKey::Models] = models;
+        return;
+    }
+}
+
+void MainWindow::onModelReceived(quint64 jobId, const QJsonObject &model)
+{
+    if (jobId != m_promptJobId) {
+        return;
+    }
+
+    m_renderWidget->addPreviewModel(model);
+    statusBar()->showMessage("Generating... received " + model.value("name").toString("object"));
+}
+
+void MainWindow::onBitNetError(quint64 jobId, const QString &error)
+{
+    if (jobId != 0 && jobId != m_promptJobId) {
+        return;
+    }
+
     Logger::instance().error("BitNet error: " + error);
     statusBar()->showMessage("Error: " + error, 5000);
 
@@ -354,16 +760,68 @@ void MainWindow::onBitNetError(const QString &error)
                         tr("Failed to process prompt:\n%1\n\nMake sure the BitNet server is running.").arg(error));
 }
 
-void MainWindow::onBitNetProcessingStarted()
+void MainWindow::onBitNetProcessingStarted(quint64 jobId)
 {
+    if (jobId != m_promptJobId) {
+        return;
+    }
+
     Logger::instance().info("BitNet processing started");
+    if (!m_promptIsEdit) {
+        // An edit keeps the current preview until its patch is applied
+        m_renderWidget->setPreviewModels(QJsonArray());
+    }
     statusBar()->showMessage("Processing with BitNet...");
 }
 
-void MainWindow::onBitNetProcessingFinished()
+void MainWindow::onBitNetProcessingFinished(quint64 jobId)
 {
+    if (jobId != m_promptJobId) {
+        return;
+    }
+
     Logger::instance().info("BitNet processing finished");
+    m_promptJobId = 0;
+    m_promptPanel->setGenerating(false);
     statusBar()->showMessage("Processing complete", 3000);
 }
 
+void MainWindow::onBitNetJobCancelled(quint64 jobId)
+{
+    if (jobId != m_promptJobId) {
+        return;
+    }
+
+    statusBar()->showMessage("Generation cancelled", 3000);
+}
+
+void MainWindow::onInferenceMetrics(const InferenceMetrics &metrics)
+{
+    m_metricsLabel->setText(metrics.summary());
+    m_metricsLabel->setToolTip(QString("Job %1, exit code %2, %3 prompt tokens, %4 generated tokens")
+                                   .arg(metrics.jobId)
+                                   .arg(metrics.exitCode)
+                                   .arg(metrics.promptTokens)
+                                   .arg(metrics.generatedTokens));
+}
+
+void MainWindow::onCancelPrompt()
+{
+    BitNetClient *bitNetClient = Application::instance().bitNetClient();
+    if (bitNetClient && m_promptJobId != 0) {
+        bitNetClient->cancelJob(m_promptJobId);
+    }
+}
+
+void MainWindow::onCalibrateBitNet()
+{
+    BitNetClient *bitNetClient = Application::instance().bitNetClient();
+    if (!bitNetClient || !bitNetClient->calibrate()) {
+        statusBar()->showMessage("BitNet calibration unavailable", 3000);
+        return;
+    }
+
+    statusBar()->showMessage("Calibrating BitNet inference...");
+}
+
 } // namespace Burma
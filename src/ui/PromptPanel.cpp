@@ -12,8 +12,12 @@ PromptPanel::PromptPanel(QWidget *parent)
     , m_promptInput(nullptr)
     , m_submitButton(nullptr)
     , m_clearButton(nullptr)
+    , m_cancelButton(nullptr)
+    , m_bypassCacheCheck(nullptr)
+    , m_editModeCheck(nullptr)
     , m_templateCombo(nullptr)
     , m_historyList(nullptr)
+    , m_modelStatusLabel(nullptr)
 {
     setupUi();
     setupTemplates();
@@ -57,11 +61,28 @@ void PromptPanel::setupUi()
     m_clearButton = new QPushButton(tr("Clear"), this);
     m_clearButton->setToolTip(tr("Clear prompt text"));
 
+    m_cancelButton = new QPushButton(tr("Cancel"), this);
+    m_cancelButton->setToolTip(tr("Stop the running generation"));
+    m_cancelButton->setEnabled(false);
+
     buttonLayout->addWidget(m_submitButton);
     buttonLayout->addWidget(m_clearButton);
+    buttonLayout->addWidget(m_cancelButton);
     buttonLayout->addStretch();
 
     promptLayout->addLayout(buttonLayout);
+
+    m_bypassCacheCheck = new QCheckBox(tr("Bypass cache"), this);
+    m_bypassCacheCheck->setToolTip(tr("Always run a fresh inference instead of reusing a cached result"));
+    promptLayout->addWidget(m_bypassCacheCheck);
+
+    m_editModeCheck = new QCheckBox(tr("Edit current world"), this);
+    m_editModeCheck->setToolTip(tr("Change only the models the prompt mentions, e.g. \"move the red box left\""));
+    promptLayout->addWidget(m_editModeCheck);
+
+    m_modelStatusLabel = new QLabel(this);
+    m_modelStatusLabel->setToolTip(tr("Prompts submitted before the model is warm still run, just slower"));
+    promptLayout->addWidget(m_modelStatusLabel);
     mainLayout->addWidget(promptGroup);
 
     // History
@@ -77,6 +98,7 @@ void PromptPanel::setupUi()
     // Connections
     connect(m_submitButton, &QPushButton::clicked, this, &PromptPanel::onSubmitClicked);
     connect(m_clearButton, &QPushButton::clicked, this, &PromptPanel::onClearClicked);
+    connect(m_cancelButton, &QPushButton::clicked, this, &PromptPanel::cancelRequested);
     connect(m_templateCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &PromptPanel::onTemplateSelected);
     connect(m_historyList, &QListWidget::itemClicked,
@@ -118,7 +140,17 @@ void PromptPanel::onSubmitClicked()
     }
 
     addToHistory(prompt);
-    emit promptSubmitted(prompt);
+    emit promptSubmitted(prompt, m_bypassCacheCheck->isChecked(), m_editModeCheck->isChecked());
+}
+
+void PromptPanel::setGenerating(bool generating)
+{
+    m_cancelButton->setEnabled(generating);
+}
+
+void PromptPanel::setModelStatus(const QString &status)
+{
+    m_modelStatusLabel->setText(status);
 }
 
 void PromptPanel::onClearClicked()
@@ -5,12 +5,17 @@
 #include <QLabel>
 #include <QFormLayout>
 #include <QHeaderView>
+#include <QSignalBlocker>
+#include <QtMath>
+
+#include <utility>
 
 namespace Burma {
 
 PropertyEditor::PropertyEditor(QWidget *parent)
     : QWidget(parent)
     , m_propertyTree(nullptr)
+    , m_selectedIndex(-1)
     , m_currentColor(255, 255, 255)
 {
     setupUi();
@@ -169,15 +174,30 @@ QWidget* PropertyEditor::createVisualWidget()
 }
 
 
+void PropertyEditor::setScene(const Scene &scene)
+{
+    m_scene = scene;
+    if (!m_selectedEntity.isEmpty()) {
+        setSelectedEntity(m_selectedEntity);
+    }
+}
+
 void PropertyEditor::setSelectedEntity(const QString &entityName)
 {
     m_selectedEntity = entityName;
+    m_selectedIndex = m_scene.indexOf(entityName);
+    m_currentColor = m_selectedIndex >= 0 && m_scene.hasColor(m_selectedIndex)
+                         ? QColor(m_scene.color(m_selectedIndex)) : QColor(255, 255, 255);
+    m_colorButton->setStyleSheet(
+        QString("QPushButton { background-color: %1; }").arg(m_currentColor.name()));
+    updateTransformControls();
     updatePropertyTree();
 }
 
 void PropertyEditor::clearSelection()
 {
     m_selectedEntity.clear();
+    m_selectedIndex = -1;
     m_propertyTree->clear();
 
     // Reset transform values
@@ -190,29 +210,84 @@ void PropertyEditor::clearSelection()
     m_scaleXSpin->setValue(1.0);
     m_scaleYSpin->setValue(1.0);
     m_scaleZSpin->setValue(1.0);
+    m_loadedValues.clear();
 }
 
 void PropertyEditor::updatePropertyTree()
 {
+    // Filling in the items emits itemChanged, which must only report edits
+    QSignalBlocker blocker(m_propertyTree);
     m_propertyTree->clear();
 
     if (m_selectedEntity.isEmpty()) {
         return;
     }
 
+    // Defaults for an entity that isn't in the generated world
+    Scene::Vec3 position;
+    Scene::Vec3 rotation;
+    Scene::Vec3 scale{1.0f, 1.0f, 1.0f};
+    QString geometry = Scene::geometryName(Scene::Geometry::Box);
+    QString color;   // Empty for a model without a material
+    bool isStatic = false;
+    if (m_selectedIndex >= 0) {
+        position = m_scene.position(m_selectedIndex);
+        rotation = m_scene.rotation(m_selectedIndex);
+        scale = m_scene.scale(m_selectedIndex);
+        geometry = Scene::geometryName(m_scene.geometry(m_selectedIndex));
+        if (m_scene.hasColor(m_selectedIndex)) {
+            color = Scene::colorName(m_scene.color(m_selectedIndex));
+        }
+        isStatic = m_scene.isStatic(m_selectedIndex);
+    }
+    auto format = [](const Scene::Vec3 &v) {
+        return QString("%1, %2, %3").arg(v.x).arg(v.y).arg(v.z);
+    };
+
     // Add property groups
     addPropertyGroup("Transform");
-    addProperty("Transform", "Position", "0, 0, 0");
-    addProperty("Transform", "Rotation", "0, 0, 0");
-    addProperty("Transform", "Scale", "1, 1, 1");
+    addProperty("Transform", "Position", format(position));
+    addProperty("Transform", "Rotation",
+                format({float(qRadiansToDegrees(rotation.x)), float(qRadiansToDegrees(rotation.y)),
+                        float(qRadiansToDegrees(rotation.z))}));
+    addProperty("Transform", "Scale", format(scale));
 
     addPropertyGroup("Visual");
-    addProperty("Visual", "Color", m_currentColor.name());
+    addProperty("Visual", "Geometry", geometry, false);
+    addProperty("Visual", "Color", color);
     addProperty("Visual", "Material", "Default");
 
     addPropertyGroup("Physics");
     addProperty("Physics", "Mass", 1.0);
-    addProperty("Physics", "Static", false);
+    addProperty("Physics", "Static", isStatic);
+}
+
+void PropertyEditor::updateTransformControls()
+{
+    m_loadedValues.clear();
+    if (m_selectedIndex < 0) {
+        return;
+    }
+
+    const Scene::Vec3 &position = m_scene.position(m_selectedIndex);
+    const Scene::Vec3 &rotation = m_scene.rotation(m_selectedIndex);
+    const Scene::Vec3 &scale = m_scene.scale(m_selectedIndex);
+
+    m_posXSpin->setValue(position.x);
+    m_posYSpin->setValue(position.y);
+    m_posZSpin->setValue(position.z);
+    m_rotRSpin->setValue(qRadiansToDegrees(rotation.x));
+    m_rotPSpin->setValue(qRadiansToDegrees(rotation.y));
+    m_rotYawSpin->setValue(qRadiansToDegrees(rotation.z));
+    m_scaleXSpin->setValue(scale.x);
+    m_scaleYSpin->setValue(scale.y);
+    m_scaleZSpin->setValue(scale.z);
+
+    // As rounded by the spin boxes, so Apply can tell which were edited
+    for (QDoubleSpinBox *spin : {m_posXSpin, m_posYSpin, m_posZSpin, m_rotRSpin, m_rotPSpin,
+                                 m_rotYawSpin, m_scaleXSpin, m_scaleYSpin, m_scaleZSpin}) {
+        m_loadedValues.insert(spin, spin->value());
+    }
 }
 
 void PropertyEditor::addPropertyGroup(const QString &groupName)
@@ -245,6 +320,7 @@ void PropertyEditor::addProperty(const QString &group, const QString &name,
     QTreeWidgetItem *propItem = new QTreeWidgetItem(groupItem);
     propItem->setText(0, name);
     propItem->setText(1, value.toString());
+    propItem->setData(1, Qt::UserRole, value.toString());   // Shown value, to skip edits that change nothing
 
     if (editable) {
         propItem->setFlags(propItem->flags() | Qt::ItemIsEditable);
@@ -259,17 +335,23 @@ void PropertyEditor::onPropertyItemChanged(QTreeWidgetItem *item, int column)
         return;
     }
 
-    QString propertyName = item->text(0);
-    QVariant value = item->text(1);
+    QString value = item->text(1);
+    if (value == item->data(1, Qt::UserRole).toString()) {
+        return;
+    }
+    {
+        QSignalBlocker blocker(m_propertyTree);
+        item->setData(1, Qt::UserRole, value);
+    }
 
-    emit propertyChanged(m_selectedEntity, propertyName, value);
+    emit propertyChanged(m_selectedEntity, item->text(0), value);
 }
 
 void PropertyEditor::onColorButtonClicked()
 {
     QColor color = QColorDialog::getColor(m_currentColor, this, tr("Select Entity Color"));
 
-    if (color.isValid()) {
+    if (color.isValid() && color != m_currentColor) {
         m_currentColor = color;
         m_colorButton->setStyleSheet(
             QString("QPushButton { background-color: %1; }").arg(color.name()));
@@ -286,18 +368,19 @@ void PropertyEditor::onApplyTransform()
         return;
     }
 
-    // Emit property changes for transform
-    emit propertyChanged(m_selectedEntity, "Position.X", m_posXSpin->value());
-    emit propertyChanged(m_selectedEntity, "Position.Y", m_posYSpin->value());
-    emit propertyChanged(m_selectedEntity, "Position.Z", m_posZSpin->value());
-
-    emit propertyChanged(m_selectedEntity, "Rotation.Roll", m_rotRSpin->value());
-    emit propertyChanged(m_selectedEntity, "Rotation.Pitch", m_rotPSpin->value());
-    emit propertyChanged(m_selectedEntity, "Rotation.Yaw", m_rotYawSpin->value());
-
-    emit propertyChanged(m_selectedEntity, "Scale.X", m_scaleXSpin->value());
-    emit propertyChanged(m_selectedEntity, "Scale.Y", m_scaleYSpin->value());
-    emit propertyChanged(m_selectedEntity, "Scale.Z", m_scaleZSpin->value());
+    // Emit property changes for the edited transform values only; the others
+    // would come back rounded to the spin boxes' two decimals
+    const std::pair<QDoubleSpinBox*, const char*> controls[] = {
+        {m_posXSpin, "Position.X"}, {m_posYSpin, "Position.Y"}, {m_posZSpin, "Position.Z"},
+        {m_rotRSpin, "Rotation.Roll"}, {m_rotPSpin, "Rotation.Pitch"}, {m_rotYawSpin, "Rotation.Yaw"},
+        {m_scaleXSpin, "Scale.X"}, {m_scaleYSpin, "Scale.Y"}, {m_scaleZSpin, "Scale.Z"}
+    };
+    for (const auto &[spin, property] : controls) {
+        auto loaded = m_loadedValues.constFind(spin);
+        if (loaded == m_loadedValues.constEnd() || *loaded != spin->value()) {
+            emit propertyChanged(m_selectedEntity, property, spin->value());
+        }
+    }
 }
 
 } // namespace Burma
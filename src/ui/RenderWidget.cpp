@@ -3,6 +3,8 @@
 #include <QOpenGLContext>
 #include <QKeyEvent>
 #include <QMatrix4x4>
+#include <QColor>
+#include <QVector4D>
 #include <cmath>
 
 // Helper functions for legacy OpenGL (will be replaced with modern OpenGL later)
@@ -37,6 +39,13 @@ static void gluLookAt(GLdouble eyeX, GLdouble eyeY, GLdouble eyeZ,
 
 namespace Burma {
 
+namespace {
+
+// Wireframes drawn per frame; larger scenes are sampled
+constexpr int kMaxDrawnModels = 5000;
+
+} // namespace
+
 RenderWidget::RenderWidget(QWidget *parent)
     : QOpenGLWidget(parent)
     , m_updateTimer(nullptr)
@@ -108,13 +117,8 @@ void RenderWidget::renderPlaceholderGrid()
     glLoadIdentity();
 
     // Position camera
-    float camX = m_camera.distance * cos(m_camera.elevation * M_PI / 180.0f) *
-                 cos(m_camera.azimuth * M_PI / 180.0f);
-    float camY = m_camera.distance * cos(m_camera.elevation * M_PI / 180.0f) *
-                 sin(m_camera.azimuth * M_PI / 180.0f);
-    float camZ = m_camera.distance * sin(m_camera.elevation * M_PI / 180.0f);
-
-    gluLookAt(camX, camY, camZ,
+    QVector3D eye = cameraPosition();
+    gluLookAt(eye.x(), eye.y(), eye.z(),
               m_camera.targetX, m_camera.targetY, m_camera.targetZ,
               0.0f, 0.0f, 1.0f);
 
@@ -143,6 +147,97 @@ void RenderWidget::renderPlaceholderGrid()
     glVertex3f(0, 0, 0);
     glVertex3f(0, 0, 2);
     glEnd();
+
+    renderPreviewModels();
+}
+
+void RenderWidget::renderPreviewModels()
+{
+    // Unit cube edges, drawn as wireframe bounding boxes
+    static const float corners[8][3] = {
+        {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f},
+        {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}
+    };
+    static const int edges[12][2] = {
+        {0, 1}, {1, 2}, {2, 3}, {3, 0}, {4, 5}, {5, 6},
+        {6, 7}, {7, 4}, {0, 4}, {1, 5}, {2, 6}, {3, 7}
+    };
+
+    auto drawBox = [](const QColor &color) {
+        glColor3f(color.redF(), color.greenF(), color.blueF());
+        glBegin(GL_LINES);
+        for (const auto &edge : edges) {
+            glVertex3fv(corners[edge[0]]);
+            glVertex3fv(corners[edge[1]]);
+        }
+        glEnd();
+    };
+
+    auto drawModel = [&](int i) {
+        const Scene::Vec3 &pos = m_scene.position(i);
+        const Scene::Vec3 &scale = m_scene.scale(i);
+
+        float sx = scale.x;
+        float sy = scale.y;
+        float sz = scale.z;
+        if (m_scene.geometry(i) == Scene::Geometry::Sphere) {
+            sx = sy = sz = 2.0f * scale.x;
+        } else if (m_scene.geometry(i) == Scene::Geometry::Cylinder) {
+            sx = sy = 2.0f * scale.x;
+        }
+
+        QColor color = i == m_selectedIndex ? QColor(Qt::yellow)
+                     : m_scene.hasColor(i) ? QColor(m_scene.color(i)) : QColor(Qt::white);
+
+        glPushMatrix();
+        glTranslatef(pos.x, pos.y, pos.z);
+        glRotatef(m_scene.rotation(i).z * 180.0 / M_PI, 0.0f, 0.0f, 1.0f);
+        glScalef(sx, sy, sz);
+        drawBox(color);
+        glPopMatrix();
+    };
+
+    // Each box is its own batch of immediate mode calls, so a generated
+    // world of up to a million models is thinned to an even sample, drawn
+    // inside the bounds of the whole
+    int count = m_scene.size();
+    int stride = drawStride();
+    for (int i = 0; i < count; i += stride) {
+        drawModel(i);
+    }
+    if (stride > 1) {
+        if (m_selectedIndex >= 0 && m_selectedIndex % stride != 0) {
+            drawModel(m_selectedIndex);
+        }
+
+        if (!m_boundsValid) {
+            updateBounds();
+        }
+        glPushMatrix();
+        glTranslatef((m_boundsMin.x + m_boundsMax.x) / 2.0f, (m_boundsMin.y + m_boundsMax.y) / 2.0f,
+                     (m_boundsMin.z + m_boundsMax.z) / 2.0f);
+        glScalef(qMax(m_boundsMax.x - m_boundsMin.x, 0.01f), qMax(m_boundsMax.y - m_boundsMin.y, 0.01f),
+                 qMax(m_boundsMax.z - m_boundsMin.z, 0.01f));
+        drawBox(QColor(Qt::gray));
+        glPopMatrix();
+    }
+}
+
+int RenderWidget::drawStride() const
+{
+    return qMax(1, (m_scene.size() + kMaxDrawnModels - 1) / kMaxDrawnModels);
+}
+
+void RenderWidget::updateBounds()
+{
+    // Of the model origins; computed once per scene, not per frame
+    m_boundsMin = m_boundsMax = m_scene.isEmpty() ? Scene::Vec3() : m_scene.position(0);
+    for (int i = 1; i < m_scene.size(); ++i) {
+        const Scene::Vec3 &p = m_scene.position(i);
+        m_boundsMin = {qMin(m_boundsMin.x, p.x), qMin(m_boundsMin.y, p.y), qMin(m_boundsMin.z, p.z)};
+        m_boundsMax = {qMax(m_boundsMax.x, p.x), qMax(m_boundsMax.y, p.y), qMax(m_boundsMax.z, p.z)};
+    }
+    m_boundsValid = true;
 }
 
 void RenderWidget::initializeGazeboRenderer()
@@ -181,6 +276,55 @@ void RenderWidget::updateCamera()
     update();
 }
 
+QVector3D RenderWidget::cameraPosition() const
+{
+    return QVector3D(m_camera.distance * cos(m_camera.elevation * M_PI / 180.0f) *
+                         cos(m_camera.azimuth * M_PI / 180.0f),
+                     m_camera.distance * cos(m_camera.elevation * M_PI / 180.0f) *
+                         sin(m_camera.azimuth * M_PI / 180.0f),
+                     m_camera.distance * sin(m_camera.elevation * M_PI / 180.0f));
+}
+
+QMatrix4x4 RenderWidget::viewProjection() const
+{
+    // The same transform renderPlaceholderGrid() sets up
+    QMatrix4x4 matrix;
+    matrix.perspective(45.0f, static_cast<float>(width()) / static_cast<float>(height()), 0.1f, 100.0f);
+    matrix.lookAt(cameraPosition(), QVector3D(m_camera.targetX, m_camera.targetY, m_camera.targetZ),
+                  QVector3D(0.0f, 0.0f, 1.0f));
+    return matrix;
+}
+
+int RenderWidget::pickModel(const QPoint &pos) const
+{
+    // Of the drawn origins within a few pixels of the click, the nearest to
+    // the camera
+    const float radius = 12.0f;
+    QMatrix4x4 matrix = viewProjection();
+    int picked = -1;
+    float pickedDepth = 0.0f;
+    int stride = drawStride();
+    for (int i = 0; i < m_scene.size(); i += stride) {
+        const Scene::Vec3 &p = m_scene.position(i);
+        QVector4D clip = matrix * QVector4D(p.x, p.y, p.z, 1.0f);
+        if (clip.w() <= 0.0f) {
+            continue;   // Behind the camera
+        }
+        float depth = clip.z() / clip.w();
+        if (depth > 1.0f) {
+            continue;   // Past the far plane, not drawn
+        }
+        float x = (clip.x() / clip.w() + 1.0f) * 0.5f * width();
+        float y = (1.0f - clip.y() / clip.w()) * 0.5f * height();
+        if (std::abs(x - pos.x()) <= radius && std::abs(y - pos.y()) <= radius
+            && (picked < 0 || depth < pickedDepth)) {
+            picked = i;
+            pickedDepth = depth;
+        }
+    }
+    return picked;
+}
+
 void RenderWidget::loadWorld(const QString &worldFile)
 {
     Logger::instance().info("Loading world: " + worldFile);
@@ -198,6 +342,9 @@ void RenderWidget::clearWorld()
 {
     Logger::instance().info("Clearing world");
     m_currentWorld.clear();
+    m_scene.clear();
+    m_selectedIndex = -1;
+    m_boundsValid = false;
 
 #ifdef HAVE_GAZEBO_RENDERING
     // TODO: Clear Gazebo scene
@@ -206,11 +353,45 @@ void RenderWidget::clearWorld()
     update();
 }
 
+void RenderWidget::addPreviewModel(const QJsonObject &model)
+{
+    // Within the limit the final scene has too
+    m_scene.appendModels(QJsonArray{model}, Scene::kMaxModels - m_scene.size());
+    m_boundsValid = false;
+    m_selectedIndex = m_scene.indexOf(m_selectedEntity);
+    update();
+}
+
+void RenderWidget::setPreviewModels(const QJsonArray &models)
+{
+    m_scene = Scene::fromModels(models);
+    m_boundsValid = false;
+    m_selectedIndex = m_scene.indexOf(m_selectedEntity);
+    update();
+}
+
+void RenderWidget::setScene(const Scene &scene)
+{
+    m_scene = scene;
+    m_boundsValid = false;
+    m_selectedIndex = m_scene.indexOf(m_selectedEntity);
+    update();
+}
+
+void RenderWidget::setSelectedEntity(const QString &entityName)
+{
+    m_selectedEntity = entityName;
+    m_selectedIndex = m_scene.indexOf(entityName);
+    update();
+}
+
 void RenderWidget::mousePressEvent(QMouseEvent *event)
 {
     m_lastMousePos = event->pos();
 
-    if (event->button() == Qt::MiddleButton) {
+    if (event->button() == Qt::LeftButton) {
+        m_pressPos = event->pos();
+    } else if (event->button() == Qt::MiddleButton) {
         m_isRotating = true;
     } else if (event->button() == Qt::RightButton) {
         m_isPanning = true;
@@ -241,7 +422,13 @@ void RenderWidget::mouseMoveEvent(QMouseEvent *event)
 
 void RenderWidget::mouseReleaseEvent(QMouseEvent *event)
 {
-    if (event->button() == Qt::MiddleButton) {
+    if (event->button() == Qt::LeftButton) {
+        if ((event->pos() - m_pressPos).manhattanLength() <= 3) {
+            int picked = pickModel(event->pos());
+            setSelectedEntity(picked >= 0 ? m_scene.name(picked) : QString());
+            emit selectionChanged(m_selectedEntity);
+        }
+    } else if (event->button() == Qt::MiddleButton) {
         m_isRotating = false;
     } else if (event->button() == Qt::RightButton) {
         m_isPanning = false;
@@ -0,0 +1,194 @@
+#include "utils/JsonExtractor.h"
+
+#include <QJsonDocument>
+#include <QVarLengthArray>
+
+#include <cstring>
+
+namespace Burma {
+
+namespace {
+
+bool isScalarChar(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.'
+           || c == 'E';
+}
+
+// A bare token that can stand as a complete value: a literal, or a number
+// that doesn't end halfway (e.g. "1." or "2e")
+bool isCompleteScalar(const char *token, qsizetype length)
+{
+    switch (length) {
+    case 4:
+        if (std::memcmp(token, "true", 4) == 0 || std::memcmp(token, "null", 4) == 0) {
+            return true;
+        }
+        break;
+    case 5:
+        if (std::memcmp(token, "false", 5) == 0) {
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    char last = token[length - 1];
+    char first = token[0];
+    return last >= '0' && last <= '9' && ((first >= '0' && first <= '9') || first == '-');
+}
+
+} // namespace
+
+JsonExtractor::Result JsonExtractor::scan(const char *data, qsizetype size)
+{
+    Result result;
+
+    const char *begin = static_cast<const char*>(std::memchr(data, '{', size));
+    if (!begin) {
+        return result;
+    }
+    result.begin = begin - data;
+
+    // Closing bracket of each open container, and whether an object
+    // expects a key (before ':') or a value (after it)
+    QVarLengthArray<char, 32> closers;
+    QVarLengthArray<bool, 32> expectKey;
+
+    // Last offset where the document could be cut and closed, and the
+    // nesting depth there. Only containers opened later are deeper, so the
+    // closers for a cut are always a prefix of the current stack.
+    qsizetype safeEnd = -1;
+    qsizetype safeDepth = 0;
+
+    bool inString = false;
+    bool escaped = false;
+    qsizetype scalarStart = -1;
+
+    auto markSafe = [&](qsizetype offset) {
+        safeEnd = offset;
+        safeDepth = closers.size();
+    };
+
+    for (qsizetype i = result.begin; i < size; ++i) {
+        char c = data[i];
+
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+                // A key alone can't end an object; a value string can
+                if (closers.back() == ']' || !expectKey.back()) {
+                    markSafe(i + 1);
+                }
+            }
+            continue;
+        }
+
+        if (scalarStart >= 0) {
+            if (isScalarChar(c)) {
+                continue;
+            }
+            if (isCompleteScalar(data + scalarStart, i - scalarStart)) {
+                markSafe(i);
+            }
+            scalarStart = -1;
+        }
+
+        switch (c) {
+        case '"':
+            inString = true;
+            break;
+        case '{':
+        case '[':
+            closers.append(c == '{' ? '}' : ']');
+            expectKey.append(c == '{');
+            markSafe(i + 1);
+            break;
+        case '}':
+        case ']':
+            if (closers.back() != c) {
+                // Mismatched bracket: keep what was valid up to here
+                i = size;
+                break;
+            }
+            closers.removeLast();
+            expectKey.removeLast();
+            if (closers.isEmpty()) {
+                result.end = i + 1;
+                return result;
+            }
+            markSafe(i + 1);
+            break;
+        case ':':
+            expectKey.back() = false;
+            break;
+        case ',':
+            if (closers.back() == '}') {
+                expectKey.back() = true;
+            }
+            break;
+        default:
+            if (isScalarChar(c)) {
+                scalarStart = i;
+            }
+            break;
+        }
+    }
+
+    // Truncated: a trailing number or literal still counts if it is whole
+    if (scalarStart >= 0 && !inString && isCompleteScalar(data + scalarStart, size - scalarStart)) {
+        markSafe(size);
+    }
+
+    if (safeEnd < 0) {
+        return result;
+    }
+    result.end = safeEnd;
+    result.closing.reserve(safeDepth);
+    for (qsizetype depth = safeDepth - 1; depth >= 0; --depth) {
+        result.closing.append(closers[depth]);
+    }
+    return result;
+}
+
+QJsonObject JsonExtractor::parse(const QByteArray &bytes, QString *error)
+{
+    return parse(bytes, scan(bytes), error);
+}
+
+QJsonObject JsonExtractor::parse(const QByteArray &bytes, const Result &range, QString *error)
+{
+    if (!range.found()) {
+        if (error) {
+            *error = "no JSON object found";
+        }
+        return QJsonObject();
+    }
+
+    QByteArray json;
+    if (range.isComplete()) {
+        // Parse straight out of the caller's buffer
+        json = QByteArray::fromRawData(bytes.constData() + range.begin, range.end - range.begin);
+    } else {
+        json.reserve(range.end - range.begin + range.closing.size());
+        json.append(bytes.constData() + range.begin, range.end - range.begin);
+        json.append(range.closing);
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        if (error) {
+            *error = parseError.error != QJsonParseError::NoError ? parseError.errorString()
+                                                                 : QString("not an object");
+        }
+        return QJsonObject();
+    }
+    return doc.object();
+}
+
+} // namespace Burma
@@ -0,0 +1,115 @@
+#include "utils/JsonStreamParser.h"
+
+#include <QJsonDocument>
+
+namespace Burma {
+
+JsonStreamParser::JsonStreamParser(const QByteArray &arrayKey)
+    : m_arrayKey(arrayKey)
+{
+    reset();
+}
+
+void JsonStreamParser::reset()
+{
+    m_document.clear();
+    m_key.clear();
+    m_entries.clear();
+    m_depth = 0;
+    m_inString = false;
+    m_escaped = false;
+    m_expectKey = false;
+    m_inArray = false;
+    m_entryStart = -1;
+    m_complete = false;
+}
+
+void JsonStreamParser::feed(const QByteArray &chunk)
+{
+    for (char c : chunk) {
+        if (m_complete) {
+            return;
+        }
+
+        // Ignore any preamble before the top-level object
+        if (m_depth == 0 && c != '{') {
+            continue;
+        }
+
+        m_document.append(c);
+
+        if (m_inString) {
+            if (m_escaped) {
+                m_escaped = false;
+            } else if (c == '\\') {
+                m_escaped = true;
+            } else if (c == '"') {
+                m_inString = false;
+                if (m_depth == 1 && m_expectKey) {
+                    m_expectKey = false;
+                }
+            } else if (m_depth == 1 && m_expectKey) {
+                m_key.append(c);
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            m_inString = true;
+            if (m_depth == 1 && m_expectKey) {
+                m_key.clear();
+            }
+            break;
+        case '{':
+            ++m_depth;
+            if (m_depth == 1) {
+                m_expectKey = true;
+            } else if (m_depth == 3 && m_inArray) {
+                m_entryStart = m_document.size() - 1;
+            }
+            break;
+        case '[':
+            ++m_depth;
+            if (m_depth == 2 && m_key == m_arrayKey) {
+                m_inArray = true;
+            }
+            break;
+        case '}':
+            --m_depth;
+            if (m_depth == 2 && m_inArray && m_entryStart >= 0) {
+                QByteArray entry = m_document.mid(m_entryStart);
+                QJsonDocument doc = QJsonDocument::fromJson(entry);
+                if (doc.isObject()) {
+                    m_entries.append(doc.object());
+                }
+                m_entryStart = -1;
+            } else if (m_depth == 0) {
+                m_complete = true;
+            }
+            break;
+        case ']':
+            --m_depth;
+            if (m_depth == 1) {
+                m_inArray = false;
+            }
+            break;
+        case ',':
+            if (m_depth == 1) {
+                m_expectKey = true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+QList<QJsonObject> JsonStreamParser::takeEntries()
+{
+    QList<QJsonObject> entries;
+    entries.swap(m_entries);
+    return entries;
+}
+
+} // namespace Burma
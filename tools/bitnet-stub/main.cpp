@@ -0,0 +1,237 @@
+// Stand-in for llama-cli that needs no model. Point BURMA_BITNET_CLI at it
+// (with BURMA_BITNET_WORKER=0) to drive the whole pipeline deterministically.
+//
+// Behaviour is configured through the environment:
+//   BURMA_STUB_REPLAY       file with a recorded llama-cli output to replay
+//   BURMA_STUB_MODELS       models in the synthetic world plan (default 8); only
+//                           as many as fit in the -n token budget are written
+//   BURMA_STUB_LOAD_MS      simulated model load time (default 0)
+//   BURMA_STUB_TOKENS_PER_SEC  generation rate, 0 for as fast as possible (default 0)
+//   BURMA_STUB_MODE         "plan" (default), "truncate" (stop halfway through)
+//                           or "garbage" (text that is not JSON)
+//
+// Output is a pure function of the prompt and these settings. A llama-style
+// timing summary is printed on stderr so the client's metrics parsing is
+// exercised too.
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <utility>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+QString argumentValue(const QStringList &arguments, const QString &flag)
+{
+    int index = arguments.indexOf(flag);
+    return index >= 0 && index + 1 < arguments.size() ? arguments.at(index + 1) : QString();
+}
+
+std::mt19937 seededGenerator(const QString &prompt)
+{
+    QByteArray digest = QCryptographicHash::hash(prompt.toUtf8(), QCryptographicHash::Sha1);
+    std::seed_seq seed(digest.begin(), digest.end());
+    return std::mt19937(seed);
+}
+
+using Member = std::pair<const char *, QByteArray>;
+
+// Members in the given order, as the grammar makes the model write them;
+// QJsonDocument would sort the keys
+QByteArray object(std::initializer_list<Member> members)
+{
+    QByteArray json = "{";
+    for (const Member &member : members) {
+        if (json.size() > 1) {
+            json += ',';
+        }
+        json += '"' + QByteArray(member.first) + "\":" + member.second;
+    }
+    return json + '}';
+}
+
+QByteArray string(const QString &text)
+{
+    return '"' + text.toUtf8() + '"';
+}
+
+QByteArray number(double value)
+{
+    return QByteArray::number(value);
+}
+
+QByteArray vector3(const char *a, double x, const char *b, double y, const char *c, double z)
+{
+    return object({{a, number(x)}, {b, number(y)}, {c, number(z)}});
+}
+
+QByteArray syntheticModel(std::mt19937 &rng, int index)
+{
+    static const char *types[] = {"box", "sphere", "cylinder"};
+    std::uniform_real_distribution<double> coordinate(-20.0, 20.0);
+    std::uniform_real_distribution<double> size(0.2, 3.0);
+
+    QString type = types[rng() % 3];
+    double x = qRound(coordinate(rng) * 10) / 10.0;
+    double y = qRound(coordinate(rng) * 10) / 10.0;
+    double sx = qRound(size(rng) * 10) / 10.0;
+    double sy = qRound(size(rng) * 10) / 10.0;
+    double sz = qRound(size(rng) * 10) / 10.0;
+    QString color = QString("#%1").arg(rng() % 0x1000000, 6, 16, QChar('0')).toUpper();
+
+    return object({
+        {"name", string(QString("object_%1").arg(index))},
+        {"type", string(type)},
+        {"position", vector3("x", x, "y", y, "z", 0.5)},
+        {"rotation", vector3("roll", 0, "pitch", 0, "yaw", 0)},
+        {"scale", vector3("x", sx, "y", sy, "z", sz)},
+        {"color", string(color)},
+        {"static", "true"}
+    });
+}
+
+// Schema order. Models stop where the next would not fit in maxBytes, so
+// the plan always closes within the client's token budget, as a
+// grammar-constrained model's would; at least one is written regardless.
+QByteArray syntheticPlan(std::mt19937 &rng, int modelCount, int maxBytes)
+{
+    QByteArray sun = object({
+        {"name", string("sun")},
+        {"type", string("directional")},
+        {"position", vector3("x", 0, "y", 0, "z", 10)}
+    });
+    QByteArray physics = object({
+        {"gravity", string("0 0 -9.81")},
+        {"max_step_size", number(0.001)}
+    });
+
+    QByteArray head = "{\"world_name\":" + string("stub_world") + ",\"models\":[";
+    QByteArray tail = "],\"lighting\":[" + sun + "],\"physics\":" + physics + "}";
+
+    QByteArray models;
+    for (int i = 0; i < modelCount; ++i) {
+        QByteArray model = syntheticModel(rng, i);
+        qsizetype size = head.size() + models.size() + (i > 0 ? 1 : 0) + model.size() + tail.size();
+        if (i > 0 && maxBytes > 0 && size > maxBytes) {
+            break;
+        }
+        if (i > 0) {
+            models += ',';
+        }
+        models += model;
+    }
+    return head + models + tail;
+}
+
+QByteArray syntheticPatch(std::mt19937 &rng)
+{
+    double x = double(rng() % 20);
+    double y = double(rng() % 20);
+    QByteArray operation = object({
+        {"op", string("modify")},
+        {"name", string("object_0")},
+        {"position", vector3("x", x, "y", y, "z", 0.5)}
+    });
+    return object({{"operations", "[" + operation + "]"}});
+}
+
+QByteArray garbage(std::mt19937 &rng, int length)
+{
+    static const char words[][8] = {"world", "the", "shelf", "robot", "of", "and", "a", "floor"};
+    QByteArray text;
+    while (text.size() < length) {
+        text += words[rng() % 8];
+        text += ' ';
+    }
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList arguments = app.arguments();
+    const Clock::time_point start = Clock::now();
+
+    // Roughly four bytes per token, like a BPE vocabulary on JSON
+    constexpr int kBytesPerToken = 4;
+
+    QString prompt = argumentValue(arguments, "-p");
+    int maxTokens = argumentValue(arguments, "-n").toInt();
+    bool edit = prompt.contains("\nEdit: ");
+
+    int loadMs = qEnvironmentVariableIntValue("BURMA_STUB_LOAD_MS");
+    int tokensPerSec = qEnvironmentVariableIntValue("BURMA_STUB_TOKENS_PER_SEC");
+    bool modelsSet = false;
+    int modelCount = qEnvironmentVariableIntValue("BURMA_STUB_MODELS", &modelsSet);
+    QByteArray mode = qgetenv("BURMA_STUB_MODE");
+    QString replayPath = qEnvironmentVariable("BURMA_STUB_REPLAY");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(loadMs));
+    double loadTime = elapsedMs(start);
+
+    // Prompt evaluation is not simulated; it only has to be cheap and measurable
+    const Clock::time_point evalStart = Clock::now();
+    std::mt19937 rng = seededGenerator(prompt);
+    int promptTokens = prompt.size() / 4;
+
+    QByteArray output;
+    if (!replayPath.isEmpty()) {
+        QFile replay(replayPath);
+        if (!replay.open(QIODevice::ReadOnly)) {
+            std::fprintf(stderr, "bitnet-stub: cannot open %s\n", qPrintable(replayPath));
+            return 1;
+        }
+        output = replay.readAll();
+    } else if (mode == "garbage") {
+        output = garbage(rng, 400);
+    } else {
+        output = edit ? syntheticPatch(rng)
+                      : syntheticPlan(rng, modelsSet ? modelCount : 8, qMax(0, maxTokens) * kBytesPerToken);
+    }
+    if (mode == "truncate") {
+        output.truncate(output.size() / 2);
+    }
+    double promptTime = elapsedMs(evalStart);
+
+    int tokens = (output.size() + kBytesPerToken - 1) / kBytesPerToken;
+    if (maxTokens > 0 && tokens > maxTokens) {
+        tokens = maxTokens;
+        output.truncate(tokens * kBytesPerToken);
+    }
+
+    const Clock::time_point generationStart = Clock::now();
+    for (int i = 0; i < tokens; ++i) {
+        if (tokensPerSec > 0) {
+            std::this_thread::sleep_until(generationStart + std::chrono::microseconds(
+                                                                qint64(i) * 1000000 / tokensPerSec));
+        }
+        std::fwrite(output.constData() + i * kBytesPerToken, 1,
+                    std::min<qsizetype>(kBytesPerToken, output.size() - i * kBytesPerToken), stdout);
+        std::fflush(stdout);
+    }
+    double generationTime = elapsedMs(generationStart);
+
+    std::fprintf(stderr, "\nllama_print_timings:        load time = %10.2f ms\n", loadTime);
+    std::fprintf(stderr, "llama_print_timings: prompt eval time = %10.2f ms / %5d tokens\n",
+                 promptTime, promptTokens);
+    std::fprintf(stderr, "llama_print_timings:        eval time = %10.2f ms / %5d runs\n",
+                 generationTime, tokens);
+    std::fprintf(stderr, "llama_print_timings:       total time = %10.2f ms\n", elapsedMs(start));
+    return 0;
+}
@@ -0,0 +1,208 @@
+// Fuzzing and throughput benchmark for JsonExtractor, the parser that pulls
+// the world plan out of raw LLM output.
+//
+// The fuzz pass cuts and mutates synthetic outputs and checks that the
+// extractor stays in bounds and that every truncation of a valid plan is
+// repaired into valid JSON. The benchmark compares it with the previous
+// QString-based extraction on multi-megabyte outputs.
+
+#include "utils/JsonExtractor.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace Burma;
+
+namespace {
+
+// Names that trip up naive brace counting
+const char *const kTrickyNames[] = {
+    "shelf {A}", "pallet ]", "crate \"large\"", "box \\ back", "café table", "door [1",
+};
+
+QByteArray syntheticOutput(QRandomGenerator &random, int models, bool indented)
+{
+    QJsonArray modelArray;
+    for (int i = 0; i < models; ++i) {
+        QJsonObject model;
+        model["name"] = QString("%1_%2").arg(kTrickyNames[random.bounded(6)]).arg(i);
+        model["type"] = random.bounded(2) ? "box" : "cylinder";
+        model["position"] = QJsonArray{random.bounded(100.0) - 50.0, random.bounded(100.0) - 50.0, 0};
+        model["size"] = QJsonArray{1 + random.bounded(3), 0.5, 2.25e-1};
+        model["static"] = random.bounded(2) == 1;
+        model["color"] = QJsonValue();
+        modelArray.append(model);
+    }
+    QJsonObject plan;
+    plan["world_name"] = "bench_world";
+    plan["models"] = modelArray;
+    plan["lighting"] = QJsonObject{{"ambient", QJsonArray{0.4, 0.4, 0.4}}};
+
+    // llama-cli echoes the prompt and prints stats around the plan
+    QByteArray output = "main: prompt evaluated\nWorld plan:\n";
+    output += QJsonDocument(plan).toJson(indented ? QJsonDocument::Indented : QJsonDocument::Compact);
+    output += "\n[end of text]\n";
+    return output;
+}
+
+// The extraction parseResponse used before: first '{' to last '}', then
+// closing brackets by count
+QJsonObject legacyParse(const QString &output)
+{
+    int jsonStart = output.indexOf('{');
+    int jsonEnd = output.lastIndexOf('}');
+    if (jsonStart == -1 || jsonEnd == -1 || jsonStart >= jsonEnd) {
+        return QJsonObject();
+    }
+    QString jsonStr = output.mid(jsonStart, jsonEnd - jsonStart + 1);
+    for (int i = jsonStr.count('{') - jsonStr.count('}'); i > 0; --i) {
+        jsonStr.append("}");
+    }
+    for (int i = jsonStr.count('[') - jsonStr.count(']'); i > 0; --i) {
+        jsonStr.append("]");
+    }
+    return QJsonDocument::fromJson(jsonStr.toUtf8()).object();
+}
+
+bool inBounds(const JsonExtractor::Result &range, qsizetype size)
+{
+    return !range.found() || (range.begin >= 0 && range.end <= size && range.begin < range.end);
+}
+
+int fuzz(int iterations, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    int failures = 0;
+    auto fail = [&failures](int iteration, const char *what, const QByteArray &input) {
+        if (++failures <= 10) {
+            std::fprintf(stderr, "iteration %d: %s\n  input: %s\n", iteration, what,
+                         input.left(200).constData());
+        }
+    };
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        QByteArray output = syntheticOutput(random, 1 + random.bounded(12), random.bounded(2));
+        QJsonObject expected = JsonExtractor::parse(output);
+        if (expected.isEmpty()) {
+            fail(iteration, "complete output not parsed", output);
+            continue;
+        }
+
+        // Every prefix that reaches the first value must repair to valid JSON
+        qsizetype jsonStart = output.indexOf('{');
+        qsizetype cut = jsonStart + 1 + random.bounded(int(output.size() - jsonStart));
+        QByteArray truncated = output.left(cut);
+        JsonExtractor::Result range = JsonExtractor::scan(truncated);
+        if (!inBounds(range, truncated.size())) {
+            fail(iteration, "truncated range out of bounds", truncated);
+        } else if (!range.found()) {
+            fail(iteration, "truncated object not found", truncated);
+        } else {
+            QByteArray repaired = truncated.mid(range.begin, range.end - range.begin) + range.closing;
+            QJsonParseError error;
+            QJsonDocument::fromJson(repaired, &error);
+            if (error.error != QJsonParseError::NoError) {
+                fail(iteration, "repair is not valid JSON", repaired);
+            }
+        }
+
+        // Random damage must never crash or read out of bounds
+        QByteArray mutated = output;
+        for (int edits = 1 + random.bounded(8); edits > 0; --edits) {
+            qsizetype at = random.bounded(int(mutated.size()));
+            switch (random.bounded(3)) {
+            case 0:
+                mutated[at] = "{}[]\",:\\ x1"[random.bounded(11)];
+                break;
+            case 1:
+                mutated.remove(at, 1 + random.bounded(4));
+                break;
+            default:
+                mutated.insert(at, char(random.bounded(256)));
+                break;
+            }
+            if (mutated.isEmpty()) {
+                break;
+            }
+        }
+        if (!inBounds(JsonExtractor::scan(mutated), mutated.size())) {
+            fail(iteration, "mutated range out of bounds", mutated);
+        }
+        JsonExtractor::parse(mutated);
+    }
+
+    std::printf("fuzz: %d iterations, %d failures (seed %u)\n", iterations, failures, seed);
+    return failures;
+}
+
+void bench(int megabytes, int runs)
+{
+    QRandomGenerator random(1);
+    QByteArray output;
+    int models = 256;
+    while (output.size() < qsizetype(megabytes) * 1024 * 1024) {
+        output = syntheticOutput(random, models, true);
+        models *= 2;
+    }
+    // Drop the closing half of the last model so the repair path runs too
+    QByteArray truncated = output.left(output.lastIndexOf("\"static\""));
+
+    auto measure = [runs](const char *name, qsizetype bytes, const auto &parse) {
+        std::vector<double> samples;
+        bool ok = true;
+        for (int run = 0; run < runs; ++run) {
+            QElapsedTimer timer;
+            timer.start();
+            ok = !parse().isEmpty() && ok;
+            samples.push_back(timer.nsecsElapsed() / 1e6);
+        }
+        std::sort(samples.begin(), samples.end());
+        double median = samples[samples.size() / 2];
+        std::printf("%-28s %10.3f %10.1f %6s\n", name, median, bytes / 1048576.0 / (median / 1000.0),
+                    ok ? "ok" : "FAILED");
+    };
+
+    std::printf("\n%.1f MB output, median of %d runs\n\n", output.size() / 1048576.0, runs);
+    std::printf("%-28s %10s %10s %6s\n", "parser", "ms", "MB/s", "");
+    measure("scan only", output.size(), [&output]() {
+        return JsonExtractor::scan(output).found() ? QJsonObject{{"ok", true}} : QJsonObject();
+    });
+    measure("extractor", output.size(), [&output]() { return JsonExtractor::parse(output); });
+    measure("extractor (truncated)", truncated.size(), [&truncated]() { return JsonExtractor::parse(truncated); });
+    measure("legacy", output.size(), [&output]() { return legacyParse(QString::fromUtf8(output)); });
+    measure("legacy (truncated)", truncated.size(),
+            [&truncated]() { return legacyParse(QString::fromUtf8(truncated)); });
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("json-extract-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Fuzz and benchmark the LLM output parser");
+    parser.addHelpOption();
+    QCommandLineOption fuzzOption("fuzz", "Fuzz iterations, 0 to skip.", "n", "20000");
+    QCommandLineOption seedOption("seed", "Fuzz seed.", "n", "1");
+    QCommandLineOption sizeOption("megabytes", "Benchmark output size, 0 to skip.", "n", "8");
+    QCommandLineOption runsOption("runs", "Benchmark runs per parser.", "n", "10");
+    parser.addOptions({fuzzOption, seedOption, sizeOption, runsOption});
+    parser.process(app);
+
+    int failures = fuzz(parser.value(fuzzOption).toInt(), parser.value(seedOption).toUInt());
+    if (parser.value(sizeOption).toInt() > 0) {
+        bench(parser.value(sizeOption).toInt(), qMax(1, parser.value(runsOption).toInt()));
+    }
+    return failures == 0 ? 0 : 1;
+}
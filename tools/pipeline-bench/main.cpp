@@ -0,0 +1,217 @@
+// End-to-end latency benchmark of the prompt -> plan -> SDF -> world pipeline.
+// Inference runs through the bitnet-stub backend, so no model is required
+// and the numbers isolate our own overhead: process handling, stream and
+// JSON parsing, SDF generation, saving and reading the world back.
+
+#include "modules/BitNetClient.h"
+#include "modules/InferenceMetrics.h"
+#include "modules/SDFBuilder.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+using namespace Burma;
+
+namespace {
+
+// Stage name -> one sample per run, in milliseconds
+using Samples = std::map<QString, std::vector<double>>;
+
+double percentile(std::vector<double> values, double fraction)
+{
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, size_t(fraction * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+// Read the world back the way a loader would: parse every element
+int loadWorld(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    int models = 0;
+    QXmlStreamReader xml(&file);
+    while (!xml.atEnd()) {
+        if (xml.readNext() == QXmlStreamReader::StartElement && xml.name() == QLatin1String("model")) {
+            ++models;
+        }
+    }
+    return xml.hasError() ? -1 : models;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("pipeline-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure pipeline overhead with the stub BitNet backend");
+    parser.addHelpOption();
+    QCommandLineOption runsOption("runs", "Number of prompts to run.", "n", "20");
+    QCommandLineOption promptOption("prompt", "Prompt text; the run number is appended.", "text",
+                                    "A warehouse with shelving units and pallets");
+    QCommandLineOption stubOption("stub", "Path to bitnet-stub.", "path",
+                                  QDir(QCoreApplication::applicationDirPath()).filePath("bitnet-stub"));
+    QCommandLineOption modelsOption("models", "Models in each synthetic plan.", "n", "8");
+    QCommandLineOption rateOption("tokens-per-sec", "Simulated generation rate, 0 for unlimited.", "n", "0");
+    QCommandLineOption loadOption("load-ms", "Simulated model load time.", "ms", "0");
+    QCommandLineOption modeOption("mode", "Stub output: plan, truncate or garbage.", "mode", "plan");
+    QCommandLineOption replayOption("replay", "Replay a recorded llama-cli output instead.", "file");
+    QCommandLineOption jsonOption("json", "Also write the results as JSON to this file.", "file");
+    parser.addOptions({runsOption, promptOption, stubOption, modelsOption, rateOption,
+                       loadOption, modeOption, replayOption, jsonOption});
+    parser.process(app);
+
+    QString stubPath = parser.value(stubOption);
+    if (!QFileInfo(stubPath).isExecutable()) {
+        std::fprintf(stderr, "bitnet-stub not found at %s (use --stub)\n", qPrintable(stubPath));
+        return 1;
+    }
+
+    // BitNetClient reads its backend from the environment when constructed.
+    // The stub ignores -m, so any existing file satisfies the model check.
+    qputenv("BURMA_BITNET_CLI", stubPath.toUtf8());
+    qputenv("BURMA_BITNET_MODEL", stubPath.toUtf8());
+    qputenv("BURMA_BITNET_WORKER", "0");
+    qputenv("BURMA_STUB_MODELS", parser.value(modelsOption).toUtf8());
+    qputenv("BURMA_STUB_TOKENS_PER_SEC", parser.value(rateOption).toUtf8());
+    qputenv("BURMA_STUB_LOAD_MS", parser.value(loadOption).toUtf8());
+    qputenv("BURMA_STUB_MODE", parser.value(modeOption).toUtf8());
+    if (parser.isSet(replayOption)) {
+        qputenv("BURMA_STUB_REPLAY", QFileInfo(parser.value(replayOption)).absoluteFilePath().toUtf8());
+    }
+
+    // Keep caches and metrics away from the user's real ones
+    QStandardPaths::setTestModeEnabled(true);
+
+    QTemporaryDir outputDir;
+    BitNetClient client;
+    SDFBuilder sdfBuilder;
+
+    Samples samples;
+    int runs = qMax(1, parser.value(runsOption).toInt());
+    int fallbacks = 0;
+    int failures = 0;
+
+    for (int run = 0; run < runs; ++run) {
+        QJsonObject plan;
+        InferenceMetrics metrics;
+        QEventLoop loop;
+        QObject::connect(&client, &BitNetClient::worldPlanGenerated, &loop,
+                         [&plan](quint64, const QJsonObject &result) { plan = result; });
+        QObject::connect(&client, &BitNetClient::inferenceMetricsReady, &loop,
+                         [&metrics](const InferenceMetrics &result) { metrics = result; });
+        QObject::connect(&client, &BitNetClient::processingFinished, &loop, &QEventLoop::quit);
+
+        // Distinct prompts so every run is a real inference, not a cache hit
+        QElapsedTimer total;
+        total.start();
+        QString prompt = QString("%1 (run %2)").arg(parser.value(promptOption)).arg(run);
+        if (client.submitPrompt(prompt, QStringList(), BitNetClient::Priority::Interactive, true) == 0) {
+            std::fprintf(stderr, "BitNet client is not ready\n");
+            return 1;
+        }
+        loop.exec();
+        double inferenceMs = elapsedMs(total);
+
+        if (metrics.outcome != "ok") {
+            ++fallbacks;
+        }
+
+        // What the backend reported as its own work; the rest of the wall time is ours
+        double backendMs = qMax(0.0, metrics.modelLoadMs) + qMax(0.0, metrics.promptEvalMs)
+                           + qMax(0.0, metrics.generationMs);
+
+        QElapsedTimer stage;
+        stage.start();
+        QString sdf = sdfBuilder.buildWorldSDF(plan);
+        double buildMs = elapsedMs(stage);
+
+        stage.restart();
+        QString path = outputDir.filePath(QString("world_%1.sdf").arg(run));
+        bool saved = sdfBuilder.saveToFile(sdf, path);
+        double saveMs = elapsedMs(stage);
+
+        stage.restart();
+        int loadedModels = saved ? loadWorld(path) : -1;
+        double loadMs = elapsedMs(stage);
+        if (loadedModels < 0) {
+            ++failures;
+        }
+
+        samples["inference (wall)"].push_back(inferenceMs);
+        samples["backend reported"].push_back(backendMs);
+        samples["client overhead"].push_back(qMax(0.0, inferenceMs - backendMs));
+        samples["time to first token"].push_back(metrics.timeToFirstTokenMs);
+        samples["sdf build"].push_back(buildMs);
+        samples["file save"].push_back(saveMs);
+        samples["world load"].push_back(loadMs);
+        samples["pipeline overhead"].push_back(qMax(0.0, inferenceMs - backendMs) + buildMs + saveMs + loadMs);
+        samples["total"].push_back(elapsedMs(total));
+    }
+
+    std::printf("\n%d runs, %d fallback plans, %d failed loads\n\n", runs, fallbacks, failures);
+    std::printf("%-22s %10s %10s %10s %10s\n", "stage (ms)", "min", "median", "p95", "max");
+
+    QJsonObject results;
+    for (const auto &[name, values] : samples) {
+        double min = *std::min_element(values.begin(), values.end());
+        double max = *std::max_element(values.begin(), values.end());
+        double median = percentile(values, 0.5);
+        double p95 = percentile(values, 0.95);
+        std::printf("%-22s %10.3f %10.3f %10.3f %10.3f\n", qPrintable(name), min, median, p95, max);
+
+        QJsonObject stage;
+        stage["min"] = min;
+        stage["median"] = median;
+        stage["p95"] = p95;
+        stage["max"] = max;
+        results[name] = stage;
+    }
+
+    if (parser.isSet(jsonOption)) {
+        results["runs"] = runs;
+        results["fallbacks"] = fallbacks;
+        results["failures"] = failures;
+        QFile file(parser.value(jsonOption));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(QJsonDocument(results).toJson());
+        }
+    }
+
+    // Garbage and truncated output are meant to fall back; a valid plan
+    // that never parses means the stages above measured nothing
+    bool expectPlans = parser.value(modeOption) == "plan";
+    if (expectPlans && fallbacks == runs) {
+        std::fprintf(stderr, "Every run fell back to the default world; no plan was measured\n");
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+// Throughput and peak memory of SDF generation for large worlds.
+//
+// Each (model count, method) pair runs in a child process, so the peak RSS
+// reported for one method isn't inherited from the one before. The child
+// builds the Scene first and resets the kernel's high-water mark, so the
+// figure covers only the SDF generation and write.
+//
+//   string  buildWorldSDF() into a QString, then saveToFile()
+//   bytes   buildWorldUtf8() into a preallocated byte array, then one write
+//   stream  writeWorld() straight into the file
+//   edit    updateWorld() after recoloring one model of a world it already
+//           wrote, i.e. the cost of a property edit
+//   instanced  writeInstancedWorld(): each repeated body once, plus includes
+//
+// With --load-command, e.g. "gz sdf -k", the command is run on every output
+// and timed, to compare how long Gazebo takes to parse full and instanced
+// worlds.
+//
+// --threads sets the builder's pool size, for measuring how the parallel
+// model formatting scales; 1 formats everything on the calling thread.
+
+#include "core/Scene.h"
+#include "modules/SDFBuilder.h"
+#include "modules/SDFReader.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include <cstdio>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace Burma;
+
+namespace {
+
+// Three shelves of repeated models, split evenly between the shape kinds
+QJsonObject syntheticPlan(int count)
+{
+    const char *const types[] = {"box", "cylinder", "sphere"};
+    const char *const colors[] = {"#8B5A2B", "#A0A0A0", "#FF0000"};
+
+    QJsonArray models;
+    for (int i = 0; i < 3; ++i) {
+        int copies = count / 3 + (i < count % 3 ? 1 : 0);
+        if (copies == 0) {
+            continue;
+        }
+        QJsonObject model;
+        model["name"] = QString("%1_unit").arg(types[i]);
+        model["type"] = types[i];
+        model["position"] = QJsonObject{{"x", 0.0}, {"y", 12.5 * i}, {"z", 0.5}};
+        model["rotation"] = QJsonObject{{"roll", 0.0}, {"pitch", 0.0}, {"yaw", 0.785398}};
+        model["scale"] = QJsonObject{{"x", 0.45}, {"y", 1.2}, {"z", 1.0}};
+        model["color"] = colors[i];
+        model["static"] = i != 2;
+        model["repeat"] = QJsonObject{{"pattern", "grid"}, {"count", copies}, {"spacing", 1.5}};
+        models.append(model);
+    }
+
+    QJsonObject plan;
+    plan["world_name"] = "bench_world";
+    plan["models"] = models;
+    return plan;
+}
+
+// Value of a "Name:   1234 kB" line of /proc/self/status, in kB
+qint64 procStatus(const char *name)
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const QByteArray prefix = QByteArray(name) + ':';
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith(prefix)) {
+            return line.mid(prefix.size()).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    return -1;
+}
+
+// Returns freed heap to the kernel and restarts the peak RSS count (Linux 4.0+)
+void resetPeakRss()
+{
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly)) {
+        clearRefs.write("5");
+    }
+}
+
+int runChild(const QString &method, int count, int threads, const QString &outputPath)
+{
+    Scene scene = Scene::fromPlan(syntheticPlan(count));
+    SDFBuilder builder;
+    if (threads > 0) {
+        builder.setThreadCount(threads);
+    }
+
+    if (method == "edit" && !scene.isEmpty()) {
+        // Same length of text, so the output matches the other methods
+        builder.updateWorld(scene, outputPath);
+        scene.setColor(scene.size() / 2, 0x123456);
+    }
+    if (method == "read") {
+        // Times reading back what the stream method writes
+        builder.writeWorld(scene, outputPath);
+    }
+
+    resetPeakRss();
+    qint64 baselineKb = procStatus("VmRSS");
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = false;
+    qint64 bytes = -1;
+    if (method == "string") {
+        ok = builder.saveToFile(builder.buildWorldSDF(scene), outputPath);
+    } else if (method == "bytes") {
+        QByteArray sdf = builder.buildWorldUtf8(scene);
+        QFile file(outputPath);
+        ok = file.open(QIODevice::WriteOnly) && file.write(sdf) == sdf.size();
+    } else if (method == "edit") {
+        ok = builder.updateWorld(scene, outputPath);
+    } else if (method == "read") {
+        Scene readBack;
+        QString error;
+        ok = SDFReader().read(outputPath, &readBack, &error) && readBack.size() == scene.size();
+        if (!ok) {
+            std::fprintf(stderr, "%s: read %d of %d models\n", qPrintable(error),
+                         readBack.size(), scene.size());
+        }
+    } else if (method == "instanced") {
+        SDFBuilder::InstancingStats stats;
+        ok = builder.writeInstancedWorld(scene, outputPath, &stats);
+        bytes = stats.bytesWritten;   // Model directories included
+    } else {
+        ok = builder.writeWorld(scene, outputPath);
+    }
+    double ms = timer.nsecsElapsed() / 1e6;
+
+    qint64 peakKb = procStatus("VmHWM");
+    if (bytes < 0) {
+        bytes = QFileInfo(outputPath).size();
+    }
+    std::printf("RESULT %d %lld %.3f %lld\n", ok ? 1 : 0, bytes, ms, peakKb - baselineKb);
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sdf-write-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure SDF generation throughput and peak memory");
+    parser.addHelpOption();
+    QCommandLineOption countsOption("models", "Comma-separated model counts.", "list",
+                                    "10000,100000,1000000");
+    QCommandLineOption methodsOption("methods", "Comma-separated methods: string, bytes, stream, edit, instanced, read.",
+                                     "list", "string,bytes,stream,instanced");
+    QCommandLineOption threadsOption("threads", "Formatting threads; 0 for one per core.", "count", "0");
+    QCommandLineOption loadOption("load-command", "Command timed on each output, e.g. \"gz sdf -k\".",
+                                  "command");
+    QCommandLineOption childOption("child", "Internal: run one method in this process.", "method");
+    QCommandLineOption outputOption("output", "Internal: file the child writes.", "file");
+    parser.addOptions({countsOption, methodsOption, threadsOption, loadOption, childOption, outputOption});
+    parser.process(app);
+
+    // Keep the builder's log away from the user's real one
+    QStandardPaths::setTestModeEnabled(true);
+
+    if (parser.isSet(childOption)) {
+        return runChild(parser.value(childOption), parser.value(countsOption).toInt(),
+                        parser.value(threadsOption).toInt(), parser.value(outputOption));
+    }
+
+    QTemporaryDir outputDir;
+    int failures = 0;
+    QStringList loadCommand = QProcess::splitCommand(parser.value(loadOption));
+
+    std::printf("%10s %-10s %10s %10s %10s %14s %10s\n", "models", "method", "MB", "ms", "MB/s",
+                "peak RSS MB", "load ms");
+    for (const QString &countText : parser.value(countsOption).split(',', Qt::SkipEmptyParts)) {
+        int count = countText.toInt();
+        qint64 expectedSize = -1;
+
+        for (const QString &method : parser.value(methodsOption).split(',', Qt::SkipEmptyParts)) {
+            QString outputPath = outputDir.filePath(QString("%1_%2.sdf").arg(method).arg(count));
+            QProcess child;
+            child.start(QCoreApplication::applicationFilePath(),
+                        {"--child", method, "--models", QString::number(count),
+                         "--threads", parser.value(threadsOption), "--output", outputPath});
+            child.waitForFinished(-1);
+
+            // The builder logs to stdout too; pick out the result line
+            QList<QByteArray> fields;
+            for (const QByteArray &line : child.readAllStandardOutput().split('\n')) {
+                if (line.startsWith("RESULT ")) {
+                    fields = line.split(' ');
+                }
+            }
+            if (fields.size() != 5 || fields[1] != "1") {
+                std::printf("%10d %-10s %10s\n", count, qPrintable(method), "FAILED");
+                ++failures;
+                continue;
+            }
+
+            qint64 bytes = fields[2].toLongLong();
+            double ms = fields[3].toDouble();
+            double megabytes = bytes / 1048576.0;
+
+            QString loadMs = "-";
+            if (!loadCommand.isEmpty()) {
+                QProcess load;
+                QElapsedTimer timer;
+                timer.start();
+                load.start(loadCommand.first(), loadCommand.mid(1) << outputPath);
+                bool loaded = load.waitForFinished(-1) && load.exitStatus() == QProcess::NormalExit
+                              && load.exitCode() == 0;
+                loadMs = loaded ? QString::number(timer.nsecsElapsed() / 1e6, 'f', 1) : "FAILED";
+            }
+
+            std::printf("%10d %-10s %10.1f %10.1f %10.1f %14.1f %10s\n", count, qPrintable(method),
+                        megabytes, ms, megabytes / (ms / 1000.0), fields[4].toLongLong() / 1024.0,
+                        qPrintable(loadMs));
+
+            if (method == "instanced") {
+                // A different document by design; report what it saves
+                if (expectedSize > 0) {
+                    std::printf("%10s %lld bytes saved (%.1f%%)\n", "", expectedSize - bytes,
+                                100.0 * (expectedSize - bytes) / expectedSize);
+                }
+                QDir(outputDir.filePath(QFileInfo(outputPath).completeBaseName() + "_models"))
+                    .removeRecursively();
+            } else if (expectedSize < 0) {
+                // Every other method must produce the same document
+                expectedSize = bytes;
+            } else if (bytes != expectedSize) {
+                std::printf("%10s output size differs: %lld vs %lld bytes\n", "", bytes, expectedSize);
+                ++failures;
+            }
+            QFile::remove(outputPath);
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
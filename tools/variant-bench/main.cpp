@@ -0,0 +1,139 @@
+// Throughput of world plan variants: one batched decode on a llama-server
+// with parallel slots against the sequential llama-cli loop it replaces.
+// Needs the real model; the paths come from BURMA_BITNET_CLI and
+// BURMA_BITNET_MODEL (or --cli and --model), as for the application.
+
+#include "modules/BitNetClient.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+#include <cstdio>
+
+using namespace Burma;
+
+namespace {
+
+struct Run {
+    int generated = 0;
+    int requested = 0;
+    qint64 elapsedMs = 0;
+
+    double perMinute() const { return elapsedMs > 0 ? generated * 60000.0 / elapsedMs : 0.0; }
+};
+
+Run runVariants(BitNetClient &client, const QString &prompt, int count, int firstSeed)
+{
+    Run run;
+    QEventLoop loop;
+    BitNetClient::JobId runId = 0;
+    QObject::connect(&client, &BitNetClient::variantsFinished, &loop,
+                     [&](quint64 jobId, int generated, int requested, qint64 elapsedMs) {
+        if (jobId == runId) {
+            run.generated = generated;
+            run.requested = requested;
+            run.elapsedMs = elapsedMs;
+            loop.quit();
+        }
+    });
+
+    runId = client.submitVariants(prompt, count, firstSeed);
+    if (runId != 0) {
+        loop.exec();
+    }
+    return run;
+}
+
+QJsonObject toJson(const Run &run)
+{
+    QJsonObject result;
+    result["generated"] = run.generated;
+    result["requested"] = run.requested;
+    result["elapsedMs"] = run.elapsedMs;
+    result["variantsPerMinute"] = run.perMinute();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("variant-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compare batched and sequential BitNet variant generation");
+    parser.addHelpOption();
+    QCommandLineOption variantsOption("variants", "Variants per run.", "n", "16");
+    QCommandLineOption promptOption("prompt", "Prompt to vary.", "text",
+                                    "A warehouse with shelving units and pallets");
+    QCommandLineOption seedOption("seed", "Seed of the first variant.", "n", "1");
+    QCommandLineOption cliOption("cli", "Path to llama-cli; llama-server is expected next to it.", "path");
+    QCommandLineOption modelOption("model", "Path to the GGUF model.", "path");
+    QCommandLineOption jsonOption("json", "Also write the results as JSON to this file.", "file");
+    parser.addOptions({variantsOption, promptOption, seedOption, cliOption, modelOption, jsonOption});
+    parser.process(app);
+
+    // BitNetClient reads its backend from the environment when constructed
+    if (parser.isSet(cliOption)) {
+        qputenv("BURMA_BITNET_CLI", parser.value(cliOption).toUtf8());
+    }
+    if (parser.isSet(modelOption)) {
+        qputenv("BURMA_BITNET_MODEL", parser.value(modelOption).toUtf8());
+    }
+
+    // Keep caches and metrics away from the user's real ones, and start
+    // without cached plans so every variant is decoded
+    QStandardPaths::setTestModeEnabled(true);
+    QDir(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+             .filePath("bitnet_responses")).removeRecursively();
+
+    int count = qMax(1, parser.value(variantsOption).toInt());
+    int seed = qMax(0, parser.value(seedOption).toInt());
+    QString prompt = parser.value(promptOption);
+
+    BitNetClient client;
+    if (!client.isReady()) {
+        std::fprintf(stderr, "BitNet is not set up (use --cli and --model)\n");
+        return 1;
+    }
+
+    // One untimed variant brings the batching server up, so the timed run
+    // measures decoding rather than the model load
+    client.setWorkerEnabled(true);
+    runVariants(client, prompt, 1, seed + 2 * count);
+    Run batched = runVariants(client, prompt, count, seed);
+
+    // Without resident workers variants run one llama-cli process after
+    // another. Other seeds, so none is served from the batched run's cache.
+    client.setWorkerEnabled(false);
+    Run sequential = runVariants(client, prompt, count, seed + count);
+
+    std::printf("\n%-12s %10s %12s %14s\n", "mode", "plans", "time (ms)", "variants/min");
+    std::printf("%-12s %4d / %-3d %12lld %14.1f\n", "batched", batched.generated, batched.requested,
+                static_cast<long long>(batched.elapsedMs), batched.perMinute());
+    std::printf("%-12s %4d / %-3d %12lld %14.1f\n", "sequential", sequential.generated, sequential.requested,
+                static_cast<long long>(sequential.elapsedMs), sequential.perMinute());
+    if (sequential.perMinute() > 0) {
+        std::printf("\nspeedup: %.2fx\n", batched.perMinute() / sequential.perMinute());
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QJsonObject results;
+        results["variants"] = count;
+        results["batched"] = toJson(batched);
+        results["sequential"] = toJson(sequential);
+        QFile file(parser.value(jsonOption));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(QJsonDocument(results).toJson());
+        }
+    }
+
+    return batched.generated > 0 && sequential.generated > 0 ? 0 : 1;
+}